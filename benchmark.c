@@ -0,0 +1,579 @@
+#include <stdio.h>
+#include <stdlib.h> // for malloc, realloc and free
+#include <time.h>
+#define JSONCANVAS_IMPLEMENTATION // build with -DJCANVAS_COMPACT_NODES to measure the compact layout
+#include "jsoncanvas.h"
+#ifdef _WIN32
+#include <Windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi")
+#endif
+
+static double seconds_since(clock_t start)
+{
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+// the byte at a time hash the id map used before, kept here as the baseline
+static uint64_t fnv1a(char* start, char* end)
+{
+    const uint64_t magic_prime = 0x00000100000001b3;
+    uint64_t hash = 0xcbf29ce484222325;
+    for (; start < end; start++) {
+        hash = (hash ^ *start) * magic_prime;
+    }
+    return hash;
+}
+
+// ids as they show up in practice: short counters, generated slugs, uuids and long paths
+static void bench_hashing(void)
+{
+    const uint32_t id_count = 1 << 16, rounds = 64;
+    const uint32_t lengths[] = { 8, 16, 36, 64 };
+    char* ids = malloc(id_count * 64);
+    for (uint32_t i = 0; i < id_count * 64; i++) ids[i] = 'a' + (rand() % 26);
+
+    printf("hashing (%u ids x %u rounds)\n", id_count, rounds);
+    for (int l = 0; l < 4; l++) {
+        uint32_t len = lengths[l];
+        uint64_t sink = 0;
+        clock_t start = clock();
+        for (uint32_t r = 0; r < rounds; r++) {
+            for (uint32_t i = 0; i < id_count; i++) sink ^= fnv1a(&ids[i * 64], &ids[i * 64] + len);
+        }
+        double fnv = seconds_since(start);
+        start = clock();
+        for (uint32_t r = 0; r < rounds; r++) {
+            for (uint32_t i = 0; i < id_count; i++) sink ^= jcanvas_hash(make_str_l(&ids[i * 64], len), r);
+        }
+        double wy = seconds_since(start);
+        double n = (double)id_count * rounds;
+        printf("  len %2u: fnv1a %6.2f ns/id, jcanvas_hash %6.2f ns/id (%llx)\n",
+            len, fnv * 1e9 / n, wy * 1e9 / n, (unsigned long long)(sink & 0xf));
+    }
+    free(ids);
+}
+
+static void bench_id_index(void)
+{
+    const uint32_t node_count = 1000000;
+    char* ids = malloc(node_count * 16);
+    jcanvas c;
+    jcanvas_init(&c);
+
+    clock_t start = clock();
+    for (uint32_t i = 0; i < node_count; i++) {
+        char* id = &ids[i * 16];
+        snprintf(id, 16, "node-%u", i);
+        jcanvas_text_node(&c, id, "text");
+    }
+    double insert = seconds_since(start);
+
+    start = clock();
+    for (uint32_t i = 0; i + 1 < node_count; i++) {
+        jcanvas_connect_by_id(&c, make_str(&ids[i * 16]), make_str(&ids[(i + 1) * 16]));
+    }
+    double connect = seconds_since(start);
+    jcanvas_destroy(&c);
+
+    // the same with the size known up front
+    jcanvas_init(&c);
+    start = clock();
+    jcanvas_reserve(&c, node_count, node_count);
+    for (uint32_t i = 0; i < node_count; i++) jcanvas_text_node(&c, &ids[i * 16], "text");
+    double reserved = seconds_since(start);
+
+    printf("id index (%u nodes)\n", node_count);
+    printf("  create nodes   %6.1f ns/node (%6.1f ns/node after jcanvas_reserve)\n", insert * 1e9 / node_count, reserved * 1e9 / node_count);
+    printf("  connect by id  %6.1f ns/edge\n", connect * 1e9 / (node_count - 1));
+    jcanvas_destroy(&c);
+    free(ids);
+}
+
+// counts the live bytes of a canvas, sizes are passed back on reallocate and free
+static size_t heap_in_use;
+
+static void* counting_allocate(void* ctx, size_t size) { heap_in_use += size; return malloc(size); }
+static void* counting_reallocate(void* ctx, void* ptr, size_t old_size, size_t new_size) { heap_in_use += new_size - old_size; return realloc(ptr, new_size); }
+static void counting_free(void* ctx, void* ptr, size_t size) { heap_in_use -= size; free(ptr); }
+
+// resident set size of the process, 0 where it can't be read
+static size_t current_rss(void)
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+    return counters.WorkingSetSize;
+#else
+    size_t pages = 0, resident = 0;
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (statm == NULL) return 0;
+    if (fscanf(statm, "%zu %zu", &pages, &resident) != 2) resident = 0;
+    fclose(statm);
+    return resident * 4096;
+#endif
+}
+
+static void bench_generate(void)
+{
+    const jcanvas_allocator counting = { counting_allocate, counting_reallocate, counting_free, NULL };
+    const uint32_t node_count = 1000000;
+    const jcanvas_color colors[] = { jcanvas_red, jcanvas_orange, jcanvas_yellow, jcanvas_green, jcanvas_cyan, jcanvas_purple };
+    char* ids = malloc(node_count * 16);
+    size_t rss_before = current_rss();
+    jcanvas c;
+    jcanvas_init_with_allocator(&c, &counting);
+    for (uint32_t i = 0; i < node_count; i++) {
+        char* id = &ids[i * 16];
+        snprintf(id, 16, "node-%u", i);
+        jcanvas_node* node = jcanvas_text_node(&c, id, "text");
+        jcanvas_pos_node(&c, node, i % 1000 * 300, i / 1000 * 300, 250, 250);
+        jcanvas_set_color(&c, node, colors[i % 6]);
+        if (i > 0) jcanvas_connect(&c, &c.nodes[i - 1], node);
+    }
+
+    size_t canvas_heap = heap_in_use, canvas_rss = current_rss() - rss_before;
+    // best of a few runs, a single run is too noisy to compare
+    str result = {0};
+    double generate = 0;
+    for (int run = 0; run < 5; run++) {
+        jcanvas_free_str(&c, &result);
+        clock_t start = clock();
+        result = jcanvas_generate(&c);
+        double t = seconds_since(start);
+        if (run == 0 || t < generate) generate = t;
+    }
+    // sorted by id, so equal canvases generate equal bytes
+    double sorted = 0;
+    c.canonical_order = true;
+    for (int run = 0; run < 5; run++) {
+        str again = {0};
+        clock_t start = clock();
+        again = jcanvas_generate(&c);
+        double t = seconds_since(start);
+        if (run == 0 || t < sorted) sorted = t;
+        jcanvas_free_str(&c, &again);
+    }
+
+    printf("generate (%u nodes, %u edges)\n", c.node_count, c.edge_count);
+    printf("  sizeof(jcanvas_node) %zu, sizeof(jcanvas_edge) %zu\n", sizeof(jcanvas_node), sizeof(jcanvas_edge));
+    printf("  node array         %6.1f MB\n", (double)c.node_cap * sizeof(jcanvas_node) / 1e6);
+    printf("  canvas heap        %6.1f MB (rss +%.1f MB)\n", canvas_heap / 1e6, canvas_rss / 1e6);
+    printf("  %.1f MB in %.3f s, %6.1f MB/s\n", result.len / 1e6, generate, result.len / 1e6 / generate);
+    printf("  in insertion order %.3f s, sorted by id %.3f s\n", generate, sorted);
+
+    // the same sorted by id pulled in 64 KB pieces, the slowest piece is how long an event loop would be blocked
+    static char piece[64 * 1024];
+    jcanvas_gen gen;
+    jcanvas_gen_begin(&c, &gen);
+    double pulled = 0, slowest = 0;
+    uint32_t pieces = 0;
+    for (;;) {
+        clock_t start = clock();
+        uint32_t n = jcanvas_gen_next(&gen, piece, sizeof(piece));
+        double t = seconds_since(start);
+        if (n == 0) break;
+        pulled += t; pieces++;
+        if (t > slowest) slowest = t;
+    }
+    jcanvas_gen_end(&gen);
+    printf("  pulled in %u pieces of up to 64 KB: %.3f s, slowest piece %.0f us\n", pieces, pulled, slowest * 1e6);
+    jcanvas_free_str(&c, &result);
+    jcanvas_destroy(&c);
+    free(ids);
+}
+
+// small edits on a big canvas: appending them to a journal instead of writing the whole canvas again
+static void bench_journal(void)
+{
+    const uint32_t node_count = 100000, edits = 1000000;
+    char* ids = malloc(node_count * 16);
+    jcanvas c;
+    jcanvas_init(&c);
+    for (uint32_t i = 0; i < node_count; i++) {
+        snprintf(&ids[i * 16], 16, "node-%u", i);
+        jcanvas_text_node(&c, &ids[i * 16], "text");
+    }
+    FILE* journal = tmpfile();
+    jcanvas_journal_open(&c, journal);
+    long start_size = ftell(journal);
+    clock_t start = clock();
+    for (uint32_t i = 0; i < edits; i++) {
+        jcanvas_pos_node(&c, &c.nodes[(i * 7919) % node_count], i, i, 250, 250);
+    }
+    jcanvas_journal_flush(&c);
+    double journaled = seconds_since(start);
+    long edit_bytes = ftell(journal) - start_size;
+
+    FILE* compacted = tmpfile();
+    start = clock();
+    jcanvas_journal_compact(&c, compacted);
+    double compact = seconds_since(start);
+
+    printf("journal (%u nodes, %u moves)\n", node_count, edits);
+    printf("  %.1f bytes per edit, %.0f ns per edit\n", (double)edit_bytes / edits, journaled * 1e9 / edits);
+    printf("  compaction %.1f MB in %.3f s\n", ftell(compacted) / 1e6, compact);
+    jcanvas_journal_close(&c);
+    fclose(journal); fclose(compacted);
+    jcanvas_destroy(&c);
+    free(ids);
+}
+
+// reading single nodes back from a written canvas through its index, instead of parsing the file
+static void bench_index_fetch(void)
+{
+    const uint32_t node_count = 1000000, fetches = 200000;
+    char* ids = malloc(node_count * 16);
+    jcanvas c;
+    jcanvas_init(&c);
+    for (uint32_t i = 0; i < node_count; i++) {
+        snprintf(&ids[i * 16], 16, "node-%u", i);
+        jcanvas_text_node(&c, &ids[i * 16], "some text of a node");
+    }
+    FILE* file = tmpfile();
+    FILE* index_file = tmpfile();
+    clock_t start = clock();
+    jcanvas_generate_to_file_indexed(&c, file, index_file);
+    double generated = seconds_since(start);
+    fflush(file);
+    rewind(index_file);
+
+    jcanvas_index index;
+    const char* error;
+    start = clock();
+    jcanvas_index_load(&index, index_file, NULL, &error);
+    double loaded = seconds_since(start);
+    char buf[512];
+    uint64_t bytes = 0;
+    start = clock();
+    for (uint32_t i = 0; i < fetches; i++) {
+        uint32_t k = (uint32_t)(((uint64_t)i * 7919) % node_count);
+        bytes += jcanvas_index_fetch(&index, file, make_str(&ids[k * 16]), buf, sizeof(buf), &error);
+    }
+    double fetched = seconds_since(start);
+
+    printf("index fetch (%u nodes, %u random fetches)\n", node_count, fetches);
+    printf("  generate with index %.3f s, index %.1f MB loaded in %.3f s\n", generated, ftell(index_file) / 1e6, loaded);
+    printf("  %.2f us per fetch (%llu bytes)\n", fetched * 1e6 / fetches, (unsigned long long)bytes);
+    jcanvas_index_destroy(&index);
+    fclose(file); fclose(index_file);
+    jcanvas_destroy(&c);
+    free(ids);
+}
+
+// moving a few nodes of a big canvas file: patching them in place against writing it again
+static void bench_patch(void)
+{
+    const uint32_t node_count = 1000000, moved = 10000;
+    char* ids = malloc(node_count * 16);
+    uint32_t* nodes = malloc(moved * sizeof(uint32_t));
+    jcanvas c;
+    jcanvas_init(&c);
+    c.fixed_width_fields = true;
+    for (uint32_t i = 0; i < node_count; i++) {
+        snprintf(&ids[i * 16], 16, "node-%u", i);
+        jcanvas_text_node(&c, &ids[i * 16], "some text of a node");
+    }
+    FILE* file = tmpfile();
+    FILE* index_file = tmpfile();
+    jcanvas_generate_to_file_indexed(&c, file, index_file);
+    rewind(index_file);
+    jcanvas_index index;
+    jcanvas_index_load(&index, index_file, NULL, NULL);
+
+    for (uint32_t i = 0; i < moved; i++) {
+        nodes[i] = (uint32_t)(((uint64_t)i * 7919) % node_count);
+        jcanvas_pos_node(&c, &c.nodes[nodes[i]], i, -(int64_t)i, 300, 200);
+    }
+    clock_t start = clock();
+    jcanvas_patch_nodes(&c, &index, file, nodes, moved);
+    double patched = seconds_since(start);
+    FILE* rewritten = tmpfile();
+    start = clock();
+    jcanvas_generate_to_file(&c, rewritten);
+    fflush(rewritten);
+    double generated = seconds_since(start);
+
+    printf("patch (%u nodes, %u moved)\n", node_count, moved);
+    printf("  in place %.3f s, rewriting %.1f MB %.3f s\n", patched, ftell(rewritten) / 1e6, generated);
+    jcanvas_index_destroy(&index);
+    fclose(file); fclose(index_file); fclose(rewritten);
+    jcanvas_destroy(&c);
+    free(nodes);
+    free(ids);
+}
+
+// overview levels of a million nodes scattered over a large area
+static void bench_lod(void)
+{
+    const uint32_t node_count = 1000000, levels = 9, finest = 8;
+    char* ids = malloc(node_count * 16);
+    jcanvas c;
+    jcanvas_init(&c);
+    srand(1);
+    for (uint32_t i = 0; i < node_count; i++) {
+        snprintf(&ids[i * 16], 16, "node-%u", i);
+        jcanvas_node* node = jcanvas_text_node(&c, &ids[i * 16], "text");
+        jcanvas_pos_node(&c, node, (rand() % 100000) * 10, (rand() % 100000) * 10, 250, 250);
+        if (i > 0) jcanvas_connect(&c, &c.nodes[i - 1], node);
+    }
+    jcanvas lod[9];
+    clock_t start = clock();
+    jcanvas_build_lod(&c, levels, finest, lod);
+    double built = seconds_since(start);
+
+    printf("lod (%u nodes, %u levels, %u by %u cells at the finest)\n", node_count, levels, 1u << finest, 1u << finest);
+    printf("  %.3f s, level 0 %u nodes / %u edges, level %u %u nodes / %u edges\n", built,
+        lod[0].node_count, lod[0].edge_count, levels - 1, lod[levels - 1].node_count, lod[levels - 1].edge_count);
+    for (uint32_t i = 0; i < levels; i++) jcanvas_destroy(&lod[i]);
+    jcanvas_destroy(&c);
+    free(ids);
+}
+
+// nodes with long texts: copying them into one string against pointing at them from iovecs
+static void bench_iov(void)
+{
+    const uint32_t node_count = 200000, text_len = 2048;
+    char* ids = malloc(node_count * 16);
+    char* texts = malloc((size_t)node_count * (text_len + 1));
+    jcanvas c;
+    jcanvas_init(&c);
+    for (uint32_t i = 0; i < node_count; i++) {
+        char* text = &texts[(size_t)i * (text_len + 1)];
+        for (uint32_t k = 0; k < text_len; k++) text[k] = 'a' + (i + k) % 26;
+        text[text_len] = 0;
+        snprintf(&ids[i * 16], 16, "node-%u", i);
+        jcanvas_text_node(&c, &ids[i * 16], text);
+    }
+    double generate = 0, gather = 0;
+    str result = {0};
+    jcanvas_iov iov = {0};
+    for (int run = 0; run < 3; run++) {
+        jcanvas_free_str(&c, &result);
+        clock_t start = clock();
+        result = jcanvas_generate(&c);
+        double t = seconds_since(start);
+        if (run == 0 || t < generate) generate = t;
+        jcanvas_iov_free(&iov);
+        start = clock();
+        jcanvas_generate_iov(&c, &iov);
+        t = seconds_since(start);
+        if (run == 0 || t < gather) gather = t;
+    }
+    printf("iov (%u nodes with %u byte texts)\n", node_count, text_len);
+    printf("  generate %.1f MB in %.3f s, iov %u pieces in %.3f s\n", result.len / 1e6, generate, iov.count, gather);
+    jcanvas_iov_free(&iov);
+    jcanvas_free_str(&c, &result);
+    jcanvas_destroy(&c);
+    free(texts);
+    free(ids);
+}
+
+// a node table and an edge list as graph tools export them
+static void bench_import(void)
+{
+    const uint32_t node_count = 500000, edge_count = 1000000;
+    FILE* nodes_file = tmpfile();
+    FILE* edges_file = tmpfile();
+    fputs("id,text,x,y\n", nodes_file);
+    for (uint32_t i = 0; i < node_count; i++) fprintf(nodes_file, "node-%u,text %u,%u,%u\n", i, i, i % 1000 * 300, i / 1000 * 300);
+    srand(1);
+    for (uint32_t i = 0; i < edge_count; i++) fprintf(edges_file, "node-%u node-%u\n", rand() % node_count, rand() % node_count);
+
+    // the same files read line by line and added through the api, the way a caller would without the importer
+    char* strings = malloc(node_count * 32);
+    char line[64];
+    jcanvas c;
+    jcanvas_init(&c);
+    rewind(nodes_file);
+    rewind(edges_file);
+    clock_t start = clock();
+    fgets(line, sizeof(line), nodes_file);
+    for (uint32_t i = 0; fgets(line, sizeof(line), nodes_file); i++) {
+        char* id = &strings[i * 32];
+        char* text = id + 16;
+        int x, y;
+        if (sscanf(line, "%15[^,],%15[^,],%d,%d", id, text, &x, &y) != 4) continue;
+        jcanvas_node* node = jcanvas_text_node(&c, id, text);
+        jcanvas_pos_node(&c, node, x, y, 200, 200);
+    }
+    while (fgets(line, sizeof(line), edges_file)) {
+        char from[16], to[16];
+        if (sscanf(line, "%15s %15s", from, to) == 2) jcanvas_connect_by_id(&c, make_str(from), make_str(to));
+    }
+    double one_by_one = seconds_since(start);
+    jcanvas_destroy(&c);
+
+    jcanvas_import_stats node_stats, edge_stats;
+    jcanvas_init(&c);
+    rewind(nodes_file);
+    rewind(edges_file);
+    start = clock();
+    jcanvas_import_nodes_csv(&c, nodes_file, &node_stats);
+    jcanvas_import_edges(&c, edges_file, &edge_stats);
+    double bulk = seconds_since(start);
+
+    printf("import (%u nodes, %u of %u edges)\n", node_stats.added, edge_stats.added, edge_stats.rows);
+    printf("  line by line %6.1f ms, jcanvas_import_* %6.1f ms\n", one_by_one * 1e3, bulk * 1e3);
+    jcanvas_destroy(&c);
+    fclose(nodes_file);
+    fclose(edges_file);
+    free(strings);
+}
+
+// groups with nodes in them, found by testing every node against every group and with jcanvas_build_group_tree
+static void bench_group_tree(void)
+{
+    const uint32_t node_count = 50000;
+    char* ids = malloc(node_count * 16);
+    jcanvas c;
+    jcanvas_init(&c);
+    srand(1);
+    for (uint32_t i = 0; i < node_count; i++) {
+        snprintf(&ids[i * 16], 16, "node-%u", i);
+        bool group = i % 10 == 0;
+        jcanvas_node* node = group ? jcanvas_group_node(&c, &ids[i * 16]) : jcanvas_text_node(&c, &ids[i * 16], "text");
+        int64_t size = group ? 500 + rand() % 5000 : 100 + rand() % 200;
+        jcanvas_pos_node(&c, node, rand() % 100000, rand() % 100000, size, size);
+    }
+
+    clock_t start = clock();
+    uint32_t* groups = malloc(node_count * sizeof(uint32_t));
+    uint32_t group_count = 0, nested = 0;
+    for (uint32_t i = 0; i < c.node_count; i++) if (c.nodes[i].type == NODE_TYPE_GROUP) groups[group_count++] = i;
+    for (uint32_t i = 0; i < c.node_count; i++) {
+        const jcanvas_node* node = &c.nodes[i];
+        uint32_t best = JCANVAS_NO_GROUP;
+        for (uint32_t k = 0; k < group_count; k++) {
+            uint32_t g = groups[k];
+            const jcanvas_node* group = &c.nodes[g];
+            if (g == i || node->x < group->x || node->y < group->y) continue;
+            if (node->x + node->width > group->x + group->width || node->y + node->height > group->y + group->height) continue;
+            if (best == JCANVAS_NO_GROUP || group->width * group->height < c.nodes[best].width * c.nodes[best].height) best = g;
+        }
+        nested += best != JCANVAS_NO_GROUP;
+    }
+    double scan = seconds_since(start);
+
+    jcanvas_group_tree tree;
+    start = clock();
+    jcanvas_build_group_tree(&c, &tree);
+    double built = seconds_since(start);
+
+    printf("group tree (%u nodes, %u of them in a group)\n", node_count, nested);
+    printf("  every node against every group %6.1f ms, jcanvas_build_group_tree %6.1f ms\n", scan * 1e3, built * 1e3);
+    jcanvas_group_tree_destroy(&tree);
+    jcanvas_destroy(&c);
+    free(groups);
+    free(ids);
+}
+
+// after a re-layout every edge needs its sides inferred again
+static void bench_edge_sides(void)
+{
+    const uint32_t node_count = 1000000;
+    char* ids = malloc(node_count * 16);
+    jcanvas c;
+    jcanvas_init(&c);
+    srand(1);
+    for (uint32_t i = 0; i < node_count; i++) {
+        snprintf(&ids[i * 16], 16, "node-%u", i);
+        jcanvas_node* node = jcanvas_text_node(&c, &ids[i * 16], "text");
+        jcanvas_pos_node(&c, node, rand() % 100000, rand() % 100000, 100 + rand() % 400, 100 + rand() % 400);
+    }
+    for (uint32_t i = 1; i < node_count; i++) jcanvas_connect(&c, &c.nodes[rand() % i], &c.nodes[i]);
+
+    // best of a few runs, it is bound by memory and noisy
+    double one_by_one = 0, batch = 0;
+    for (int run = 0; run < 3; run++) {
+        clock_t start = clock();
+        for (uint32_t i = 0; i < c.edge_count; i++) {
+            jcanvas_edge* e = &c.edges[i];
+            jcanvas_infer_edge_sides(e, &c.nodes[e->from_index], &c.nodes[e->to_index]);
+        }
+        double t = seconds_since(start);
+        if (run == 0 || t < one_by_one) one_by_one = t;
+        start = clock();
+        jcanvas_infer_all_edge_sides(&c);
+        t = seconds_since(start);
+        if (run == 0 || t < batch) batch = t;
+    }
+
+    printf("edge sides (%u edges)\n", c.edge_count);
+    printf("  one by one %6.2f ns/edge, jcanvas_infer_all_edge_sides %6.2f ns/edge\n",
+        one_by_one * 1e9 / c.edge_count, batch * 1e9 / c.edge_count);
+    jcanvas_destroy(&c);
+    free(ids);
+}
+
+static char instance_prefix[16];
+
+static str make_instance_prefix(void* user, uint32_t instance)
+{
+    int len = snprintf(instance_prefix, sizeof(instance_prefix), "m%u/", instance);
+    return make_str_l(instance_prefix, len);
+}
+
+// the same motif (a group with three text nodes in a chain) stamped many times
+static void bench_instantiate(void)
+{
+    const uint32_t instances = 25000;
+    jcanvas motif;
+    jcanvas_init(&motif);
+    jcanvas_group_node(&motif, "group");
+    jcanvas_text_node(&motif, "a", "first");
+    jcanvas_text_node(&motif, "b", "second");
+    jcanvas_text_node(&motif, "c", "third");
+    jcanvas_connect(&motif, &motif.nodes[1], &motif.nodes[2]);
+    jcanvas_connect(&motif, &motif.nodes[2], &motif.nodes[3]);
+
+    // room for "m<instance>/" with any instance number in front of the motif's short ids
+    char* ids = malloc(instances * 4 * 32);
+    jcanvas c;
+    jcanvas_init(&c);
+    clock_t start = clock();
+    for (uint32_t k = 0; k < instances; k++) {
+        for (uint32_t i = 0; i < 4; i++) {
+            char* id = &ids[(k * 4 + i) * 32];
+            snprintf(id, 32, "m%u/%s", k, sstr_view(&motif.nodes[i].id).data);
+            jcanvas_node* node = i == 0 ? jcanvas_group_node(&c, id) : jcanvas_text_node_s(&c, make_str(id), motif.nodes[i].as.text);
+            jcanvas_pos_node(&c, node, k * 1000, motif.nodes[i].y, 200, 200);
+        }
+        jcanvas_connect(&c, &c.nodes[k * 4 + 1], &c.nodes[k * 4 + 2]);
+        jcanvas_connect(&c, &c.nodes[k * 4 + 2], &c.nodes[k * 4 + 3]);
+    }
+    double one_by_one = seconds_since(start);
+    jcanvas_destroy(&c);
+
+    jcanvas_offset* offsets = malloc(instances * sizeof(jcanvas_offset));
+    for (uint32_t k = 0; k < instances; k++) offsets[k] = (jcanvas_offset){ k * 1000, 0 };
+    jcanvas_init(&c);
+    start = clock();
+    jcanvas_instantiate(&c, &motif, instances, offsets, make_instance_prefix, NULL);
+    double bulk = seconds_since(start);
+
+    printf("instantiate (%u instances, %u nodes, %u edges)\n", instances, c.node_count, c.edge_count);
+    printf("  one by one %6.1f ms, jcanvas_instantiate %6.1f ms\n", one_by_one * 1e3, bulk * 1e3);
+    jcanvas_destroy(&c);
+    jcanvas_destroy(&motif);
+    free(offsets);
+    free(ids);
+}
+
+int main()
+{
+    // first, so the rss it reports isn't made of memory the other benchmarks freed
+    bench_generate();
+    bench_hashing();
+    bench_id_index();
+    bench_journal();
+    bench_instantiate();
+    bench_edge_sides();
+    bench_index_fetch();
+    bench_patch();
+    bench_lod();
+    bench_iov();
+    bench_import();
+    bench_group_tree();
+    return 0;
+}
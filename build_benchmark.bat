@@ -0,0 +1,5 @@
+@echo off
+py generate_header.py
+clang benchmark.c -o out/benchmark.exe -O3
+clang benchmark.c -o out/benchmark_compact.exe -O3 -DJCANVAS_COMPACT_NODES
+@echo on
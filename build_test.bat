@@ -0,0 +1,6 @@
+@echo off
+py generate_header.py
+clang test.c -fsanitize=address -o out/test.exe -O0 -g -Wall -Wno-incompatible-pointer-types -Wno-switch -Wno-microsoft-enum-forward-reference -Wno-unused-variable -Wno-unused-function
+clang test.c -fsanitize=address -o out/test_compact.exe -O0 -g -Wall -Wno-incompatible-pointer-types -Wno-switch -Wno-microsoft-enum-forward-reference -Wno-unused-variable -Wno-unused-function -DJCANVAS_COMPACT_NODES
+out\test.exe && out\test_compact.exe
+@echo on
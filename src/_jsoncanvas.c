@@ -1,11 +1,22 @@
 #include "_jsoncanvas.h"
+#include <time.h>
+#include <stdatomic.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+int fileno(FILE* stream); // POSIX, stdio.h hides it in strict ISO C modes
+ssize_t pread(int fd, void* buf, size_t count, off_t offset);
+int fseeko(FILE* stream, off_t offset, int whence);
+off_t ftello(FILE* stream);
+#endif
 
-static const jcanvas_color jcanvas_red = {"1", 1};
-static const jcanvas_color jcanvas_orange = {"2", 1};
-static const jcanvas_color jcanvas_yellow = {"3", 1};
-static const jcanvas_color jcanvas_green = {"4", 1};
-static const jcanvas_color jcanvas_cyan = {"5", 1};
-static const jcanvas_color jcanvas_purple = {"6", 1};
+static const jcanvas_color jcanvas_red = { .in = {"1", 1} };
+static const jcanvas_color jcanvas_orange = { .in = {"2", 1} };
+static const jcanvas_color jcanvas_yellow = { .in = {"3", 1} };
+static const jcanvas_color jcanvas_green = { .in = {"4", 1} };
+static const jcanvas_color jcanvas_cyan = { .in = {"5", 1} };
+static const jcanvas_color jcanvas_purple = { .in = {"6", 1} };
 
 static const str _background_style_strings[] = {
     {"cover", 5},
@@ -32,33 +43,152 @@ static const str _end_strings[] = {
     {"arrow", 5},
 };
 
-static bool ensure_capacity(uint32_t* cap, uint32_t new_cap, void** data, uint32_t size_of_type)
+static void* default_allocate(void* ctx, size_t size)
 {
-    if (new_cap <= *cap) return true;
+    return ALLOCATE(size);
+}
 
-    if (*cap == 0) *cap = new_cap;
-    else {
-        while (*cap <= new_cap) {
-            *cap *= 1.5;
+static void* default_reallocate(void* ctx, void* ptr, size_t old_size, size_t new_size)
+{
+    return REALLOC(ptr, new_size);
+}
+
+static void default_free(void* ctx, void* ptr, size_t size)
+{
+    FREE(ptr);
+}
+
+static const jcanvas_allocator default_allocator = {
+    default_allocate, default_reallocate, default_free, NULL
+};
+
+#define JCANVAS_MIN_CAPACITY 16
+
+// the capacity an array of cap elements grows to so that needed fit: percent more each time, but at least
+// JCANVAS_MIN_CAPACITY and at most max_step (if not 0) elements more
+static uint32_t grown_capacity(uint32_t cap, uint32_t needed, uint32_t percent, uint32_t max_step)
+{
+    uint64_t result = cap;
+    while (result < needed) {
+        uint64_t step = result * percent / 100;
+        if (step < JCANVAS_MIN_CAPACITY) step = JCANVAS_MIN_CAPACITY;
+        if (max_step && step > max_step) step = max_step;
+        if (step == JCANVAS_MIN_CAPACITY || step == max_step) {
+            // the steps don't get larger anymore, take as many as needed at once
+            result += (needed - result + step - 1) / step * step;
+            break;
         }
+        result += step;
     }
-    void* result = REALLOC(*data, *cap * size_of_type);
+    return result > UINT32_MAX ? UINT32_MAX : (uint32_t)result;
+}
+
+// reallocates data to exactly new_cap elements, which may also be fewer than now
+static bool resize_array(const jcanvas_allocator* a, uint32_t* cap, uint32_t new_cap, void** data, uint32_t size_of_type)
+{
+    uint32_t old_cap = *data ? *cap : 0;
+    void* result = *data
+        ? a->reallocate(a->ctx, *data, (size_t)old_cap * size_of_type, (size_t)new_cap * size_of_type)
+        : a->allocate(a->ctx, (size_t)new_cap * size_of_type);
     if (result == NULL) {
         return false;
     }
-    *data = result;
+    *data = result; *cap = new_cap;
+    return true;
+}
+
+static bool ensure_capacity(const jcanvas_allocator* a, uint32_t* cap, uint32_t new_cap, void** data, uint32_t size_of_type)
+{
+    if (new_cap <= *cap) return true;
+    return resize_array(a, cap, *cap == 0 ? new_cap : grown_capacity(*cap, new_cap, 50, 0), data, size_of_type);
+}
+
+static void free_array(const jcanvas_allocator* a, void* data, uint32_t cap, uint32_t size_of_type)
+{
+    if (data) a->free(a->ctx, data, (size_t)cap * size_of_type);
+}
+
+// grows two parallel arrays that share one capacity
+static bool ensure_capacity2(const jcanvas_allocator* alloc, uint32_t* cap, uint32_t new_cap, void** a, void** b, uint32_t size_of_type)
+{
+    uint32_t cap_a = *cap, cap_b = *cap;
+    if (!ensure_capacity(alloc, &cap_a, new_cap, a, size_of_type)) return false;
+    if (!ensure_capacity(alloc, &cap_b, new_cap, b, size_of_type)) {
+        // give back what a grew by, so both arrays still match the shared capacity
+        if (*cap == 0) {
+            free_array(alloc, *a, cap_a, size_of_type); *a = NULL;
+        } else {
+            void* shrunk = alloc->reallocate(alloc->ctx, *a, (size_t)cap_a * size_of_type, (size_t)*cap * size_of_type);
+            if (shrunk) *a = shrunk;
+        }
+        return false;
+    }
+    *cap = cap_a;
+    return true;
+}
+
+// sorts keys (and values along with them) by their lowest key_bits bits, a byte per pass. the passes only
+// move keys around, so the counts of all of them are taken in one read up front
+static bool radix_sort(const jcanvas_allocator* a, uint64_t* keys, uint32_t* values, uint32_t count, uint32_t key_bits)
+{
+    if (count < 2 || key_bits == 0) return true;
+    uint32_t passes = (key_bits + 7) / 8;
+    uint32_t counts[8][256] = {0};
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t key = keys[i];
+        for (uint32_t p = 0; p < passes; p++) counts[p][(key >> (p * 8)) & 0xff]++;
+    }
+    uint64_t* tmp_keys = a->allocate(a->ctx, (size_t)count * sizeof(uint64_t));
+    uint32_t* tmp_values = a->allocate(a->ctx, (size_t)count * sizeof(uint32_t));
+    if (tmp_keys == NULL || tmp_values == NULL) {
+        free_array(a, tmp_keys, count, sizeof(uint64_t));
+        free_array(a, tmp_values, count, sizeof(uint32_t));
+        return false;
+    }
+    uint64_t* from_keys = keys; uint32_t* from_values = values;
+    uint64_t* to_keys = tmp_keys; uint32_t* to_values = tmp_values;
+    for (uint32_t p = 0; p < passes; p++) {
+        uint32_t shift = p * 8;
+        uint32_t* offsets = counts[p];
+        if (offsets[(from_keys[0] >> shift) & 0xff] == count) continue; // every key has the same byte here
+        uint32_t sum = 0;
+        for (uint32_t d = 0; d < 256; d++) { uint32_t n = offsets[d]; offsets[d] = sum; sum += n; }
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t at = offsets[(from_keys[i] >> shift) & 0xff]++;
+            to_keys[at] = from_keys[i]; to_values[at] = from_values[i];
+        }
+        uint64_t* k = from_keys; from_keys = to_keys; to_keys = k;
+        uint32_t* v = from_values; from_values = to_values; to_values = v;
+    }
+    if (from_keys != keys) {
+        for (uint32_t i = 0; i < count; i++) { keys[i] = from_keys[i]; values[i] = from_values[i]; }
+    }
+    free_array(a, tmp_keys, count, sizeof(uint64_t));
+    free_array(a, tmp_values, count, sizeof(uint32_t));
     return true;
 }
 
+#if defined(__GNUC__) || defined(__clang__)
+#define PREFETCH(p) __builtin_prefetch(p)
+#else
+#define PREFETCH(p) ((void)(p))
+#endif
+
 //#region helper_functions
-str str_init(uint32_t starting_cap)
+str str_init(const jcanvas_allocator* a, uint32_t starting_cap)
 {
     str result;
-    result.len = 0; result.cap = starting_cap;
-    result.data = ALLOCATE(starting_cap);
+    result.data = a->allocate(a->ctx, starting_cap);
+    result.len = 0; result.cap = result.data ? starting_cap : 0;
     return result;
 }
 
+void str_free(const jcanvas_allocator* a, str* s)
+{
+    if (s->data && s->cap > 0) a->free(a->ctx, s->data, s->cap);
+    *s = (str){0};
+}
+
 void copy_mem(char* from, char* to, uint32_t size)
 {
     if (from == NULL || to == NULL) return;
@@ -68,10 +198,10 @@ void copy_mem(char* from, char* to, uint32_t size)
     }
 }
 
-bool str_append_s(str* a, str b)
+bool str_append_s(const jcanvas_allocator* alloc, str* a, str b)
 {
     if (b.len == 0) return true;
-    bool ok = ensure_capacity(&a->cap, a->len + b.len, &a->data, 1);
+    bool ok = ensure_capacity(alloc, &a->cap, a->len + b.len, &a->data, 1);
     if (!ok) return false;
     copy_mem(b.data, &a->data[a->len], b.len);
     a->len += b.len;
@@ -89,18 +219,19 @@ uint32_t str_len(char* string)
     return len;
 }
 
-[[always_inline]] bool str_append(str* a, char* text, uint32_t len)
+[[always_inline]] bool str_append(const jcanvas_allocator* alloc, str* a, char* text, uint32_t len)
 {
     if (len == 0) len = str_len(text);
     str str_to_append; str_to_append.data = text; str_to_append.len = len;   
-    return str_append_s(a, str_to_append);
+    return str_append_s(alloc, a, str_to_append);
 }
 
-str str_concat(str a, str b)
+str str_concat(const jcanvas_allocator* alloc, str a, str b)
 {
     str result;
-    result.len = a.len + b.len;
-    result.data = ALLOCATE(result.len+1);
+    result.len = a.len + b.len; result.cap = result.len+1;
+    result.data = alloc->allocate(alloc->ctx, result.cap);
+    if (result.data == NULL) return (str){0};
     copy_mem(a.data, result.data, a.len);
     copy_mem(b.data, result.data + a.len, b.len);
     result.data[result.len] = 0;
@@ -121,476 +252,5010 @@ str str_concat(str a, str b)
     return make_str_l(data, len);
 }
 
-uint64_t fnv1a(char* start, char* end)
+// short strings are copied in place, longer ones are referenced and have to outlive the sstr
+sstr make_sstr(str s)
 {
-    const uint64_t magic_prime = 0x00000100000001b3;
-    uint64_t hash = 0xcbf29ce484222325;
-    for (; start <= end; start++) {
-        hash = (hash ^ *start) * magic_prime;
+    sstr result = {0};
+    if (s.len <= SSTR_INLINE_CAP) {
+        copy_mem(s.data, result.in.data, s.len);
+        result.in.len = (uint8_t)s.len;
+    } else {
+        result.ref.data = s.data; result.ref.len = s.len;
+        result.raw[15] = SSTR_REF;
     }
-    return hash;
+    return result;
 }
 
-static void rotate_right(map* x)
+// the view points into s when it is inline, so it is valid only as long as s doesn't move
+[[always_inline]] str sstr_view(const sstr* s)
 {
-    map* y = x->left;
-    x->left = y->right;
-    if (y->right) {
-        y->right->parent = x;
-    }
-    y->parent = x->parent;
-    if (x->parent) {
-        if (x == (x->parent)->right) {
-            x->parent->right = y;
-        }
-        else {
-            x->parent->left = y;
-        }
+    if (s->raw[15] == SSTR_REF) return make_str_l(s->ref.data, s->ref.len);
+    return make_str_l((char*)s->in.data, s->in.len);
+}
+
+[[always_inline]] bool str_append_ss(const jcanvas_allocator* alloc, str* a, const sstr* b)
+{
+    return str_append_s(alloc, a, sstr_view(b));
+}
+
+void reverse_buf(char* buf, uint32_t len)
+{
+    char* prev = &buf[29+len];
+    char* new = buf;
+    for (int i = 0; i < len; i++) {
+        *new++ = *prev--;
     }
-    y->right = x;
-    x->parent = y;
 }
 
-static void rotate_left(map* x)
+int int_to_str(char* buf, int64_t i)
 {
-    map* y = x->right;
-    x->right = y->left;
-    if (y->left) {
-        y->left->parent = x;
+    if (i == 0) { 
+        buf[0] = '0'; buf[1] = 0;
+        return 1; 
     }
-    y->parent = x->parent;
-    if (x->parent) {
-        if (x == (x->parent)->left) {
-            x->parent->left = y;
-        }
-        else {
-            x->parent->right = y;
-        }
+    uint32_t index = 30;
+    bool is_negative = false;
+    if (i < 0) {
+        is_negative = true; 
+        i *= -1;
+    }
+    while (i > 0) {
+        char digit = i % 10;
+        digit += '0';
+        buf[index++] = digit;
+        i /= 10;
+    }
+    if (is_negative) {
+        buf[index++] = '-';
     }
-    y->left = x;
-    x->parent = y;
+    uint32_t len = index-30;
+    reverse_buf(buf, len);
+    buf[len] = 0;
+    return len;
 }
 
-static void rebalance_tree(map* cur)
+// fseek and ftell with 64 bit offsets, long is 32 bits on windows
+static bool file_seek(FILE* file, int64_t offset, int whence)
 {
-    cur->is_red = true;
-    while ( (cur->parent) && (cur->parent->is_red)) {
-        if (cur->parent->parent == NULL) break;
-        if (cur->parent == cur->parent->parent->left) {
-            map* uncle = cur->parent->parent->right;
-            if (uncle == NULL) break;
-            if (uncle->is_red) {
-                // case 1: switch colors
-                cur->parent->is_red = false; uncle->is_red = false;
-                cur->parent->parent->is_red = true;
-                cur = cur->parent->parent;
-            } else {
-                if (cur == cur->parent->right) {
-                    // case 2: move cur up and rotate
-                    cur = cur->parent;
-                    rotate_left(cur);
-                }
-                else {
-                // case 3
-                    cur->parent->is_red = false;
-                    cur->parent->parent->is_red = true;
-                    rotate_right(cur->parent->parent);
-                }
-            }
-        } else {
-            map* uncle = cur->parent->parent->left;
-            if (uncle == NULL) break;
-            if (uncle->is_red) {
-                // case 1: switch colors
-                cur->parent->is_red = false; uncle->is_red = false;
-                cur->parent->parent->is_red = true;
-                cur = cur->parent->parent;
-            } else {
-                if (cur == cur->parent->left) {
-                    // case 2: move cur up and rotate
-                    cur = cur->parent;
-                    rotate_left(cur);
-                }
-                else {
-                // case 3
-                    cur->parent->is_red = false;
-                    cur->parent->parent->is_red = true;
-                    rotate_right(cur->parent->parent);
-                }
-            }
-        }
-    }
+#if defined(_WIN32)
+    return _fseeki64(file, (long long)offset, whence) == 0;
+#elif defined(__linux__)
+    return fseeko(file, (off_t)offset, whence) == 0;
+#else
+    return offset == (long)offset && fseek(file, (long)offset, whence) == 0;
+#endif
 }
 
-void* map_get(map* root, str key)
+// -1 on failure
+static int64_t file_tell(FILE* file)
 {
-    if (root == NULL) return NULL;
-    uint64_t hash = fnv1a(key.data, key.data + key.len);
-    map* cur = root;
-    while (true) {
-        if (cur == NULL || cur->hash == hash) break;
-        cur = hash < cur->hash ? cur->left : cur->right;
-    }
-    return cur ? cur->value : NULL;
+#if defined(_WIN32)
+    return _ftelli64(file);
+#elif defined(__linux__)
+    return ftello(file);
+#else
+    return ftell(file);
+#endif
 }
 
-void map_set(map* root, str key, void* value)
+//#region hashing
+// wyhash style: the input is read 4/8 bytes at a time and folded with 64x64->128 bit multiplies
+static const uint64_t hash_secret[3] = { 0xa0761d6478bd642f, 0xe7037ed1a0b428db, 0x8ebc6af09c88c6e3 };
+
+static void hash_mum(uint64_t* a, uint64_t* b)
 {
-    uint64_t hash = fnv1a(key.data, key.data + key.len);
-    map* cur = root;
-    map** place_to_insert = NULL;
-    while (true) {
-        if (hash == cur->hash) {
-            cur->value = value;
-            return;
-        } else if (cur->hash == 0) {
-            // root
-            cur->hash = hash; cur->value = value;
-            return;
-        }
-        if (hash < cur->hash) {
-            if (cur->left == NULL) {
-                place_to_insert = &cur->left; break;
-            }
-            cur = cur->left;
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = (__uint128_t)*a * *b;
+    *a = (uint64_t)r; *b = (uint64_t)(r >> 64);
+#else
+    uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32), carry = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    carry += lo < t;
+    *a = lo; *b = rh + (rm0 >> 32) + (rm1 >> 32) + carry;
+#endif
+}
+
+static uint64_t hash_mix(uint64_t a, uint64_t b)
+{
+    hash_mum(&a, &b);
+    return a ^ b;
+}
+
+// little endian loads, compilers turn these into single moves
+static uint64_t hash_read8(const uint8_t* p)
+{
+    return (uint64_t)p[0] | (uint64_t)p[1] << 8 | (uint64_t)p[2] << 16 | (uint64_t)p[3] << 24
+        | (uint64_t)p[4] << 32 | (uint64_t)p[5] << 40 | (uint64_t)p[6] << 48 | (uint64_t)p[7] << 56;
+}
+
+static uint64_t hash_read4(const uint8_t* p)
+{
+    return (uint64_t)p[0] | (uint64_t)p[1] << 8 | (uint64_t)p[2] << 16 | (uint64_t)p[3] << 24;
+}
+
+uint64_t jcanvas_hash(str s, uint64_t seed)
+{
+    const uint8_t* p = (const uint8_t*)s.data;
+    uint32_t len = s.len;
+    uint64_t a, b;
+    seed ^= hash_secret[0];
+    if (len <= 16) {
+        if (len >= 4) {
+            // two overlapping 4 byte reads from each end cover every byte
+            uint32_t shift = (len >> 3) << 2;
+            a = (hash_read4(p) << 32) | hash_read4(p + shift);
+            b = (hash_read4(p + len - 4) << 32) | hash_read4(p + len - 4 - shift);
+        } else if (len > 0) {
+            a = ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+            b = 0;
+        } else {
+            a = b = 0;
         }
-        else if (hash > cur->hash) {
-            if (cur->right == NULL) {
-                place_to_insert = &cur->right; break;
-            }
-            cur = cur->right;
+    } else {
+        uint32_t i = len;
+        while (i > 16) {
+            seed = hash_mix(hash_read8(p) ^ hash_secret[1], hash_read8(p + 8) ^ seed);
+            p += 16; i -= 16;
         }
+        a = hash_read8(p + i - 16);
+        b = hash_read8(p + i - 8);
     }
-    *place_to_insert = ALLOCATE(sizeof(map)); map* new = *place_to_insert;
-    new->hash = hash; new->left = new->right = NULL; new->value = value; new->parent = cur;
-    new->is_red = true;
+    a ^= hash_secret[1]; b ^= seed;
+    hash_mum(&a, &b);
+    return hash_mix(a ^ hash_secret[0] ^ len, b ^ hash_secret[1]);
+}
 
-    rebalance_tree(new);
+// the seed doesn't have to be cryptographically strong, only unpredictable enough that ids
+// can't be crafted ahead of time: it mixes the canvas and stack addresses (ASLR), the time
+// and a counter
+static uint64_t make_hash_seed(void* canvas)
+{
+    static _Atomic uint64_t counter = 0; // canvases may be made on several threads
+    uint64_t local = 0;
+    uint64_t seed = hash_mix((uint64_t)(uintptr_t)canvas ^ hash_secret[0], (uint64_t)(uintptr_t)&local ^ hash_secret[1]);
+    seed = hash_mix(seed ^ (uint64_t)time(NULL), (atomic_fetch_add(&counter, 1) + 1) ^ hash_secret[2]);
+    return seed;
 }
 //#endregion
 
-bool jcanvas_init(jcanvas* result) 
+bool str_eq(str a, str b)
 {
-    result->edge_cap = 0; result->edge_count = 0; result->node_count = 0; result->node_cap = 0;
-    result->nodes = NULL; result->edges = NULL; result->id_to_edges = (map){0}; result->id_to_nodes = (map){0};
-    bool ok;
-    ok = ensure_capacity(&result->edge_cap, 10, &result->edges, sizeof(jcanvas_edge));
-    if (!ok) { return false; }
-    ok = ensure_capacity(&result->node_cap, 10, &result->nodes, sizeof(jcanvas_node));
-    return ok;
+    if (a.len != b.len) return false;
+    for (uint32_t i = 0; i < a.len; i++) {
+        if (a.data[i] != b.data[i]) return false;
+    }
+    return true;
 }
 
-jcanvas_node* make_node(jcanvas* c, str id)
+static bool map_grow(const jcanvas_allocator* a, map* m, uint32_t new_cap)
 {
-    if (map_get(&c->id_to_nodes, id) != NULL) {
-        c->last_error = "Node with that id already exists";
-        return NULL;
-    }
+    map_slot* slots = a->allocate(a->ctx, new_cap * sizeof(map_slot));
+    if (slots == NULL) return false;
+    for (uint32_t i = 0; i < new_cap; i++) slots[i].value = MAP_EMPTY;
 
-    bool ok = ensure_capacity(&c->node_cap, c->node_count+1, &c->nodes, sizeof(jcanvas_node));
-    if (!ok) return NULL;
-    jcanvas_node* result = &c->nodes[c->node_count++];
-    result->id = id; result->color = (str){0};
-    // somewhat sane defaults
-    result->x = result->y = 0; result->width = result->height = 200;
-    map_set(&c->id_to_nodes, id, result);
-    return result;
+    for (uint32_t i = 0; i < m->cap; i++) {
+        map_slot* old = &m->slots[i];
+        if (old->value == MAP_EMPTY) continue;
+        uint32_t index = old->hash & (new_cap - 1);
+        while (slots[index].value != MAP_EMPTY) index = (index + 1) & (new_cap - 1);
+        slots[index] = *old;
+    }
+    free_array(a, m->slots, m->cap, sizeof(map_slot));
+    m->slots = slots; m->cap = new_cap;
+    return true;
 }
 
-jcanvas_node* jcanvas_text_node_s(jcanvas* c, str id, str content)
+// returns the slot holding key, or the empty slot where it would be inserted
+static map_slot* map_find(map* m, str key, uint64_t hash)
 {
-    jcanvas_node* result = make_node(c, id);
-    result->type = NODE_TYPE_TEXT;
-    result->as.text = content;
-    return result;
+    uint32_t index = hash & (m->cap - 1);
+    while (true) {
+        map_slot* slot = &m->slots[index];
+        if (slot->value == MAP_EMPTY) return slot;
+        if (slot->hash == hash && str_eq(sstr_view(&slot->key), key)) return slot;
+        index = (index + 1) & (m->cap - 1);
+    }
 }
 
-[[always_inline]] jcanvas_node* jcanvas_text_node(jcanvas* c, char* _id, char* _content) 
+// the hash is passed in by the caller, it's cached on nodes and edges so it is computed only once per id
+bool map_get(map* m, str key, uint64_t hash, uint32_t* value)
 {
-    str id = make_str(_id);
-    str content = make_str(_content);
-    return jcanvas_text_node_s(c, id, content);
+    if (m->count == 0) return false;
+    map_slot* slot = map_find(m, key, hash);
+    if (slot->value == MAP_EMPTY) return false;
+    if (value) *value = slot->value;
+    return true;
 }
 
-jcanvas_node* jcanvas_file_node_s(jcanvas* c, str id, str file_path)
+bool map_set(const jcanvas_allocator* a, map* m, sstr key, uint64_t hash, uint32_t value)
 {
-    jcanvas_node* result = make_node(c, id);
-    result->type = NODE_TYPE_FILE;
-    result->as.file.path = file_path;
-    result->as.file.subpath = (str){0};
-    return result;
+    // keep the load factor below 3/4 so probe sequences stay short
+    if ((m->count + 1) * 4 > m->cap * 3) {
+        if (!map_grow(a, m, m->cap == 0 ? 16 : m->cap * 2)) return false;
+    }
+    map_slot* slot = map_find(m, sstr_view(&key), hash);
+    if (slot->value == MAP_EMPTY) {
+        m->count++;
+        slot->hash = hash; slot->key = key;
+    }
+    slot->value = value;
+    return true;
 }
 
-jcanvas_node* jcanvas_file_node(jcanvas* c, char* _id, char* _file_path)
+// makes room for count entries at once, so inserting them never rehashes
+static bool map_reserve(const jcanvas_allocator* a, map* m, uint32_t count)
 {
-    str id = make_str(_id); str file_path = make_str(_file_path);
-    return jcanvas_file_node_s(c, id, file_path);
+    uint32_t cap = m->cap == 0 ? 16 : m->cap;
+    while ((uint64_t)count * 4 > (uint64_t)cap * 3) cap *= 2;
+    return cap == m->cap || map_grow(a, m, cap);
 }
 
-jcanvas_node* jcanvas_link_node_s(jcanvas* c, str id, str link)
+// the map is reserved, so the probe for the duplicate check is also the insert
+static bool map_insert_reserved(map* m, sstr key, uint64_t hash, uint32_t value)
 {
-    jcanvas_node* result = make_node(c, id);
-    result->type = NODE_TYPE_LINK;
-    result->as.link = link;
-    return result;
+    map_slot* slot = map_find(m, sstr_view(&key), hash);
+    if (slot->value != MAP_EMPTY) return false;
+    slot->hash = hash; slot->key = key; slot->value = value;
+    m->count++;
+    return true;
 }
 
-[[always_inline]] jcanvas_node* jcanvas_link_node(jcanvas* c, char* _id, char* _link) 
+// the smallest table that holds count entries below the load factor
+static uint32_t table_fit(uint32_t count)
 {
-    str id = make_str(_id);
-    str link = make_str(_link);
-    return jcanvas_text_node_s(c, id, link);
+    uint32_t cap = 16;
+    while ((uint64_t)count * 4 > (uint64_t)cap * 3) cap *= 2;
+    return cap;
 }
 
-jcanvas_node* jcanvas_group_node_s(jcanvas* c, str id)
+// backward shift deletion: pull later entries of the probe sequence into the hole,
+// so lookups never need tombstones
+bool map_remove(map* m, str key, uint64_t hash)
 {
-    return make_node(c, id);
+    if (m->count == 0) return false;
+    map_slot* slot = map_find(m, key, hash);
+    if (slot->value == MAP_EMPTY) return false;
+
+    uint32_t mask = m->cap - 1;
+    uint32_t hole = (uint32_t)(slot - m->slots);
+    uint32_t i = hole;
+    while (true) {
+        i = (i + 1) & mask;
+        map_slot* next = &m->slots[i];
+        if (next->value == MAP_EMPTY) break;
+        uint32_t home = next->hash & mask;
+        // move the entry only if its home slot doesn't lie cyclically in (hole, i]
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            m->slots[hole] = *next;
+            hole = i;
+        }
+    }
+    m->slots[hole].value = MAP_EMPTY;
+    m->count--;
+    return true;
 }
 
-jcanvas_node* jcanvas_group_node(jcanvas* c, char* _id)
+#define PAIR_SET_EMPTY UINT64_MAX
+
+static uint64_t pair_key(uint32_t from, uint32_t to)
 {
-    str id = make_str(_id);
-    return make_node(c, id);
+    return ((uint64_t)from << 32) | to;
 }
 
-void jcanvas_set_label_s(jcanvas_node* node, str label)
+// splitmix64 finalizer, spreads the packed indices over all bits
+static uint64_t mix64(uint64_t x)
 {
-    if (node->type != NODE_TYPE_GROUP) { return; }
-    node->as.group_node.label = label;
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9;
+    x ^= x >> 27; x *= 0x94d049bb133111eb;
+    x ^= x >> 31;
+    return x;
 }
 
-void jcanvas_set_label(jcanvas_node* node, char* label)
+static bool pair_set_grow(const jcanvas_allocator* a, pair_set* set, uint32_t new_cap)
 {
-    return jcanvas_set_label_s(node, make_str(label));
+    uint64_t* keys = a->allocate(a->ctx, new_cap * sizeof(uint64_t));
+    if (keys == NULL) return false;
+    for (uint32_t i = 0; i < new_cap; i++) keys[i] = PAIR_SET_EMPTY;
+
+    for (uint32_t i = 0; i < set->cap; i++) {
+        uint64_t key = set->keys[i];
+        if (key == PAIR_SET_EMPTY) continue;
+        uint32_t slot = mix64(key) & (new_cap - 1);
+        while (keys[slot] != PAIR_SET_EMPTY) slot = (slot + 1) & (new_cap - 1);
+        keys[slot] = key;
+    }
+    free_array(a, set->keys, set->cap, sizeof(uint64_t));
+    set->keys = keys; set->cap = new_cap;
+    return true;
 }
 
-void jcanvas_set_background_image_s(jcanvas_node* group_node, str path)
+bool pair_set_contains(pair_set* set, uint64_t key)
 {
-    if (group_node->type != NODE_TYPE_GROUP) return;
-    group_node->as.group_node.background = path;
+    if (set->count == 0) return false;
+    uint32_t slot = mix64(key) & (set->cap - 1);
+    while (set->keys[slot] != PAIR_SET_EMPTY) {
+        if (set->keys[slot] == key) return true;
+        slot = (slot + 1) & (set->cap - 1);
+    }
+    return false;
 }
 
-void jcanvas_set_background_image(jcanvas_node* group_node, char* _path)
+// returns false only if the set couldn't grow
+bool pair_set_insert(const jcanvas_allocator* a, pair_set* set, uint64_t key)
 {
-    str path = make_str(_path);
-    return jcanvas_set_background_image_s(group_node, path);
+    // keep the load factor below 3/4 so probe sequences stay short
+    if ((set->count + 1) * 4 > set->cap * 3) {
+        if (!pair_set_grow(a, set, set->cap == 0 ? 16 : set->cap * 2)) return false;
+    }
+    uint32_t slot = mix64(key) & (set->cap - 1);
+    while (set->keys[slot] != PAIR_SET_EMPTY) {
+        if (set->keys[slot] == key) return true;
+        slot = (slot + 1) & (set->cap - 1);
+    }
+    set->keys[slot] = key;
+    set->count++;
+    return true;
 }
-
-void jcanvas_set_background_style(jcanvas_node* group_node, jcanvas_background_style style)
+static bool pair_set_reserve(const jcanvas_allocator* a, pair_set* set, uint32_t count)
 {
-    if (group_node->type != NODE_TYPE_GROUP) return;
-    group_node->as.group_node.background_style = style;
+    uint32_t cap = set->cap == 0 ? 16 : set->cap;
+    while ((uint64_t)count * 4 > (uint64_t)cap * 3) cap *= 2;
+    return cap == set->cap || pair_set_grow(a, set, cap);
 }
 
-void jcanvas_infer_edge_sides(jcanvas_edge* edge, jcanvas_node* a, jcanvas_node* b)
+// same backward shift deletion as map_remove
+void pair_set_remove(pair_set* set, uint64_t key)
 {
-    jcanvas_side from, to;
-    // infer sides
-    if (a->x + a->width/2 < b->x) {
-        if (a->y > b->y + b->height) { // a is below b
-            from = SIDE_TOP; to = SIDE_LEFT;
-        } else if (a->y + a->height <= b->y) { // a is above b
-            from = SIDE_BOTTOM; to = SIDE_LEFT;
-        } else {
-            from = SIDE_RIGHT; to = SIDE_LEFT; // a and b are rougly on the same height
-        }
+    if (set->count == 0) return;
+    uint32_t mask = set->cap - 1;
+    uint32_t hole = mix64(key) & mask;
+    while (set->keys[hole] != key) {
+        if (set->keys[hole] == PAIR_SET_EMPTY) return;
+        hole = (hole + 1) & mask;
     }
-    else if (a->x >= b->x + b->width/2) { // if a is right of b
-        if (a->y > b->y + b->height) { // a is below b
-            from = SIDE_TOP; to = SIDE_RIGHT;
-        } else if (a->y + a->height <= b->y) { // a is above b
-            from = SIDE_BOTTOM; to = SIDE_RIGHT;
-        } else {
-            from = SIDE_LEFT; to = SIDE_RIGHT; // a and b are rougly on the same height
-        }
-    } 
-    else { // a and b are roughly on the same x location
-        if (a->y > b->y + b->height) { // a is below b
-            from = SIDE_TOP; to = SIDE_BOTTOM;
-        } else if (a->y - a->height >= b->y) { // a is above b
-            from = SIDE_BOTTOM; to = SIDE_TOP;
-        } else {
-            // in this case the nodes overlap so we can put arbitrary stuff here
-            from = SIDE_RIGHT; to = SIDE_LEFT; // a and b are rougly on the same height
+    uint32_t i = hole;
+    while (true) {
+        i = (i + 1) & mask;
+        uint64_t next = set->keys[i];
+        if (next == PAIR_SET_EMPTY) break;
+        uint32_t home = mix64(next) & mask;
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            set->keys[hole] = next;
+            hole = i;
         }
     }
-    edge->from_side = from; edge->to_side = to;
+    set->keys[hole] = PAIR_SET_EMPTY;
+    set->count--;
+}
+//#endregion
+
+bool jcanvas_init(jcanvas* result) 
+{
+    return jcanvas_init_with_allocator(result, &default_allocator);
 }
 
-jcanvas_edge* jcanvas_connect_base(jcanvas* c, str id_from, str id_to)
+bool jcanvas_init_with_allocator(jcanvas* result, const jcanvas_allocator* allocator)
 {
-    bool ok = ensure_capacity(&c->edge_cap, c->edge_count+1, &c->edges, sizeof(jcanvas_edge));
-    if (!ok) { 
-        c->last_error = "Not enough memory!";
-        return NULL;
-    }
+    result->allocator = allocator ? *allocator : default_allocator;
+    result->hash_seed = make_hash_seed(result);
+    result->edge_cap = 0; result->edge_count = 0; result->node_count = 0; result->node_cap = 0;
+    result->nodes = NULL; result->edges = NULL; result->id_to_edges = (map){0}; result->id_to_nodes = (map){0};
+    result->edge_pairs = (pair_set){0}; result->allow_multi_edges = false; result->fixed_width_fields = false;
+    result->adjacency = (jcanvas_adjacency){0}; result->bitmaps = (jcanvas_bitmaps){0};
+    result->last_view = (jcanvas_view){0}; result->view_changed = NULL;
+    result->journal = NULL; result->journal_multi_edges = false; result->owned_strings = NULL;
+    result->extras = NULL; result->extra_of = NULL;
+    result->extra_count = result->extra_cap = result->extra_of_cap = 0;
+    result->growth = (jcanvas_growth){ .percent = 50, .max_step = 0 };
+    result->canonical_order = false;
+    bool ok;
+    ok = ensure_capacity(&result->allocator, &result->edge_cap, JCANVAS_MIN_CAPACITY, &result->edges, sizeof(jcanvas_edge));
+    if (!ok) { return false; }
+    ok = ensure_capacity(&result->allocator, &result->node_cap, JCANVAS_MIN_CAPACITY, &result->nodes, sizeof(jcanvas_node));
+    return ok;
+}
 
-    str id = str_concat(id_from, id_to);
-    if (map_get(&c->id_to_edges, id) != NULL) {
-        c->last_error = "Failed to connect edges: Nodes are already connected!"; return NULL;
+static bool node_index(jcanvas* c, jcanvas_node* node, uint32_t* index)
+{
+    if (node < c->nodes || node >= c->nodes + c->node_count) return false;
+    *index = (uint32_t)(node - c->nodes);
+    return true;
+}
+
+jcanvas_color_class jcanvas_classify_color(jcanvas_color color)
+{
+    // presets and hex colors are always inline
+    if (color.raw[15] == SSTR_REF) return COLOR_CUSTOM;
+    if (color.in.len == 0) return COLOR_NONE;
+    if (color.in.len == 1 && color.in.data[0] >= '1' && color.in.data[0] <= '6') return COLOR_RED + (color.in.data[0] - '1');
+    return COLOR_CUSTOM;
+}
+
+#ifdef JCANVAS_COMPACT_NODES
+static int hex_digit(char ch)
+{
+    if (ch >= '0' && ch <= '9') return ch - '0';
+    if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+    if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+    return -1;
+}
+
+// presets keep just their class, custom colors have to be "#rrggbb" to fit next to it
+static bool pack_color(jcanvas_color color, uint32_t* packed)
+{
+    jcanvas_color_class color_class = jcanvas_classify_color(color);
+    if (color_class != COLOR_CUSTOM) { *packed = color_class; return true; }
+    str s = sstr_view(&color);
+    if (s.len != 7 || s.data[0] != '#') return false;
+    uint32_t rgb = 0;
+    for (uint32_t i = 1; i < 7; i++) {
+        int digit = hex_digit(s.data[i]);
+        if (digit < 0) return false;
+        rgb = rgb << 4 | (uint32_t)digit;
     }
+    *packed = rgb << 8 | COLOR_CUSTOM;
+    return true;
+}
+#endif
 
-    jcanvas_edge* result = &c->edges[c->edge_count++];
-    result->from_node = id_from; result->to_node = id_to;
-    result->id = id; result->label = (str){0};
-    result->from_end = result->to_end = 0;
-    map_set(&c->id_to_edges, id, result);
+jcanvas_color jcanvas_get_color(const jcanvas_node* node)
+{
+#ifdef JCANVAS_COMPACT_NODES
+    static const char digits[] = "0123456789abcdef";
+    jcanvas_color result = {0};
+    uint32_t color_class = node->color & 0xff;
+    if (color_class == COLOR_NONE) return result;
+    if (color_class != COLOR_CUSTOM) {
+        result.in.data[0] = '1' + (color_class - COLOR_RED); result.in.len = 1;
+        return result;
+    }
+    result.in.data[0] = '#';
+    for (uint32_t i = 0; i < 6; i++) result.in.data[1 + i] = digits[(node->color >> (28 - 4 * i)) & 0xf];
+    result.in.len = 7;
     return result;
+#else
+    return node->color;
+#endif
 }
 
-jcanvas_edge* jcanvas_connect(jcanvas* c, jcanvas_node* a, jcanvas_node* b)
+static jcanvas_color_class node_color_class(const jcanvas_node* node)
 {
-    if (a == NULL || b == NULL) {
-        c->last_error = "Can't connect NULL nodes!";
-        return NULL;
-    }
-    jcanvas_edge* e = jcanvas_connect_base(c, a->id, b->id);
-    jcanvas_infer_edge_sides(e, a, b);
-    return e;
+#ifdef JCANVAS_COMPACT_NODES
+    return node->color & 0xff;
+#else
+    return jcanvas_classify_color(node->color);
+#endif
 }
 
-jcanvas_edge* jcanvas_connect_by_id(jcanvas* c, str id_from, str id_to)
+static uint64_t node_id_hash(jcanvas* c, const jcanvas_node* node)
 {
-    jcanvas_node* a = map_get(&c->id_to_nodes, id_from);
-    jcanvas_node* b = map_get(&c->id_to_nodes, id_to);
+#ifdef JCANVAS_COMPACT_NODES
+    // compact nodes don't cache it, hashing an inline id again is cheap
+    return jcanvas_hash(sstr_view(&node->id), c->hash_seed);
+#else
+    return node->id_hash;
+#endif
+}
 
-    if (a == NULL) {
-        c->last_error = "Can't connect nodes: node to connect from doesn't exist!"; return NULL;
-    } 
-    if (b == NULL) {
-        c->last_error = "Can't connect nodes: node to connect to doesn't exist!"; return NULL;
+static bool coords_fit(int64_t x, int64_t y, int64_t width, int64_t height)
+{
+    int64_t coords[4] = { x, y, width, height };
+    for (uint32_t i = 0; i < 4; i++) {
+        if (coords[i] < JCANVAS_COORD_MIN || coords[i] > JCANVAS_COORD_MAX) return false;
     }
-    jcanvas_edge* e = jcanvas_connect_base(c, id_from, id_to);
-    jcanvas_infer_edge_sides(e, a, b);
-    return e;
+    return true;
 }
 
-[[always_inline]] void jcanvas_pos_node(jcanvas_node* node, int64_t x, int64_t y, int64_t width, int64_t height)
+static uint64_t* bitmap_set(jcanvas_bitmaps* b, uint32_t set)
 {
-    node->x = x; node->y = y; node->width = width; node->height = height;
+    return &b->bits[(size_t)set * b->words_cap];
 }
 
-void reverse_buf(char* buf, uint32_t len)
+static void bitmap_put(jcanvas_bitmaps* b, uint32_t set, uint32_t index, bool value)
 {
-    char* prev = &buf[29+len];
-    char* new = buf;
-    for (int i = 0; i < len; i++) {
-        *new++ = *prev--;
-    }
+    uint64_t* word = &bitmap_set(b, set)[index / 64];
+    uint64_t bit = (uint64_t)1 << (index % 64);
+    *word = value ? (*word | bit) : (*word & ~bit);
 }
 
-int int_to_str(char* buf, int64_t i)
+static bool bitmap_get(jcanvas_bitmaps* b, uint32_t set, uint32_t index)
 {
-    if (i == 0) { 
-        buf[0] = '0'; buf[1] = 0;
-        return 1; 
+    return (bitmap_set(b, set)[index / 64] >> (index % 64)) & 1;
+}
+
+static bool bitmaps_resize(jcanvas* c, uint32_t words)
+{
+    // the sets are laid out one after another, so they have to be moved apart or together
+    jcanvas_bitmaps* b = &c->bitmaps;
+    const jcanvas_allocator* a = &c->allocator;
+    size_t size = (size_t)JCANVAS_BITMAP_SETS * words * sizeof(uint64_t);
+    uint64_t* bits = a->allocate(a->ctx, size);
+    if (bits == NULL) return false;
+    uint32_t kept = words < b->words_cap ? words : b->words_cap;
+    for (uint32_t set = 0; set < JCANVAS_BITMAP_SETS; set++) {
+        uint64_t* to = &bits[(size_t)set * words];
+        uint32_t i = 0;
+        for (; i < kept; i++) to[i] = bitmap_set(b, set)[i];
+        for (; i < words; i++) to[i] = 0;
     }
-    uint32_t index = 30;
-    bool is_negative = false;
-    if (i < 0) {
-        is_negative = true; 
-        i *= -1;
+    free_array(a, b->bits, JCANVAS_BITMAP_SETS * b->words_cap, sizeof(uint64_t));
+    b->bits = bits; b->words_cap = words;
+    return true;
+}
+
+static bool bitmaps_reserve(jcanvas* c, uint32_t node_cap)
+{
+    uint32_t words = (node_cap + 63) / 64;
+    return words <= c->bitmaps.words_cap || bitmaps_resize(c, words);
+}
+
+static jcanvas_node_extra* node_extra(const jcanvas* c, uint32_t index)
+{
+    if (c->extra_of == NULL || c->extra_of[index] == JCANVAS_NO_EXTRA) return NULL;
+    return &c->extras[c->extra_of[index]];
+}
+
+static void extra_of_clear(jcanvas* c, uint32_t from)
+{
+    for (uint32_t i = from; i < c->extra_of_cap; i++) c->extra_of[i] = JCANVAS_NO_EXTRA;
+}
+
+// extra_of follows node_cap once the first extra exists, canvases without extras never allocate it
+static bool extras_reserve(jcanvas* c, uint32_t node_cap)
+{
+    if (c->extra_of == NULL || node_cap <= c->extra_of_cap) return true;
+    uint32_t old_cap = c->extra_of_cap;
+    if (!ensure_capacity(&c->allocator, &c->extra_of_cap, node_cap, &c->extra_of, sizeof(uint32_t))) return false;
+    extra_of_clear(c, old_cap);
+    return true;
+}
+
+// makes sure adding one extra can't fail anymore
+static bool extras_prepare(jcanvas* c)
+{
+    if (c->extra_of == NULL) {
+        c->extra_of_cap = 0;
+        if (!ensure_capacity(&c->allocator, &c->extra_of_cap, c->node_cap, &c->extra_of, sizeof(uint32_t))) return false;
+        extra_of_clear(c, 0);
     }
-    while (i > 0) {
-        char digit = i % 10;
-        digit += '0';
-        buf[index++] = digit;
-        i /= 10;
+    // starts with room for a few, like the node and edge arrays
+    uint32_t needed = c->extra_count + 1 < 10 ? 10 : c->extra_count + 1;
+    return ensure_capacity(&c->allocator, &c->extra_cap, needed, &c->extras, sizeof(jcanvas_node_extra));
+}
+
+// makes room for count nodes in the node array and the tables kept per node. it grows as c->growth
+// says, or to exactly count if exact
+static bool nodes_reserve(jcanvas* c, uint32_t count, bool exact)
+{
+    if (count > c->node_cap) {
+        uint32_t cap = exact ? count : grown_capacity(c->node_cap, count, c->growth.percent, c->growth.max_step);
+        if (!resize_array(&c->allocator, &c->node_cap, cap, &c->nodes, sizeof(jcanvas_node))) return false;
     }
-    if (is_negative) {
-        buf[index++] = '-';
+    return bitmaps_reserve(c, c->node_cap) && extras_reserve(c, c->node_cap);
+}
+
+static bool edges_reserve(jcanvas* c, uint32_t count, bool exact)
+{
+    if (count <= c->edge_cap) return true;
+    uint32_t cap = exact ? count : grown_capacity(c->edge_cap, count, c->growth.percent, c->growth.max_step);
+    return resize_array(&c->allocator, &c->edge_cap, cap, &c->edges, sizeof(jcanvas_edge));
+}
+
+// makes room for nodes nodes and edges edges in total, so adding up to that many never reallocates
+bool jcanvas_reserve(jcanvas* c, uint32_t nodes, uint32_t edges)
+{
+    const jcanvas_allocator* a = &c->allocator;
+    if (nodes >= MAP_EMPTY || edges >= MAP_EMPTY) {
+        c->last_error = "Too many nodes or edges!";
+        return false;
     }
-    uint32_t len = index-30;
-    reverse_buf(buf, len);
-    buf[len] = 0;
-    return len;
+    bool ok = nodes_reserve(c, nodes, true);
+    if (ok) ok = map_reserve(a, &c->id_to_nodes, nodes);
+    if (ok) ok = edges_reserve(c, edges, true);
+    if (ok) ok = map_reserve(a, &c->id_to_edges, edges);
+    if (ok) ok = pair_set_reserve(a, &c->edge_pairs, edges);
+    if (!ok) c->last_error = "Not enough memory!";
+    return ok;
+}
+
+// gives back the memory the canvas holds beyond what its nodes and edges need. the adjacency index is
+// dropped and rebuilt by the next query
+bool jcanvas_shrink_to_fit(jcanvas* c)
+{
+    const jcanvas_allocator* a = &c->allocator;
+    uint32_t nodes = c->node_count < JCANVAS_MIN_CAPACITY ? JCANVAS_MIN_CAPACITY : c->node_count;
+    uint32_t edges = c->edge_count < JCANVAS_MIN_CAPACITY ? JCANVAS_MIN_CAPACITY : c->edge_count;
+    bool ok = true;
+    if (nodes < c->node_cap) ok = resize_array(a, &c->node_cap, nodes, &c->nodes, sizeof(jcanvas_node));
+    if (ok && edges < c->edge_cap) ok = resize_array(a, &c->edge_cap, edges, &c->edges, sizeof(jcanvas_edge));
+    if (ok && (c->node_cap + 63) / 64 < c->bitmaps.words_cap) ok = bitmaps_resize(c, (c->node_cap + 63) / 64);
+    if (ok && c->extra_of && c->node_cap < c->extra_of_cap) {
+        ok = resize_array(a, &c->extra_of_cap, c->node_cap, &c->extra_of, sizeof(uint32_t));
+    }
+    if (ok && c->extras && c->extra_count < c->extra_cap) {
+        uint32_t extras = c->extra_count == 0 ? 1 : c->extra_count;
+        ok = resize_array(a, &c->extra_cap, extras, &c->extras, sizeof(jcanvas_node_extra));
+    }
+    if (ok && table_fit(c->node_count) < c->id_to_nodes.cap) ok = map_grow(a, &c->id_to_nodes, table_fit(c->node_count));
+    if (ok && table_fit(c->edge_count) < c->id_to_edges.cap) ok = map_grow(a, &c->id_to_edges, table_fit(c->edge_count));
+    if (ok && table_fit(c->edge_pairs.count) < c->edge_pairs.cap) ok = pair_set_grow(a, &c->edge_pairs, table_fit(c->edge_pairs.count));
+
+    jcanvas_adjacency* adj = &c->adjacency;
+    free_array(a, adj->out_start, adj->nodes_cap, sizeof(uint32_t));
+    free_array(a, adj->out_count, adj->nodes_cap, sizeof(uint32_t));
+    free_array(a, adj->in_start, adj->nodes_cap, sizeof(uint32_t));
+    free_array(a, adj->in_count, adj->nodes_cap, sizeof(uint32_t));
+    free_array(a, adj->out_edges, adj->edges_cap, sizeof(uint32_t));
+    free_array(a, adj->in_edges, adj->edges_cap, sizeof(uint32_t));
+    *adj = (jcanvas_adjacency){0};
+    if (!ok) c->last_error = "Not enough memory!";
+    return ok;
+}
+
+static jcanvas_node_extra* node_extra_make(jcanvas* c, uint32_t index)
+{
+    jcanvas_node_extra* extra = node_extra(c, index);
+    if (extra) return extra;
+    if (!extras_prepare(c)) return NULL;
+    extra = &c->extras[c->extra_count];
+    *extra = (jcanvas_node_extra){ .node = index };
+    c->extra_of[index] = c->extra_count++;
+    return extra;
+}
+
+// swap-remove, the last extra takes the freed slot
+static void node_extra_remove(jcanvas* c, uint32_t index)
+{
+    if (node_extra(c, index) == NULL) return;
+    uint32_t slot = c->extra_of[index], last = c->extra_count - 1;
+    c->extra_of[index] = JCANVAS_NO_EXTRA;
+    if (slot != last) {
+        c->extras[slot] = c->extras[last];
+        c->extra_of[c->extras[slot].node] = slot;
+    }
+    c->extra_count--;
+}
+
+//#region journal_records
+#define JOURNAL_MAGIC "JCJ1"
+#define JOURNAL_CHECK_BASIS 2166136261u
+
+enum journal_op {
+    JOURNAL_TEXT_NODE = 1,
+    JOURNAL_TEXT_FILE_NODE,
+    JOURNAL_FILE_NODE,
+    JOURNAL_LINK_NODE,
+    JOURNAL_GROUP_NODE,
+    JOURNAL_POS,
+    JOURNAL_COLOR,
+    JOURNAL_LABEL,
+    JOURNAL_SUBPATH,
+    JOURNAL_BACKGROUND,
+    JOURNAL_BACKGROUND_STYLE,
+    JOURNAL_CONNECT, // an edge made by jcanvas_connect, replaying it makes the same id again
+    JOURNAL_EDGE, // a whole edge with its id, written by compaction
+    JOURNAL_REMOVE_NODE,
+    JOURNAL_REMOVE_EDGE,
+    JOURNAL_EDGE_LABEL,
+    JOURNAL_EDGE_COLOR,
+    JOURNAL_EDGE_ENDS,
+    JOURNAL_MULTI_EDGES, // the value of allow_multi_edges from here on
+};
+
+// records are gathered in buf so a small one is a single fwrite
+typedef struct {
+    FILE* file;
+    uint32_t check, used;
+    uint8_t buf[64];
+} journal_writer;
+
+// fnv-1a, only meant to catch a torn last record
+static uint32_t journal_check(uint32_t check, const uint8_t* data, uint32_t len)
+{
+    for (uint32_t i = 0; i < len; i++) check = (check ^ data[i]) * 16777619u;
+    return check;
+}
+
+static void jw_flush(journal_writer* w)
+{
+    if (w->used > 0) fwrite(w->buf, 1, w->used, w->file);
+    w->used = 0;
+}
+
+static void jw_bytes(journal_writer* w, const void* data, uint32_t len)
+{
+    if (len == 0) return;
+    w->check = journal_check(w->check, data, len);
+    if (len > sizeof(w->buf) - w->used) {
+        jw_flush(w);
+        if (len > sizeof(w->buf)) {
+            fwrite(data, 1, len, w->file);
+            return;
+        }
+    }
+    copy_mem((char*)data, (char*)w->buf + w->used, len);
+    w->used += len;
+}
+
+static void jw_u32(journal_writer* w, uint32_t v)
+{
+    uint8_t b[4] = { (uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16), (uint8_t)(v >> 24) };
+    jw_bytes(w, b, 4);
+}
+
+static void jw_u64(journal_writer* w, uint64_t v)
+{
+    jw_u32(w, (uint32_t)v); jw_u32(w, (uint32_t)(v >> 32));
+}
+
+static void jw_u8(journal_writer* w, uint8_t v)
+{
+    jw_bytes(w, &v, 1);
+}
+
+static void jw_str(journal_writer* w, str s)
+{
+    jw_u32(w, s.len); jw_bytes(w, s.data, s.len);
+}
+
+// a record is the op, the length of the payload, the payload and a check of all three (little endian).
+// write errors stay in the FILE until jcanvas_journal_flush reports them
+static journal_writer journal_begin(FILE* file, uint8_t op, uint32_t len)
+{
+    journal_writer w = { file, JOURNAL_CHECK_BASIS, 0 };
+    jw_u8(&w, op); jw_u32(&w, len);
+    return w;
+}
+
+static void journal_end(journal_writer* w)
+{
+    uint32_t check = w->check;
+    jw_u32(w, check);
+    jw_flush(w);
 }
 
-char buf[50];
-void jcanvas_generate_node(str* result, jcanvas_node* node)
+static void journal_node(FILE* file, const jcanvas_node* node, const jcanvas_node_extra* extra)
 {
-    str_append(result, "{\"id\":\"", 7); str_append_s(result, node->id); 
-    str_append(result, "\",\"type\":\"", 10); str_append_s(result, _type_strings[node->type]);
+    str id = sstr_view(&node->id);
+    journal_writer w;
     switch (node->type) {
         case NODE_TYPE_TEXT: {
-            str_append(result, "\",\"text\":\"", 10); str_append_s(result, node->as.text);
+            if (node->text_in_file) {
+                str path = node->as.text_file.path;
+                w = journal_begin(file, JOURNAL_TEXT_FILE_NODE, 8 + id.len + path.len + 16);
+                jw_str(&w, id); jw_str(&w, path);
+                jw_u64(&w, extra->as.text_file.offset); jw_u64(&w, extra->as.text_file.len);
+            } else {
+                w = journal_begin(file, JOURNAL_TEXT_NODE, 8 + id.len + node->as.text.len);
+                jw_str(&w, id); jw_str(&w, node->as.text);
+            }
         } break;
         case NODE_TYPE_FILE: {
-            str_append(result, "\",\"file\":\"", 10); str_append_s(result, node->as.file.path);
-            if (node->as.file.subpath.len > 0) {
-                str_append(result, "\",\"subpath\":\"", 13); str_append_s(result, node->as.file.subpath);
-            }
+            w = journal_begin(file, JOURNAL_FILE_NODE, 8 + id.len + node->as.file.path.len);
+            jw_str(&w, id); jw_str(&w, node->as.file.path);
         } break;
         case NODE_TYPE_LINK: {
-            str_append(result, "\",\"link\":\"", 10); str_append_s(result, node->as.link);
+            w = journal_begin(file, JOURNAL_LINK_NODE, 8 + id.len + node->as.link.len);
+            jw_str(&w, id); jw_str(&w, node->as.link);
         } break;
-        case NODE_TYPE_GROUP: {
-            if (node->as.group_node.label.len > 0) {
-                str_append(result, "\",\"label\":\"", 11); str_append_s(result, node->as.group_node.label);
-            } 
-            if (node->as.group_node.background.len > 0) {
-                str_append(result, "\",\"background\":\"", 16); str_append_s(result, node->as.group_node.background);
-            }
-            str_append(result, "\",\"backgroundStyle\":\"", 21); str_append_s(result, _background_style_strings[node->as.group_node.background_style]);
+        default: {
+            w = journal_begin(file, JOURNAL_GROUP_NODE, 4 + id.len);
+            jw_str(&w, id);
         } break;
-        default: return; // not implemented yet!
     }
-    char len = int_to_str(buf, node->x);
-    str_append(result, "\",\"x\":\"", 7); str_append(result, buf, len);
-    len = int_to_str(buf, node->y);
-    str_append(result, "\",\"y\":\"", 7); str_append(result, buf, len);
-    len = int_to_str(buf, node->width);
-    str_append(result, "\",\"width\":\"", 11); str_append(result, buf, len);
-    len = int_to_str(buf, node->height);
-    str_append(result, "\",\"height\":\"", 12); str_append(result, buf, len);
-    if (node->color.len > 0) { str_append(result, "\",\"color\":\"", 11); str_append_s(result, node->color); }
-    str_append(result, "\"}", 2);
-} 
+    journal_end(&w);
+}
 
-void jcanvas_generate_edge(str* result, jcanvas_edge* edge)
+static void journal_pos(FILE* file, uint32_t index, const jcanvas_node* node)
 {
-    str_append(result, "{\"id\":\"", 7); str_append_s(result, edge->id);
-    str_append(result, "\",\"fromNode\":\"", 14); str_append_s(result, edge->from_node);
-    str_append(result, "\",\"fromSide\":\"", 14); str_append_s(result, _side_strings[edge->from_side]);
-    str_append(result, "\",\"fromEnd\":\"", 13); str_append_s(result, _end_strings[edge->from_end]);
-    str_append(result, "\",\"toNode\":\"", 12); str_append_s(result, edge->to_node);
-    str_append(result, "\",\"toSide\":\"", 12); str_append_s(result, _side_strings[edge->to_side]);
-    str_append(result, "\",\"toEnd\":\"", 11); str_append_s(result, _end_strings[edge->to_end]);
+    journal_writer w = journal_begin(file, JOURNAL_POS, 4 + 32);
+    jw_u32(&w, index);
+    jw_u64(&w, (uint64_t)(int64_t)node->x); jw_u64(&w, (uint64_t)(int64_t)node->y);
+    jw_u64(&w, (uint64_t)(int64_t)node->width); jw_u64(&w, (uint64_t)(int64_t)node->height);
+    journal_end(&w);
+}
 
-    if (edge->color.len > 0) { str_append(result, "\",\"color\":\"", 11); str_append_s(result, edge->color); }
-    if (edge->label.len > 0) { str_append(result, "\",\"label\":\"", 11); str_append_s(result, edge->label); }
-    
-    str_append(result, "\"}", 2);
+// color, label, subpath and background records, of a node or for the edge ops of an edge
+static void journal_node_str(FILE* file, uint8_t op, uint32_t index, str s)
+{
+    journal_writer w = journal_begin(file, op, 8 + s.len);
+    jw_u32(&w, index); jw_str(&w, s);
+    journal_end(&w);
 }
 
-str jcanvas_generate(jcanvas* c)
+static void journal_background_style(FILE* file, uint32_t index, jcanvas_background_style style)
+{
+    journal_writer w = journal_begin(file, JOURNAL_BACKGROUND_STYLE, 5);
+    jw_u32(&w, index); jw_u8(&w, (uint8_t)style);
+    journal_end(&w);
+}
+
+static void journal_edge_ends(FILE* file, uint32_t index, const jcanvas_edge* edge)
+{
+    journal_writer w = journal_begin(file, JOURNAL_EDGE_ENDS, 6);
+    jw_u32(&w, index); jw_u8(&w, (uint8_t)edge->from_end); jw_u8(&w, (uint8_t)edge->to_end);
+    journal_end(&w);
+}
+
+// allow_multi_edges is a plain field, so it's written before edge records whenever it changed since
+// the last time, otherwise a replay would refuse the second edge between two nodes
+static void journal_multi_edges(jcanvas* c)
+{
+    if (c->journal_multi_edges == c->allow_multi_edges) return;
+    journal_writer w = journal_begin(c->journal, JOURNAL_MULTI_EDGES, 1);
+    jw_u8(&w, c->allow_multi_edges);
+    journal_end(&w);
+    c->journal_multi_edges = c->allow_multi_edges;
+}
+
+static void journal_connect(FILE* file, uint32_t from, uint32_t to)
+{
+    journal_writer w = journal_begin(file, JOURNAL_CONNECT, 8);
+    jw_u32(&w, from); jw_u32(&w, to);
+    journal_end(&w);
+}
+
+static void journal_edge(FILE* file, const jcanvas_edge* edge)
 {
-    str result = str_init(100);
-    str_append(&result, "{\"nodes\":[", 10);
-    for (int i = 0; i < c->node_count; i++) {
-        jcanvas_node* nd = &c->nodes[i];
-        jcanvas_generate_node(&result, nd);
-        str_append(&result, ",", 1);
+    str id = sstr_view(&edge->id), color = sstr_view(&edge->color);
+    journal_writer w = journal_begin(file, JOURNAL_EDGE, 8 + 4 + id.len + 4 + 4 + color.len + 4 + edge->label.len);
+    jw_u32(&w, edge->from_index); jw_u32(&w, edge->to_index); jw_str(&w, id);
+    jw_u8(&w, (uint8_t)edge->from_side); jw_u8(&w, (uint8_t)edge->to_side);
+    jw_u8(&w, (uint8_t)edge->from_end); jw_u8(&w, (uint8_t)edge->to_end);
+    jw_str(&w, color); jw_str(&w, edge->label);
+    journal_end(&w);
+}
+
+// a node with everything set on it, for compaction and bulk inserts
+static void journal_node_state(FILE* file, const jcanvas* c, uint32_t i)
+{
+    const jcanvas_node* node = &c->nodes[i];
+    const jcanvas_node_extra* extra = node_extra(c, i);
+    journal_node(file, node, extra);
+    journal_pos(file, i, node);
+    if (node_color_class(node) != COLOR_NONE) {
+        jcanvas_color color = jcanvas_get_color(node);
+        journal_node_str(file, JOURNAL_COLOR, i, sstr_view(&color));
     }
-    result.len -= 1; // remove trailing comma
-    str_append(&result, "],\"edges\":[", 11);
-    for (int i = 0; i < c->edge_count; i++) {
-        jcanvas_edge* edge = &c->edges[i];
-        jcanvas_generate_edge(&result, edge);
-        str_append(&result, ",", 1);
+    if (node->type == NODE_TYPE_FILE && extra && extra->as.file.subpath.len > 0) {
+        journal_node_str(file, JOURNAL_SUBPATH, i, extra->as.file.subpath);
+    }
+    if (node->type == NODE_TYPE_GROUP) {
+        if (node->as.group_node.label.len > 0) journal_node_str(file, JOURNAL_LABEL, i, node->as.group_node.label);
+        if (extra && extra->as.group_node.background.len > 0) journal_node_str(file, JOURNAL_BACKGROUND, i, extra->as.group_node.background);
+        if (extra && extra->as.group_node.background_style != STYLE_OVER) journal_background_style(file, i, extra->as.group_node.background_style);
+    }
+}
+
+// removal records
+static void journal_index(FILE* file, uint8_t op, uint32_t index)
+{
+    journal_writer w = journal_begin(file, op, 4);
+    jw_u32(&w, index);
+    journal_end(&w);
+}
+//#endregion
+
+#define VIEW_CHUNK 128
+
+static uint32_t view_chunk_count(uint32_t count)
+{
+    return (count + VIEW_CHUNK - 1) / VIEW_CHUNK;
+}
+
+static uint32_t view_changed_words(const jcanvas_view* v)
+{
+    return (view_chunk_count(v->node_count) + view_chunk_count(v->edge_count) + 63) / 64;
+}
+
+// marks the chunks of the last snapshot holding nodes begin to end - 1 as changed, so the next snapshot
+// copies them instead of sharing them. nodes past the last snapshot are in new chunks anyway
+static void view_nodes_changed(jcanvas* c, uint32_t begin, uint32_t end)
+{
+    uint32_t chunks = view_chunk_count(c->last_view.node_count);
+    for (uint32_t k = begin / VIEW_CHUNK; k < chunks && k * VIEW_CHUNK < end; k++) c->view_changed[k / 64] |= 1ull << (k % 64);
+}
+
+// the bits of the edge chunks follow the ones of the node chunks
+static void view_edges_changed(jcanvas* c, uint32_t begin, uint32_t end)
+{
+    uint32_t node_chunks = view_chunk_count(c->last_view.node_count), chunks = view_chunk_count(c->last_view.edge_count);
+    for (uint32_t k = begin / VIEW_CHUNK; k < chunks && k * VIEW_CHUNK < end; k++) {
+        c->view_changed[(node_chunks + k) / 64] |= 1ull << ((node_chunks + k) % 64);
+    }
+}
+
+// view_edges_changed for functions that may run on several threads for disjoint edge ranges. one word holds
+// the bits of 64 chunks, so neighbouring ranges share words and have to set their bits atomically
+static void view_edges_changed_shared(jcanvas* c, uint32_t begin, uint32_t end)
+{
+    uint32_t node_chunks = view_chunk_count(c->last_view.node_count), chunks = view_chunk_count(c->last_view.edge_count);
+    uint32_t last = view_chunk_count(end) < chunks ? view_chunk_count(end) : chunks;
+    for (uint32_t k = begin / VIEW_CHUNK; k < last;) {
+        uint32_t bit = node_chunks + k, word = bit / 64;
+        uint32_t upto = last - k < 64 - bit % 64 ? bit % 64 + (last - k) : 64;
+        uint64_t bits = (upto == 64 ? UINT64_MAX : (1ull << upto) - 1) & ~((1ull << (bit % 64)) - 1);
+        atomic_fetch_or((_Atomic uint64_t*)&c->view_changed[word], bits);
+        k += upto - bit % 64;
+    }
+}
+
+// for fields that were written directly, like edge->label
+void jcanvas_node_changed(jcanvas* c, const jcanvas_node* node)
+{
+    if (node >= c->nodes && node < c->nodes + c->node_count) view_nodes_changed(c, (uint32_t)(node - c->nodes), (uint32_t)(node - c->nodes) + 1);
+}
+
+void jcanvas_edge_changed(jcanvas* c, const jcanvas_edge* edge)
+{
+    if (edge >= c->edges && edge < c->edges + c->edge_count) view_edges_changed(c, (uint32_t)(edge - c->edges), (uint32_t)(edge - c->edges) + 1);
+}
+
+#define TYPE_SET(type) ((uint32_t)(type))
+#define COLOR_SET(color_class) (NODE_TYPE_GROUP + 1 + (uint32_t)(color_class))
+
+// hash is the hash of id with c's seed
+static jcanvas_node* make_node_hashed(jcanvas* c, str id, uint64_t hash, enum jcanvas_node_type type)
+{
+    if (map_get(&c->id_to_nodes, id, hash, NULL)) {
+        c->last_error = "Node with that id already exists";
+        return NULL;
     }
-    result.len-=1;
-    str_append(&result, "]}\0", 3); // null terminator for printing
+
+    bool ok = nodes_reserve(c, c->node_count+1, false);
+    if (ok) ok = map_set(&c->allocator, &c->id_to_nodes, make_sstr(id), hash, c->node_count);
+    if (!ok) {
+        c->last_error = "Not enough memory!";
+        return NULL;
+    }
+    bitmap_put(&c->bitmaps, TYPE_SET(type), c->node_count, true);
+    bitmap_put(&c->bitmaps, COLOR_SET(COLOR_NONE), c->node_count, true);
+    view_nodes_changed(c, c->node_count, c->node_count + 1);
+    jcanvas_node* result = &c->nodes[c->node_count++];
+    c->adjacency.valid = false;
+    result->id = make_sstr(id); result->type = type; result->text_in_file = false;
+#ifdef JCANVAS_COMPACT_NODES
+    result->color = COLOR_NONE;
+#else
+    result->id_hash = hash; result->color = (sstr){0};
+#endif
+    // somewhat sane defaults
+    result->x = result->y = 0; result->width = result->height = 200;
     return result;
 }
 
-// TODO: implement properly
-void jcanvas_destroy(jcanvas* c)
+jcanvas_node* make_node(jcanvas* c, str id, enum jcanvas_node_type type)
+{
+    return make_node_hashed(c, id, jcanvas_hash(id, c->hash_seed), type);
+}
+
+jcanvas_node* jcanvas_text_node_s(jcanvas* c, str id, str content)
+{
+    jcanvas_node* result = make_node(c, id, NODE_TYPE_TEXT);
+    if (result == NULL) return NULL;
+    result->as.text = content;
+    if (c->journal) journal_node(c->journal, result, NULL);
+    return result;
+}
+
+[[always_inline]] jcanvas_node* jcanvas_text_node(jcanvas* c, char* _id, char* _content) 
+{
+    str id = make_str(_id);
+    str content = make_str(_content);
+    return jcanvas_text_node_s(c, id, content);
+}
+
+// the content isn't read until the canvas is generated, path and the file have to stay valid until then
+jcanvas_node* jcanvas_text_node_from_file_s(jcanvas* c, str id, str path, uint64_t offset, uint64_t len)
 {
-    if (c->nodes) {
-        FREE(c->nodes);
+    // room for the extra is made first, so there's no half made node to undo
+    if (!extras_prepare(c)) {
+        c->last_error = "Not enough memory!";
+        return NULL;
     }
-    if (c->edges) {
-        FREE(c->edges);
+    jcanvas_node* result = make_node(c, id, NODE_TYPE_TEXT);
+    if (result == NULL) return NULL;
+    jcanvas_node_extra* extra = node_extra_make(c, c->node_count - 1);
+    result->text_in_file = true;
+    result->as.text_file.path = path;
+    extra->as.text_file.offset = offset; extra->as.text_file.len = len;
+    if (c->journal) journal_node(c->journal, result, extra);
+    return result;
+}
+
+jcanvas_node* jcanvas_text_node_from_file(jcanvas* c, char* _id, char* _path, uint64_t offset, uint64_t len)
+{
+    str id = make_str(_id); str path = make_str(_path);
+    return jcanvas_text_node_from_file_s(c, id, path, offset, len);
+}
+
+jcanvas_node* jcanvas_file_node_s(jcanvas* c, str id, str file_path)
+{
+    jcanvas_node* result = make_node(c, id, NODE_TYPE_FILE);
+    if (result == NULL) return NULL;
+    result->as.file.path = file_path;
+    if (c->journal) journal_node(c->journal, result, NULL);
+    return result;
+}
+
+jcanvas_node* jcanvas_file_node(jcanvas* c, char* _id, char* _file_path)
+{
+    str id = make_str(_id); str file_path = make_str(_file_path);
+    return jcanvas_file_node_s(c, id, file_path);
+}
+
+jcanvas_node* jcanvas_link_node_s(jcanvas* c, str id, str link)
+{
+    jcanvas_node* result = make_node(c, id, NODE_TYPE_LINK);
+    if (result == NULL) return NULL;
+    result->as.link = link;
+    if (c->journal) journal_node(c->journal, result, NULL);
+    return result;
+}
+
+[[always_inline]] jcanvas_node* jcanvas_link_node(jcanvas* c, char* _id, char* _link) 
+{
+    str id = make_str(_id);
+    str link = make_str(_link);
+    return jcanvas_text_node_s(c, id, link);
+}
+
+jcanvas_node* jcanvas_group_node_s(jcanvas* c, str id)
+{
+    jcanvas_node* result = make_node(c, id, NODE_TYPE_GROUP);
+    if (result == NULL) return NULL;
+    result->as.group_node.label = (str){0};
+    if (c->journal) journal_node(c->journal, result, NULL);
+    return result;
+}
+
+jcanvas_node* jcanvas_group_node(jcanvas* c, char* _id)
+{
+    str id = make_str(_id);
+    return jcanvas_group_node_s(c, id);
+}
+
+// keeps the color bitmaps of jcanvas_query_nodes up to date, prefer it over assigning node->color
+bool jcanvas_set_color(jcanvas* c, jcanvas_node* node, jcanvas_color color)
+{
+    uint32_t index;
+    if (!node_index(c, node, &index)) {
+        c->last_error = "Node doesn't belong to this canvas!";
+        return false;
+    }
+#ifdef JCANVAS_COMPACT_NODES
+    uint32_t packed;
+    if (!pack_color(color, &packed)) {
+        c->last_error = "Compact nodes only support preset and #rrggbb colors!";
+        return false;
+    }
+#endif
+    bitmap_put(&c->bitmaps, COLOR_SET(node_color_class(node)), index, false);
+    bitmap_put(&c->bitmaps, COLOR_SET(jcanvas_classify_color(color)), index, true);
+#ifdef JCANVAS_COMPACT_NODES
+    node->color = packed;
+#else
+    node->color = color;
+#endif
+    view_nodes_changed(c, index, index + 1);
+    if (c->journal) journal_node_str(c->journal, JOURNAL_COLOR, index, sstr_view(&color));
+    return true;
+}
+
+const jcanvas_node_extra* jcanvas_get_extra(jcanvas* c, jcanvas_node* node)
+{
+    uint32_t index;
+    if (!node_index(c, node, &index)) return NULL;
+    return node_extra(c, index);
+}
+
+static jcanvas_node_extra* extra_of_type(jcanvas* c, jcanvas_node* node, enum jcanvas_node_type type)
+{
+    uint32_t index;
+    if (!node_index(c, node, &index) || node->type != type) {
+        c->last_error = "Node doesn't belong to this canvas or has the wrong type!";
+        return NULL;
+    }
+    jcanvas_node_extra* extra = node_extra_make(c, index);
+    if (extra == NULL) c->last_error = "Not enough memory!";
+    else view_nodes_changed(c, index, index + 1);
+    return extra;
+}
+
+bool jcanvas_set_label_s(jcanvas* c, jcanvas_node* group_node, str label)
+{
+    uint32_t index;
+    if (!node_index(c, group_node, &index) || group_node->type != NODE_TYPE_GROUP) {
+        c->last_error = "Node doesn't belong to this canvas or has the wrong type!";
+        return false;
+    }
+    group_node->as.group_node.label = label;
+    view_nodes_changed(c, index, index + 1);
+    if (c->journal) journal_node_str(c->journal, JOURNAL_LABEL, index, label);
+    return true;
+}
+
+bool jcanvas_set_label(jcanvas* c, jcanvas_node* group_node, char* label)
+{
+    return jcanvas_set_label_s(c, group_node, make_str(label));
+}
+
+bool jcanvas_set_subpath_s(jcanvas* c, jcanvas_node* file_node, str subpath)
+{
+    jcanvas_node_extra* extra = extra_of_type(c, file_node, NODE_TYPE_FILE);
+    if (extra == NULL) return false;
+    extra->as.file.subpath = subpath;
+    if (c->journal) journal_node_str(c->journal, JOURNAL_SUBPATH, extra->node, subpath);
+    return true;
+}
+
+bool jcanvas_set_subpath(jcanvas* c, jcanvas_node* file_node, char* _subpath)
+{
+    str subpath = make_str(_subpath);
+    return jcanvas_set_subpath_s(c, file_node, subpath);
+}
+
+bool jcanvas_set_background_image_s(jcanvas* c, jcanvas_node* group_node, str path)
+{
+    jcanvas_node_extra* extra = extra_of_type(c, group_node, NODE_TYPE_GROUP);
+    if (extra == NULL) return false;
+    extra->as.group_node.background = path;
+    if (c->journal) journal_node_str(c->journal, JOURNAL_BACKGROUND, extra->node, path);
+    return true;
+}
+
+bool jcanvas_set_background_image(jcanvas* c, jcanvas_node* group_node, char* _path)
+{
+    str path = make_str(_path);
+    return jcanvas_set_background_image_s(c, group_node, path);
+}
+
+bool jcanvas_set_background_style(jcanvas* c, jcanvas_node* group_node, jcanvas_background_style style)
+{
+    jcanvas_node_extra* extra = extra_of_type(c, group_node, NODE_TYPE_GROUP);
+    if (extra == NULL) return false;
+    extra->as.group_node.background_style = style;
+    if (c->journal) journal_background_style(c->journal, extra->node, style);
+    return true;
+}
+
+// sides by where a is relative to b, indexed by column * 3 + row. columns: a left of b, a right of b,
+// roughly the same x. rows: a below b, a above b, roughly the same height.
+// packed as from | to << 4, overlapping nodes get right -> left
+static const uint8_t _side_table[9] = {
+    SIDE_TOP | SIDE_LEFT << 4,    SIDE_BOTTOM | SIDE_LEFT << 4,  SIDE_RIGHT | SIDE_LEFT << 4,
+    SIDE_TOP | SIDE_RIGHT << 4,   SIDE_BOTTOM | SIDE_RIGHT << 4, SIDE_LEFT | SIDE_RIGHT << 4,
+    SIDE_TOP | SIDE_BOTTOM << 4,  SIDE_BOTTOM | SIDE_TOP << 4,   SIDE_RIGHT | SIDE_LEFT << 4,
+};
+
+// branch free, so a batch of edges compiles to vector compares. 64 bit math, so compact
+// nodes' int32 coordinates can't overflow
+static uint8_t side_index(int64_t ax, int64_t ay, int64_t aw, int64_t ah, int64_t bx, int64_t by, int64_t bw, int64_t bh)
+{
+    uint8_t left = ax + aw / 2 < bx;
+    uint8_t right = ax >= bx + bw / 2;
+    uint8_t below = ay > by + bh;
+    uint8_t above = ay + ah <= by;
+    uint8_t column = 2 - 2 * left - (right & !left);
+    uint8_t row = 2 - 2 * below - (above & !below);
+    return column * 3 + row;
+}
+
+void jcanvas_infer_edge_sides(jcanvas_edge* edge, jcanvas_node* a, jcanvas_node* b)
+{
+    uint8_t sides = _side_table[side_index(a->x, a->y, a->width, a->height, b->x, b->y, b->width, b->height)];
+    edge->from_side = sides & 0xf; edge->to_side = sides >> 4;
+}
+
+#define SIDES_BATCH 256
+#define SIDES_PREFETCH_DISTANCE 16
+
+// only reads nodes and writes the sides of edges in [begin, end), so disjoint ranges can run on
+// different threads. the endpoints are gathered into arrays per batch to keep the compare loop free
+// of the indirection through from_index/to_index
+void jcanvas_infer_edge_sides_range(jcanvas* c, uint32_t begin, uint32_t end)
+{
+    int64_t ax[SIDES_BATCH], ay[SIDES_BATCH], aw[SIDES_BATCH], ah[SIDES_BATCH];
+    int64_t bx[SIDES_BATCH], by[SIDES_BATCH], bw[SIDES_BATCH], bh[SIDES_BATCH];
+    uint8_t index[SIDES_BATCH];
+    if (end > c->edge_count) end = c->edge_count;
+    for (uint32_t first = begin; first < end; first += SIDES_BATCH) {
+        uint32_t n = end - first < SIDES_BATCH ? end - first : SIDES_BATCH;
+        for (uint32_t i = 0; i < n; i++) {
+            // the endpoints are usually all over the node array
+            if (first + i + SIDES_PREFETCH_DISTANCE < end) {
+                const jcanvas_edge* ahead = &c->edges[first + i + SIDES_PREFETCH_DISTANCE];
+                PREFETCH(&c->nodes[ahead->from_index]); PREFETCH(&c->nodes[ahead->to_index]);
+            }
+            const jcanvas_node* a = &c->nodes[c->edges[first + i].from_index];
+            const jcanvas_node* b = &c->nodes[c->edges[first + i].to_index];
+            ax[i] = a->x; ay[i] = a->y; aw[i] = a->width; ah[i] = a->height;
+            bx[i] = b->x; by[i] = b->y; bw[i] = b->width; bh[i] = b->height;
+        }
+        for (uint32_t i = 0; i < n; i++) index[i] = side_index(ax[i], ay[i], aw[i], ah[i], bx[i], by[i], bw[i], bh[i]);
+        for (uint32_t i = 0; i < n; i++) {
+            uint8_t sides = _side_table[index[i]];
+            c->edges[first + i].from_side = sides & 0xf; c->edges[first + i].to_side = sides >> 4;
+        }
+    }
+    if (begin < end) view_edges_changed_shared(c, begin, end);
+}
+
+// e.g. after moving nodes around
+void jcanvas_infer_all_edge_sides(jcanvas* c)
+{
+    jcanvas_infer_edge_sides_range(c, 0, c->edge_count);
+}
+
+// long edge ids are allocated by make_edge_id with room for a terminating zero
+static void edge_id_free(const jcanvas_allocator* a, sstr* id)
+{
+    if (id->raw[15] == SSTR_REF && id->ref.data) a->free(a->ctx, id->ref.data, (size_t)id->ref.len + 1);
+    *id = (sstr){0};
+}
+
+// the concatenated ids are ambiguous ("ab"+"c" vs "a"+"bc") and multi-edges share the same pair,
+// so a running number is appended as long as the id is already taken
+static str make_edge_id(jcanvas* c, str id_from, str id_to, uint64_t* hash)
+{
+    const jcanvas_allocator* a = &c->allocator;
+    str base = str_concat(a, id_from, id_to);
+    if (base.data == NULL) return base;
+    str id = base;
+    uint32_t n = c->edge_count;
+    while (map_get(&c->id_to_edges, id, *hash = jcanvas_hash(id, c->hash_seed), NULL)) {
+        if (id.data != base.data) str_free(a, &id);
+        char num[50];
+        int len = int_to_str(num, n++);
+        id = str_init(a, base.len + len + 2);
+        if (id.data == NULL) break;
+        str_append_s(a, &id, base); str_append(a, &id, "#", 1); str_append(a, &id, num, len);
+        id.data[id.len] = 0;
+    }
+    if (id.data != base.data) str_free(a, &base);
+    return id;
+}
+
+// the id is made from the node ids, unless one is given (replaying a journal), which is copied
+static jcanvas_edge* connect_with_id(jcanvas* c, uint32_t from, uint32_t to, str given_id)
+{
+    uint64_t key = pair_key(from, to);
+    if (!c->allow_multi_edges && pair_set_contains(&c->edge_pairs, key)) {
+        c->last_error = "Failed to connect edges: Nodes are already connected!"; return NULL;
+    }
+
+    uint64_t hash;
+    str id;
+    if (given_id.len == 0) id = make_edge_id(c, sstr_view(&c->nodes[from].id), sstr_view(&c->nodes[to].id), &hash);
+    else {
+        hash = jcanvas_hash(given_id, c->hash_seed);
+        if (map_get(&c->id_to_edges, given_id, hash, NULL)) {
+            c->last_error = "Edge with that id already exists"; return NULL;
+        }
+        id = str_concat(&c->allocator, given_id, (str){0});
+    }
+    bool ok = id.data != NULL;
+    // a short id is copied inline and its buffer dropped right away, a long one stays owned by the edge
+    sstr edge_id = make_sstr(id);
+    if (ok && id.len <= SSTR_INLINE_CAP) str_free(&c->allocator, &id);
+    if (ok) ok = edges_reserve(c, c->edge_count+1, false);
+    if (ok) ok = map_set(&c->allocator, &c->id_to_edges, edge_id, hash, c->edge_count);
+    if (ok) ok = pair_set_insert(&c->allocator, &c->edge_pairs, key);
+    if (!ok) { 
+        edge_id_free(&c->allocator, &edge_id);
+        c->last_error = "Not enough memory!";
+        return NULL;
+    }
+
+    view_edges_changed(c, c->edge_count, c->edge_count + 1);
+    jcanvas_edge* result = &c->edges[c->edge_count++];
+    result->from_node = c->nodes[from].id; result->to_node = c->nodes[to].id;
+    result->id = edge_id; result->id_hash = hash; result->label = (str){0}; result->color = (sstr){0};
+    result->from_end = result->to_end = 0;
+    result->from_index = from; result->to_index = to;
+    c->adjacency.valid = false;
+    return result;
+}
+
+jcanvas_edge* jcanvas_connect_base(jcanvas* c, uint32_t from, uint32_t to)
+{
+    return connect_with_id(c, from, to, (str){0});
+}
+
+jcanvas_edge* jcanvas_connect(jcanvas* c, jcanvas_node* a, jcanvas_node* b)
+{
+    if (a == NULL || b == NULL) {
+        c->last_error = "Can't connect NULL nodes!";
+        return NULL;
+    }
+    uint32_t from, to;
+    if (!node_index(c, a, &from) || !node_index(c, b, &to)) {
+        c->last_error = "Can't connect nodes: node doesn't belong to this canvas!";
+        return NULL;
+    }
+    jcanvas_edge* e = jcanvas_connect_base(c, from, to);
+    if (e == NULL) return NULL;
+    jcanvas_infer_edge_sides(e, a, b);
+    if (c->journal) {
+        journal_multi_edges(c);
+        journal_connect(c->journal, from, to);
+    }
+    return e;
+}
+
+jcanvas_edge* jcanvas_connect_by_id(jcanvas* c, str id_from, str id_to)
+{
+    uint32_t a, b;
+    if (!map_get(&c->id_to_nodes, id_from, jcanvas_hash(id_from, c->hash_seed), &a)) {
+        c->last_error = "Can't connect nodes: node to connect from doesn't exist!"; return NULL;
+    } 
+    if (!map_get(&c->id_to_nodes, id_to, jcanvas_hash(id_to, c->hash_seed), &b)) {
+        c->last_error = "Can't connect nodes: node to connect to doesn't exist!"; return NULL;
+    }
+    return jcanvas_connect(c, &c->nodes[a], &c->nodes[b]);
+}
+
+static bool edge_index(jcanvas* c, jcanvas_edge* edge, uint32_t* index)
+{
+    if (edge < c->edges || edge >= c->edges + c->edge_count) {
+        c->last_error = "Edge doesn't belong to this canvas!";
+        return false;
+    }
+    *index = (uint32_t)(edge - c->edges);
+    return true;
+}
+
+// the edge setters, unlike writing the fields directly, are journaled and seen by the next snapshot
+bool jcanvas_set_edge_label_s(jcanvas* c, jcanvas_edge* edge, str label)
+{
+    uint32_t index;
+    if (!edge_index(c, edge, &index)) return false;
+    edge->label = label;
+    view_edges_changed(c, index, index + 1);
+    if (c->journal) journal_node_str(c->journal, JOURNAL_EDGE_LABEL, index, label);
+    return true;
+}
+
+bool jcanvas_set_edge_label(jcanvas* c, jcanvas_edge* edge, char* label)
+{
+    return jcanvas_set_edge_label_s(c, edge, make_str(label));
+}
+
+bool jcanvas_set_edge_color(jcanvas* c, jcanvas_edge* edge, jcanvas_color color)
+{
+    uint32_t index;
+    if (!edge_index(c, edge, &index)) return false;
+    edge->color = color;
+    view_edges_changed(c, index, index + 1);
+    if (c->journal) journal_node_str(c->journal, JOURNAL_EDGE_COLOR, index, sstr_view(&color));
+    return true;
+}
+
+bool jcanvas_set_edge_ends(jcanvas* c, jcanvas_edge* edge, jcanvas_end from_end, jcanvas_end to_end)
+{
+    uint32_t index;
+    if (!edge_index(c, edge, &index)) return false;
+    edge->from_end = from_end; edge->to_end = to_end;
+    view_edges_changed(c, index, index + 1);
+    if (c->journal) journal_edge_ends(c->journal, index, edge);
+    return true;
+}
+
+static bool adjacency_build(jcanvas* c)
+{
+    jcanvas_adjacency* adj = &c->adjacency;
+    if (adj->valid) return true;
+
+    // size by the canvas capacity so adding a few nodes doesn't reallocate every rebuild
+    const jcanvas_allocator* a = &c->allocator;
+    uint32_t nodes_cap = adj->nodes_cap;
+    bool ok = ensure_capacity2(a, &nodes_cap, c->node_cap, &adj->out_start, &adj->out_count, sizeof(uint32_t));
+    if (ok) ok = ensure_capacity2(a, &adj->nodes_cap, c->node_cap, &adj->in_start, &adj->in_count, sizeof(uint32_t));
+    if (ok) ok = ensure_capacity2(a, &adj->edges_cap, c->edge_cap, &adj->out_edges, &adj->in_edges, sizeof(uint32_t));
+    if (!ok) {
+        c->last_error = "Not enough memory!";
+        return false;
+    }
+
+    // counting sort: count degrees, prefix sum into the starts, then scatter the edge indices
+    uint32_t n = c->node_count;
+    for (uint32_t i = 0; i < n; i++) adj->out_count[i] = adj->in_count[i] = 0;
+    for (uint32_t i = 0; i < c->edge_count; i++) {
+        adj->out_count[c->edges[i].from_index]++;
+        adj->in_count[c->edges[i].to_index]++;
+    }
+    uint32_t out_sum = 0, in_sum = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        adj->out_start[i] = out_sum; out_sum += adj->out_count[i]; adj->out_count[i] = 0;
+        adj->in_start[i] = in_sum; in_sum += adj->in_count[i]; adj->in_count[i] = 0;
+    }
+    for (uint32_t i = 0; i < c->edge_count; i++) {
+        uint32_t from = c->edges[i].from_index, to = c->edges[i].to_index;
+        adj->out_edges[adj->out_start[from] + adj->out_count[from]++] = i;
+        adj->in_edges[adj->in_start[to] + adj->in_count[to]++] = i;
+    }
+    adj->valid = true;
+    return true;
+}
+
+static uint32_t adjacency_list(jcanvas* c, jcanvas_node* node, const uint32_t** edges, bool out)
+{
+    uint32_t index;
+    if (!node_index(c, node, &index)) {
+        c->last_error = "Node doesn't belong to this canvas!";
+        return 0;
+    }
+    if (!adjacency_build(c)) return 0;
+    jcanvas_adjacency* adj = &c->adjacency;
+    if (edges) *edges = out ? &adj->out_edges[adj->out_start[index]] : &adj->in_edges[adj->in_start[index]];
+    return out ? adj->out_count[index] : adj->in_count[index];
+}
+
+uint32_t jcanvas_out_edges(jcanvas* c, jcanvas_node* node, const uint32_t** edges)
+{
+    return adjacency_list(c, node, edges, true);
+}
+
+uint32_t jcanvas_in_edges(jcanvas* c, jcanvas_node* node, const uint32_t** edges)
+{
+    return adjacency_list(c, node, edges, false);
+}
+
+uint32_t jcanvas_out_degree(jcanvas* c, jcanvas_node* node)
+{
+    return adjacency_list(c, node, NULL, true);
+}
+
+uint32_t jcanvas_in_degree(jcanvas* c, jcanvas_node* node)
+{
+    return adjacency_list(c, node, NULL, false);
+}
+
+// replaces the first occurrence of value in list[0..count] and returns its position
+static uint32_t list_replace(uint32_t* list, uint32_t count, uint32_t value, uint32_t new_value)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        if (list[i] == value) { list[i] = new_value; return i; }
+    }
+    return count;
+}
+
+static void list_remove(uint32_t* list, uint32_t* count, uint32_t value)
+{
+    uint32_t i = list_replace(list, *count, value, list[*count - 1]);
+    if (i < *count) (*count)--;
+}
+
+static void remove_edge_at(jcanvas* c, uint32_t index)
+{
+    jcanvas_adjacency* adj = &c->adjacency;
+    jcanvas_edge* edge = &c->edges[index];
+    uint32_t from = edge->from_index, to = edge->to_index;
+
+    list_remove(&adj->out_edges[adj->out_start[from]], &adj->out_count[from], index);
+    list_remove(&adj->in_edges[adj->in_start[to]], &adj->in_count[to], index);
+
+    // with multi-edges the pair stays taken as long as another edge connects the same nodes
+    bool pair_still_used = false;
+    if (c->allow_multi_edges) {
+        uint32_t* out = &adj->out_edges[adj->out_start[from]];
+        for (uint32_t i = 0; i < adj->out_count[from]; i++) {
+            if (c->edges[out[i]].to_index == to) { pair_still_used = true; break; }
+        }
+    }
+    if (!pair_still_used) pair_set_remove(&c->edge_pairs, pair_key(from, to));
+
+    map_remove(&c->id_to_edges, sstr_view(&edge->id), edge->id_hash);
+    edge_id_free(&c->allocator, &edge->id);
+
+    // swap-remove: move the last edge into the hole and repoint everything referring to it
+    uint32_t last = c->edge_count - 1;
+    view_edges_changed(c, index, index + 1);
+    if (index != last) {
+        *edge = c->edges[last];
+        map_set(&c->allocator, &c->id_to_edges, edge->id, edge->id_hash, index);
+        list_replace(&adj->out_edges[adj->out_start[edge->from_index]], adj->out_count[edge->from_index], last, index);
+        list_replace(&adj->in_edges[adj->in_start[edge->to_index]], adj->in_count[edge->to_index], last, index);
+    }
+    c->edge_count--;
+}
+
+bool jcanvas_remove_edge(jcanvas* c, jcanvas_edge* edge)
+{
+    if (edge == NULL || edge < c->edges || edge >= c->edges + c->edge_count) {
+        c->last_error = "Can't remove edge: edge doesn't belong to this canvas!";
+        return false;
+    }
+    if (!adjacency_build(c)) return false;
+    if (c->journal) journal_index(c->journal, JOURNAL_REMOVE_EDGE, (uint32_t)(edge - c->edges));
+    remove_edge_at(c, (uint32_t)(edge - c->edges));
+    return true;
+}
+
+// costs O(1 + degree of the removed node + degree of the node moved into its slot)
+bool jcanvas_remove_node(jcanvas* c, jcanvas_node* node)
+{
+    uint32_t index;
+    if (node == NULL || !node_index(c, node, &index)) {
+        c->last_error = "Can't remove node: node doesn't belong to this canvas!";
+        return false;
+    }
+    if (!adjacency_build(c)) return false;
+    if (c->journal) journal_index(c->journal, JOURNAL_REMOVE_NODE, index);
+    jcanvas_adjacency* adj = &c->adjacency;
+
+    while (adj->out_count[index] > 0) {
+        remove_edge_at(c, adj->out_edges[adj->out_start[index]]);
+    }
+    while (adj->in_count[index] > 0) {
+        remove_edge_at(c, adj->in_edges[adj->in_start[index]]);
+    }
+    map_remove(&c->id_to_nodes, sstr_view(&node->id), node_id_hash(c, node));
+    node_extra_remove(c, index);
+
+    uint32_t last = c->node_count - 1;
+    view_nodes_changed(c, index, index + 1);
+    for (uint32_t set = 0; set < JCANVAS_BITMAP_SETS; set++) {
+        bitmap_put(&c->bitmaps, set, index, bitmap_get(&c->bitmaps, set, last));
+        bitmap_put(&c->bitmaps, set, last, false);
+    }
+    if (index != last) {
+        *node = c->nodes[last];
+        map_set(&c->allocator, &c->id_to_nodes, node->id, node_id_hash(c, node), index);
+        if (c->extra_of) {
+            c->extra_of[index] = c->extra_of[last]; c->extra_of[last] = JCANVAS_NO_EXTRA;
+            if (c->extra_of[index] != JCANVAS_NO_EXTRA) c->extras[c->extra_of[index]].node = index;
+        }
+        adj->out_start[index] = adj->out_start[last]; adj->out_count[index] = adj->out_count[last];
+        adj->in_start[index] = adj->in_start[last]; adj->in_count[index] = adj->in_count[last];
+
+        // the edges of the moved node now point to the new slot, rekey their pairs one edge at a time
+        // (a self loop is visited twice, which rekeys (last,last) -> (index,last) -> (index,index))
+        for (uint32_t i = 0; i < adj->out_count[index]; i++) {
+            jcanvas_edge* e = &c->edges[adj->out_edges[adj->out_start[index] + i]];
+            pair_set_remove(&c->edge_pairs, pair_key(e->from_index, e->to_index));
+            jcanvas_edge_changed(c, e);
+            e->from_index = index;
+            pair_set_insert(&c->allocator, &c->edge_pairs, pair_key(e->from_index, e->to_index));
+        }
+        for (uint32_t i = 0; i < adj->in_count[index]; i++) {
+            jcanvas_edge* e = &c->edges[adj->in_edges[adj->in_start[index] + i]];
+            pair_set_remove(&c->edge_pairs, pair_key(e->from_index, e->to_index));
+            jcanvas_edge_changed(c, e);
+            e->to_index = index;
+            pair_set_insert(&c->allocator, &c->edge_pairs, pair_key(e->from_index, e->to_index));
+        }
+    }
+    c->node_count--;
+    return true;
+}
+
+// fails only with JCANVAS_COMPACT_NODES, if a value doesn't fit (the node is left unchanged then),
+// or if the canvas has a journal and the node isn't one of its nodes
+[[always_inline]] bool jcanvas_pos_node(jcanvas* c, jcanvas_node* node, int64_t x, int64_t y, int64_t width, int64_t height)
+{
+    if (!coords_fit(x, y, width, height)) return false;
+    uint32_t index;
+    if (c->journal && !node_index(c, node, &index)) {
+        c->last_error = "Node doesn't belong to this canvas!";
+        return false;
+    }
+    node->x = x; node->y = y; node->width = width; node->height = height;
+    if (c->last_view.node_count > 0) jcanvas_node_changed(c, node);
+    if (c->journal) journal_pos(c->journal, index, node);
+    return true;
+}
+
+//#region output
+#define OUT_FLUSH_SIZE (64 * 1024)
+#define STRING_BLOCK_SIZE (64 * 1024)
+#define IOV_MIN_REF 64 // shorter strings are copied, an iovec of their own would cost more than the copy
+
+// blocks of strings that never move: strings a canvas owns, and the pieces of jcanvas_generate_iov
+struct jcanvas_string_block {
+    jcanvas_string_block* next;
+    uint32_t size, used;
+    char data[];
+};
+
+// generation target: objects are appended to buf, which is flushed into file (if set) once it
+// grows past OUT_FLUSH_SIZE
+typedef struct {
+    const jcanvas_allocator* a;
+    str buf;
+    FILE* file;
+    uint64_t written; // bytes already flushed into file
+    jcanvas_index* index; // if set, every object is added to it with its offset in the output
+    bool fixed_width; // see jcanvas.fixed_width_fields
+    jcanvas_iov* iov; // if set, buf is moved into it in pieces and long strings are referenced instead of copied
+    const char* error;
+} jcanvas_out;
+
+static bool out_flush(jcanvas_out* out)
+{
+    if (out->file == NULL || out->buf.len == 0) return out->error == NULL;
+    if (fwrite(out->buf.data, 1, out->buf.len, out->file) != out->buf.len) {
+        out->error = "Failed to write canvas file";
+    }
+    out->written += out->buf.len;
+    out->buf.len = 0;
+    return out->error == NULL;
+}
+
+static bool iov_push(jcanvas_out* out, char* base, uint64_t len)
+{
+    jcanvas_iov* iov = out->iov;
+    if (len == 0) return true;
+    iov->len += len;
+    if (iov->count > 0) {
+        jcanvas_iovec* last = &iov->vecs[iov->count - 1];
+        if ((char*)last->base + last->len == base) { last->len += len; return true; }
+    }
+    uint32_t needed = iov->count + 1 < 64 ? 64 : iov->count + 1;
+    if (!ensure_capacity(out->a, &iov->cap, needed, &iov->vecs, sizeof(jcanvas_iovec))) {
+        out->error = "Not enough memory!";
+        return false;
+    }
+    iov->vecs[iov->count++] = (jcanvas_iovec){ base, (size_t)len };
+    return true;
+}
+
+// moves what's in buf into the blocks of out->iov
+static bool out_seal(jcanvas_out* out)
+{
+    jcanvas_iov* iov = out->iov;
+    uint32_t len = out->buf.len;
+    if (len == 0) return out->error == NULL;
+    jcanvas_string_block* block = iov->blocks;
+    if (block == NULL || block->size - block->used < len) {
+        uint32_t size = len > STRING_BLOCK_SIZE ? len : STRING_BLOCK_SIZE;
+        block = out->a->allocate(out->a->ctx, sizeof(jcanvas_string_block) + size);
+        if (block == NULL) {
+            out->error = "Not enough memory!";
+            return false;
+        }
+        block->size = size; block->used = 0;
+        block->next = iov->blocks; iov->blocks = block;
+    }
+    char* at = block->data + block->used;
+    copy_mem(out->buf.data, at, len);
+    block->used += len;
+    out->buf.len = 0;
+    return iov_push(out, at, len);
+}
+
+// appends a string the caller owns, as a reference of its own when generating an iov and it's long enough
+static void out_str(jcanvas_out* out, str s)
+{
+    if (out->iov && s.len >= IOV_MIN_REF) {
+        if (out_seal(out)) iov_push(out, s.data, s.len);
+        return;
+    }
+    str_append_s(out->a, &out->buf, s);
+}
+
+static bool out_maybe_flush(jcanvas_out* out)
+{
+    if (out->buf.len < OUT_FLUSH_SIZE) return true;
+    if (out->iov) return out_seal(out);
+    return out_flush(out);
+}
+
+// copies len bytes at offset of the file at path into the output, without staging them
+// anywhere else: straight into buf when generating a string, file to file otherwise
+static bool out_file_range(jcanvas_out* out, str path, uint64_t offset, uint64_t len)
+{
+    str terminated_path = str_concat(out->a, path, (str){0});
+    FILE* from = terminated_path.data ? fopen(terminated_path.data, "rb") : NULL;
+    str_free(out->a, &terminated_path);
+    if (from == NULL) {
+        out->error = "Failed to open the file of a text node";
+        return false;
+    }
+
+    bool ok = true;
+    if (out->file == NULL) {
+        ok = len <= UINT32_MAX - out->buf.len
+            && ensure_capacity(out->a, &out->buf.cap, out->buf.len + (uint32_t)len, &out->buf.data, 1);
+        if (!ok) out->error = "Not enough memory!";
+        else if (!file_seek(from, (int64_t)offset, SEEK_SET) || fread(out->buf.data + out->buf.len, 1, len, from) != len) {
+            out->error = "Failed to read the file of a text node"; ok = false;
+        }
+        else out->buf.len += (uint32_t)len;
+        fclose(from);
+        return ok;
+    }
+
+    if (!out_flush(out)) { fclose(from); return false; }
+    uint64_t copied = 0;
+#ifdef __linux__
+    // sendfile moves the bytes inside the kernel. it writes at the descriptor's position, so the
+    // stream is repositioned afterwards (which also rules out unseekable outputs, they take the copy loop)
+    int64_t position = file_tell(out->file);
+    if (position >= 0 && fflush(out->file) == 0) {
+        off_t from_offset = (off_t)offset;
+        while (copied < len) {
+            ssize_t n = sendfile(fileno(out->file), fileno(from), &from_offset, len - copied);
+            if (n <= 0) break;
+            copied += (uint64_t)n;
+        }
+        file_seek(out->file, position + (int64_t)copied, SEEK_SET);
+    }
+#endif
+    if (copied < len) {
+        char chunk[16 * 1024];
+        if (!file_seek(from, (int64_t)(offset + copied), SEEK_SET)) ok = false;
+        while (ok && copied < len) {
+            size_t want = len - copied < sizeof(chunk) ? (size_t)(len - copied) : sizeof(chunk);
+            size_t n = fread(chunk, 1, want, from);
+            if (n == 0 || fwrite(chunk, 1, n, out->file) != n) ok = false;
+            copied += n;
+        }
+        if (!ok) out->error = "Failed to copy the file of a text node into the canvas file";
+    }
+    out->written += copied;
+    fclose(from);
+    return ok;
+}
+
+// with fixed_width_fields a node ends in x, y, width, height and color padded with spaces after the values:
+// "x":"12"<spaces>,"y":"-4"<spaces>,... so they can be overwritten in place, see jcanvas_patch_nodes
+#define FIXED_VALUE_WIDTH 21 // the longest int64 and its closing quote
+#define FIXED_NUMBERS_SIZE (5 + 6 + 10 + 11 + 4 * FIXED_VALUE_WIDTH)
+#define FIXED_COLOR_WIDTH 18 // ,"color":"#rrggbb"
+#define FIXED_TAIL_SIZE (FIXED_NUMBERS_SIZE + FIXED_COLOR_WIDTH + 1)
+
+static char* fixed_value(char* dst, const char* key, uint32_t key_len, int64_t value)
+{
+    char buf[50];
+    int len = int_to_str(buf, value);
+    copy_mem((char*)key, dst, key_len); dst += key_len;
+    copy_mem(buf, dst, len);
+    dst[len] = '"';
+    for (int i = len + 1; i < FIXED_VALUE_WIDTH; i++) dst[i] = ' ';
+    return dst + FIXED_VALUE_WIDTH;
+}
+
+static void fixed_numbers(char* dst, const jcanvas_node* node)
+{
+    dst = fixed_value(dst, "\"x\":\"", 5, node->x);
+    dst = fixed_value(dst, ",\"y\":\"", 6, node->y);
+    dst = fixed_value(dst, ",\"width\":\"", 10, node->width);
+    fixed_value(dst, ",\"height\":\"", 11, node->height);
+}
+
+// false if the color is longer than its slot
+static bool fixed_color(char* dst, const jcanvas_node* node)
+{
+    jcanvas_color color = jcanvas_get_color(node);
+    str value = sstr_view(&color);
+    if (value.len > FIXED_COLOR_WIDTH - 11) return false;
+    uint32_t len = 0;
+    if (value.len > 0) {
+        copy_mem(",\"color\":\"", dst, 10);
+        copy_mem(value.data, dst + 10, value.len);
+        dst[10 + value.len] = '"';
+        len = 11 + value.len;
+    }
+    for (uint32_t i = len; i < FIXED_COLOR_WIDTH; i++) dst[i] = ' ';
+    return true;
+}
+
+void jcanvas_generate_node(jcanvas_out* out, const jcanvas_node* node, const jcanvas_node_extra* extra)
+{
+    const jcanvas_allocator* a = out->a;
+    str* result = &out->buf;
+    char buf[50];
+    str_append(a, result, "{\"id\":\"", 7); str_append_ss(a, result, &node->id); 
+    str_append(a, result, "\",\"type\":\"", 10); str_append_s(a, result, _type_strings[node->type]);
+    switch (node->type) {
+        case NODE_TYPE_TEXT: {
+            str_append(a, result, "\",\"text\":\"", 10);
+            if (node->text_in_file && extra) out_file_range(out, node->as.text_file.path, extra->as.text_file.offset, extra->as.text_file.len);
+            else out_str(out, node->as.text);
+        } break;
+        case NODE_TYPE_FILE: {
+            str_append(a, result, "\",\"file\":\"", 10); out_str(out, node->as.file.path);
+            if (extra && extra->as.file.subpath.len > 0) {
+                str_append(a, result, "\",\"subpath\":\"", 13); out_str(out, extra->as.file.subpath);
+            }
+        } break;
+        case NODE_TYPE_LINK: {
+            str_append(a, result, "\",\"link\":\"", 10); out_str(out, node->as.link);
+        } break;
+        case NODE_TYPE_GROUP: {
+            if (node->as.group_node.label.len > 0) {
+                str_append(a, result, "\",\"label\":\"", 11); out_str(out, node->as.group_node.label);
+            } 
+            jcanvas_background_style style = STYLE_OVER;
+            if (extra) {
+                if (extra->as.group_node.background.len > 0) {
+                    str_append(a, result, "\",\"background\":\"", 16); out_str(out, extra->as.group_node.background);
+                }
+                style = extra->as.group_node.background_style;
+            }
+            str_append(a, result, "\",\"backgroundStyle\":\"", 21); str_append_s(a, result, _background_style_strings[style]);
+        } break;
+        default: return; // not implemented yet!
+    }
+    if (out->fixed_width) {
+        char tail[FIXED_TAIL_SIZE];
+        str_append(a, result, "\",", 2);
+        fixed_numbers(tail, node);
+        if (fixed_color(tail + FIXED_NUMBERS_SIZE, node)) {
+            tail[FIXED_TAIL_SIZE - 1] = '}';
+            str_append(a, result, tail, FIXED_TAIL_SIZE);
+            return;
+        }
+        // a long custom color is written as usual, patching this node always fails
+        jcanvas_color color = jcanvas_get_color(node);
+        str_append(a, result, tail, FIXED_NUMBERS_SIZE);
+        str_append(a, result, ",\"color\":\"", 10); str_append_ss(a, result, &color);
+        str_append(a, result, "\"}", 2);
+        return;
+    }
+    char len = int_to_str(buf, node->x);
+    str_append(a, result, "\",\"x\":\"", 7); str_append(a, result, buf, len);
+    len = int_to_str(buf, node->y);
+    str_append(a, result, "\",\"y\":\"", 7); str_append(a, result, buf, len);
+    len = int_to_str(buf, node->width);
+    str_append(a, result, "\",\"width\":\"", 11); str_append(a, result, buf, len);
+    len = int_to_str(buf, node->height);
+    str_append(a, result, "\",\"height\":\"", 12); str_append(a, result, buf, len);
+    jcanvas_color color = jcanvas_get_color(node);
+    if (sstr_view(&color).len > 0) { str_append(a, result, "\",\"color\":\"", 11); str_append_ss(a, result, &color); }
+    str_append(a, result, "\"}", 2);
+} 
+
+void jcanvas_generate_edge(jcanvas_out* out, const jcanvas_edge* edge)
+{
+    const jcanvas_allocator* a = out->a;
+    str* result = &out->buf;
+    str_append(a, result, "{\"id\":\"", 7); str_append_ss(a, result, &edge->id);
+    str_append(a, result, "\",\"fromNode\":\"", 14); str_append_ss(a, result, &edge->from_node);
+    str_append(a, result, "\",\"fromSide\":\"", 14); str_append_s(a, result, _side_strings[edge->from_side]);
+    str_append(a, result, "\",\"fromEnd\":\"", 13); str_append_s(a, result, _end_strings[edge->from_end]);
+    str_append(a, result, "\",\"toNode\":\"", 12); str_append_ss(a, result, &edge->to_node);
+    str_append(a, result, "\",\"toSide\":\"", 12); str_append_s(a, result, _side_strings[edge->to_side]);
+    str_append(a, result, "\",\"toEnd\":\"", 11); str_append_s(a, result, _end_strings[edge->to_end]);
+
+    if (sstr_view(&edge->color).len > 0) { str_append(a, result, "\",\"color\":\"", 11); str_append_ss(a, result, &edge->color); }
+    if (edge->label.len > 0) { str_append(a, result, "\",\"label\":\"", 11); out_str(out, edge->label); }
+    
+    str_append(a, result, "\"}", 2);
+}
+
+// the table has room for every object, see jcanvas_generate_to_file_indexed
+// false for objects of 4 GiB or more (e.g. a text node backed by a huge file), their length doesn't fit an entry
+static bool index_put(jcanvas_index* index, uint64_t hash, uint64_t offset, uint64_t len, uint32_t kind)
+{
+    if (len > UINT32_MAX) return false;
+    uint32_t mask = index->cap - 1;
+    uint32_t i = (uint32_t)hash & mask;
+    while (index->entries[i].len != 0) i = (i + 1) & mask;
+    index->entries[i] = (jcanvas_index_entry){ hash, offset, (uint32_t)len, kind };
+    index->count++;
+    return true;
+}
+
+// 8 bytes of an id from at on as a big endian word, so comparing words compares the ids byte by byte.
+// bytes past the end are 0
+static uint64_t id_word(str id, uint32_t at)
+{
+    uint64_t result = 0;
+    for (uint32_t i = at; i < at + 8; i++) result = (result << 8) | (i < id.len ? (uint8_t)id.data[i] : 0);
+    return result;
+}
+
+static bool id_less(str a, str b)
+{
+    uint32_t len = a.len < b.len ? a.len : b.len;
+    for (uint32_t i = 0; i < len; i++) {
+        if (a.data[i] != b.data[i]) return (uint8_t)a.data[i] < (uint8_t)b.data[i];
+    }
+    return a.len < b.len;
+}
+
+typedef str (*id_of_fn)(const void* objects, uint32_t index);
+
+static str node_id_of(const void* c, uint32_t index) { return sstr_view(&((const jcanvas*)c)->nodes[index].id); }
+static str edge_id_of(const void* c, uint32_t index) { return sstr_view(&((const jcanvas*)c)->edges[index].id); }
+
+typedef struct {
+    id_of_fn id_of;
+    const void* objects;
+    uint32_t skip; // bytes all the ids start with, the words are taken after them
+} id_sorter;
+
+#define ID_SORT_SMALL 32
+
+static void id_insertion_sort(const id_sorter* sorter, uint32_t* values, uint32_t count)
+{
+    for (uint32_t i = 1; i < count; i++) {
+        uint32_t value = values[i];
+        str id = sorter->id_of(sorter->objects, value);
+        uint32_t k = i;
+        for (; k > 0 && id_less(id, sorter->id_of(sorter->objects, values[k - 1])); k--) values[k] = values[k - 1];
+        values[k] = value;
+    }
+}
+
+// sorts the objects in values by id, keys holds word depth of their ids. it's radix sorted by those words,
+// then every run of equal words is sorted the same way by the next word, until runs are small enough to
+// compare the ids directly
+static bool id_sort(const jcanvas_allocator* a, const id_sorter* sorter, uint64_t* keys, uint32_t* values, uint32_t count, uint32_t depth)
+{
+    if (count <= ID_SORT_SMALL) {
+        id_insertion_sort(sorter, values, count);
+        return true;
+    }
+    if (!radix_sort(a, keys, values, count, 64)) return false;
+    uint32_t next = sorter->skip + (depth + 1) * 8;
+    for (uint32_t begin = 0, end; begin < count; begin = end) {
+        for (end = begin + 1; end < count && keys[end] == keys[begin]; end++);
+        if (end - begin == 1) continue;
+        bool longer = false;
+        for (uint32_t k = begin; k < end; k++) {
+            str id = sorter->id_of(sorter->objects, values[k]);
+            keys[k] = id_word(id, next);
+            longer |= id.len > next;
+        }
+        // if all the ids end here, they can only differ in their length
+        if (!longer) id_insertion_sort(sorter, values + begin, end - begin);
+        else if (!id_sort(a, sorter, keys + begin, values + begin, end - begin, depth + 1)) return false;
+    }
+    return true;
+}
+
+// the indices of count objects sorted by their ids, NULL for no objects. false if there's not enough memory.
+// runs on the generating thread, views are sorted on the thread that generates them
+static bool id_order(const jcanvas_allocator* a, uint32_t count, id_of_fn id_of, const void* objects, uint32_t** result)
+{
+    *result = NULL;
+    if (count == 0) return true;
+    id_sorter sorter = { id_of, objects };
+    uint64_t* keys = a->allocate(a->ctx, (size_t)count * sizeof(uint64_t));
+    uint32_t* values = a->allocate(a->ctx, (size_t)count * sizeof(uint32_t));
+    bool ok = keys && values;
+    if (ok) {
+        // ids often share a long prefix (like "node-"), comparing it would only waste the first words
+        str first = id_of(objects, 0);
+        sorter.skip = first.len;
+        for (uint32_t i = 1; i < count && sorter.skip > 0; i++) {
+            str id = id_of(objects, i);
+            uint32_t same = 0;
+            while (same < sorter.skip && same < id.len && id.data[same] == first.data[same]) same++;
+            sorter.skip = same;
+        }
+    }
+    for (uint32_t i = 0; i < count && ok; i++) {
+        str id = id_of(objects, i);
+        keys[i] = id_word(id, sorter.skip);
+        values[i] = i;
+    }
+    if (ok) ok = id_sort(a, &sorter, keys, values, count, 0);
+    free_array(a, keys, count, sizeof(uint64_t));
+    if (ok) *result = values;
+    else free_array(a, values, count, sizeof(uint32_t));
+    return ok;
+}
+
+// a part of a lazy order that isn't sorted yet: its ids agree on the bytes before byte of the word at depth,
+// which keys holds for them
+typedef struct {
+    uint32_t begin, end;
+    uint32_t depth, byte;
+} id_range;
+
+#define ID_SORT_LAZY 1024 // ranges up to this size are sorted at once
+
+// an id order that is sorted a step at a time, only as far as it's read, for the pull generator. the first
+// step takes the first word of every id, then the range in front is split by the next byte of its ids (a pass
+// over the range, in place) until it's small enough for id_sort. so no step takes more than a pass over the
+// ids, and most only one over a bucket of them
+typedef struct jcanvas_lazy_order {
+    id_sorter sorter;
+    uint32_t count, sorted; // order[0, sorted) is final
+    uint32_t* order;
+    uint64_t* keys;
+    id_range* ranges; // still to sort, the first one last
+    uint32_t range_count, range_cap;
+    bool started;
+} jcanvas_lazy_order;
+
+static void lazy_order_free(const jcanvas_allocator* a, jcanvas_lazy_order* lazy)
+{
+    if (lazy == NULL) return;
+    free_array(a, lazy->order, lazy->count, sizeof(uint32_t));
+    free_array(a, lazy->keys, lazy->count, sizeof(uint64_t));
+    free_array(a, lazy->ranges, lazy->range_cap, sizeof(id_range));
+    a->free(a->ctx, lazy, sizeof(jcanvas_lazy_order));
+}
+
+// NULL if there's not enough memory. the ids aren't looked at until the first step
+static jcanvas_lazy_order* lazy_order_make(const jcanvas_allocator* a, uint32_t count, id_of_fn id_of, const void* objects)
+{
+    jcanvas_lazy_order* lazy = a->allocate(a->ctx, sizeof(jcanvas_lazy_order));
+    if (lazy == NULL) return NULL;
+    *lazy = (jcanvas_lazy_order){ .sorter = { id_of, objects }, .count = count };
+    if (count == 0) return lazy;
+    lazy->order = a->allocate(a->ctx, (size_t)count * sizeof(uint32_t));
+    lazy->keys = a->allocate(a->ctx, (size_t)count * sizeof(uint64_t));
+    if (lazy->order == NULL || lazy->keys == NULL || !ensure_capacity(a, &lazy->range_cap, 16, &lazy->ranges, sizeof(id_range))) {
+        lazy_order_free(a, lazy);
+        return NULL;
+    }
+    return lazy;
+}
+
+// splits the range by its byte in place (american flag sort) and puts the buckets on the stack, first one last.
+// a prefix all the ids share only costs the counting, unlike id_order there's no pass to find it first
+static bool lazy_order_split(const jcanvas_allocator* a, jcanvas_lazy_order* lazy, id_range r)
+{
+    uint32_t shift = 56 - 8 * r.byte;
+    uint32_t counts[256] = {0}, next[256], ends[256];
+    for (uint32_t i = r.begin; i < r.end; i++) counts[(lazy->keys[i] >> shift) & 0xff]++;
+    if (counts[(lazy->keys[r.begin] >> shift) & 0xff] == r.end - r.begin) {
+        lazy->ranges[lazy->range_count++] = (id_range){ r.begin, r.end, r.depth, r.byte + 1 };
+        return true;
+    }
+    uint32_t at = r.begin, buckets = 0;
+    for (uint32_t b = 0; b < 256; b++) {
+        next[b] = at;
+        at += counts[b];
+        ends[b] = at;
+        buckets += counts[b] > 0;
+    }
+    for (uint32_t b = 0; b < 256; b++) {
+        while (next[b] < ends[b]) {
+            uint64_t key = lazy->keys[next[b]];
+            uint32_t value = lazy->order[next[b]];
+            uint32_t to = (key >> shift) & 0xff;
+            // carry the object along the cycle until it lands in this bucket
+            while (to != b) {
+                uint64_t k = lazy->keys[next[to]];
+                uint32_t v = lazy->order[next[to]];
+                lazy->keys[next[to]] = key; lazy->order[next[to]++] = value;
+                key = k; value = v;
+                to = (key >> shift) & 0xff;
+            }
+            lazy->keys[next[b]] = key; lazy->order[next[b]++] = value;
+        }
+    }
+    if (!ensure_capacity(a, &lazy->range_cap, lazy->range_count + buckets, &lazy->ranges, sizeof(id_range))) return false;
+    for (uint32_t b = 256; b-- > 0;) {
+        if (counts[b] > 0) lazy->ranges[lazy->range_count++] = (id_range){ ends[b] - counts[b], ends[b], r.depth, r.byte + 1 };
+    }
+    return true;
+}
+
+// one step of sorting the order, at most a pass over the ids. false if there's not enough memory
+static bool lazy_order_step(const jcanvas_allocator* a, jcanvas_lazy_order* lazy)
+{
+    const id_sorter* sorter = &lazy->sorter;
+    if (!lazy->started) {
+        for (uint32_t i = 0; i < lazy->count; i++) {
+            lazy->keys[i] = id_word(sorter->id_of(sorter->objects, i), 0);
+            lazy->order[i] = i;
+        }
+        lazy->ranges[lazy->range_count++] = (id_range){ 0, lazy->count, 0, 0 };
+        lazy->started = true;
+        return true;
+    }
+    id_range r = lazy->ranges[--lazy->range_count];
+    uint32_t count = r.end - r.begin;
+    if (count <= ID_SORT_LAZY) {
+        if (!id_sort(a, sorter, lazy->keys + r.begin, lazy->order + r.begin, count, r.depth)) return false;
+        lazy->sorted = r.end;
+    } else if (r.byte == 8) {
+        // the word is used up, on to the next one. if all the ids end here, they can only differ in their length
+        uint32_t at = (r.depth + 1) * 8;
+        bool longer = false;
+        for (uint32_t i = r.begin; i < r.end; i++) {
+            str id = sorter->id_of(sorter->objects, lazy->order[i]);
+            lazy->keys[i] = id_word(id, at);
+            longer |= id.len > at;
+        }
+        if (longer) lazy->ranges[lazy->range_count++] = (id_range){ r.begin, r.end, r.depth + 1, 0 };
+        else {
+            id_insertion_sort(sorter, lazy->order + r.begin, count);
+            lazy->sorted = r.end;
+        }
+    } else return lazy_order_split(a, lazy, r);
+    return true;
+}
+
+// writes the given nodes and edges as a canvas, all of them if nodes / edges is NULL. only reads c
+static bool generate_objects(jcanvas* c, jcanvas_out* out, const uint32_t* nodes, uint32_t node_count, const uint32_t* edges, uint32_t edge_count)
+{
+    const jcanvas_allocator* a = out->a;
+    out->fixed_width = c->fixed_width_fields;
+    str_append(a, &out->buf, "{\"nodes\":[", 10);
+    for (uint32_t i = 0; i < node_count && out->error == NULL; i++) {
+        uint32_t n = nodes ? nodes[i] : i;
+        if (i > 0) str_append(a, &out->buf, ",", 1);
+        uint64_t offset = out->written + out->buf.len;
+        jcanvas_generate_node(out, &c->nodes[n], node_extra(c, n));
+        if (out->index && !index_put(out->index, node_id_hash(c, &c->nodes[n]), offset, out->written + out->buf.len - offset, 0)) {
+            out->error = "A node is too large for an index!";
+        }
+        out_maybe_flush(out);
+    }
+    str_append(a, &out->buf, "],\"edges\":[", 11);
+    for (uint32_t i = 0; i < edge_count && out->error == NULL; i++) {
+        uint32_t e = edges ? edges[i] : i;
+        if (i > 0) str_append(a, &out->buf, ",", 1);
+        uint64_t offset = out->written + out->buf.len;
+        jcanvas_generate_edge(out, &c->edges[e]);
+        if (out->index && !index_put(out->index, c->edges[e].id_hash, offset, out->written + out->buf.len - offset, 1)) {
+            out->error = "An edge is too large for an index!";
+        }
+        out_maybe_flush(out);
+    }
+    str_append(a, &out->buf, "]}", 2);
+    return out->error == NULL;
+}
+
+static bool generate(jcanvas* c, jcanvas_out* out)
+{
+    uint32_t* nodes = NULL;
+    uint32_t* edges = NULL;
+    if (c->canonical_order && (!id_order(out->a, c->node_count, node_id_of, c, &nodes) || !id_order(out->a, c->edge_count, edge_id_of, c, &edges))) {
+        out->error = "Not enough memory!";
+    }
+    if (out->error == NULL) generate_objects(c, out, nodes, c->node_count, edges, c->edge_count);
+    if (out->error) c->last_error = (char*)out->error;
+    free_array(out->a, nodes, c->node_count, sizeof(uint32_t));
+    free_array(out->a, edges, c->edge_count, sizeof(uint32_t));
+    return out->error == NULL;
+}
+
+str jcanvas_generate(jcanvas* c)
+{
+    jcanvas_out out = { &c->allocator };
+    out.buf = str_init(out.a, 100);
+    if (!generate(c, &out)) {
+        str_free(out.a, &out.buf);
+        return out.buf;
+    }
+    str_append(out.a, &out.buf, "\0", 1); // null terminator for printing
+    return out.buf;
+}
+
+// streams the canvas into file through a fixed size buffer instead of building it in memory
+bool jcanvas_generate_to_file(jcanvas* c, FILE* file)
+{
+    jcanvas_out out = { &c->allocator };
+    out.buf = str_init(out.a, OUT_FLUSH_SIZE);
+    out.file = file;
+    bool ok = generate(c, &out) && out_flush(&out);
+    if (!ok) c->last_error = (char*)out.error;
+    str_free(out.a, &out.buf);
+    return ok;
+}
+
+void jcanvas_free_str(jcanvas* c, str* s)
+{
+    str_free(&c->allocator, s);
+}
+
+// generates the canvas as a list of pieces to send with writev: the keys, numbers and short strings are
+// generated into blocks, long strings of nodes and edges are pointed to where they are. those have to stay
+// valid and the canvas unchanged until the pieces are written
+bool jcanvas_generate_iov(jcanvas* c, jcanvas_iov* result)
+{
+    *result = (jcanvas_iov){ .allocator = c->allocator };
+    jcanvas_out out = { &c->allocator };
+    out.buf = str_init(out.a, OUT_FLUSH_SIZE);
+    out.iov = result;
+    bool ok = generate(c, &out) && out_seal(&out);
+    if (!ok) {
+        c->last_error = (char*)out.error;
+        jcanvas_iov_free(result);
+    }
+    str_free(out.a, &out.buf);
+    return ok;
+}
+
+void jcanvas_iov_free(jcanvas_iov* iov)
+{
+    const jcanvas_allocator* a = &iov->allocator;
+    free_array(a, iov->vecs, iov->cap, sizeof(jcanvas_iovec));
+    while (iov->blocks) {
+        jcanvas_string_block* next = iov->blocks->next;
+        a->free(a->ctx, iov->blocks, sizeof(jcanvas_string_block) + iov->blocks->size);
+        iov->blocks = next;
+    }
+    *iov = (jcanvas_iov){ .allocator = *a };
+}
+
+enum { GEN_START, GEN_NODES, GEN_EDGES, GEN_DONE };
+
+// generates the next piece into gen->pending: the opening, a single node or edge, or the closing. or with
+// canonical_order, a step of sorting the nodes or edges if the next one isn't sorted yet, then it returns true
+static bool gen_step(jcanvas_gen* gen)
+{
+    jcanvas* c = gen->canvas;
+    jcanvas_out out = { &c->allocator };
+    out.buf = gen->pending;
+    out.fixed_width = c->fixed_width_fields;
+    switch (gen->stage) {
+        case GEN_START: {
+            str_append(out.a, &out.buf, "{\"nodes\":[", 10);
+            gen->stage = GEN_NODES;
+        } break;
+        case GEN_NODES: {
+            if (gen->next >= c->node_count) {
+                str_append(out.a, &out.buf, "],\"edges\":[", 11);
+                gen->stage = GEN_EDGES; gen->next = 0;
+                if (gen->order) {
+                    lazy_order_free(out.a, gen->order);
+                    gen->order = lazy_order_make(out.a, c->edge_count, edge_id_of, c);
+                    if (gen->order == NULL) gen->error = "Not enough memory!";
+                }
+                break;
+            }
+            if (gen->order && gen->next >= gen->order->sorted) {
+                if (!lazy_order_step(out.a, gen->order)) gen->error = "Not enough memory!";
+                return true;
+            }
+            uint32_t n = gen->order ? gen->order->order[gen->next] : gen->next;
+            if (gen->next > 0) str_append(out.a, &out.buf, ",", 1);
+            jcanvas_generate_node(&out, &c->nodes[n], node_extra(c, n));
+            gen->next++;
+        } break;
+        case GEN_EDGES: {
+            if (gen->next >= c->edge_count) {
+                str_append(out.a, &out.buf, "]}", 2);
+                gen->stage = GEN_DONE;
+                break;
+            }
+            if (gen->order && gen->next >= gen->order->sorted) {
+                if (!lazy_order_step(out.a, gen->order)) gen->error = "Not enough memory!";
+                return true;
+            }
+            uint32_t e = gen->order ? gen->order->order[gen->next] : gen->next;
+            if (gen->next > 0) str_append(out.a, &out.buf, ",", 1);
+            jcanvas_generate_edge(&out, &c->edges[e]);
+            gen->next++;
+        } break;
+    }
+    gen->pending = out.buf;
+    if (out.error) gen->error = out.error;
+    return false;
+}
+
+// starts generating the canvas piece by piece with jcanvas_gen_next. the canvas mustn't change until jcanvas_gen_end.
+// with canonical_order the ids are sorted as the pieces get to them, see jcanvas_lazy_order
+void jcanvas_gen_begin(jcanvas* c, jcanvas_gen* gen)
+{
+    *gen = (jcanvas_gen){ .canvas = c, .stage = GEN_START };
+    if (c->canonical_order) {
+        gen->order = lazy_order_make(&c->allocator, c->node_count, node_id_of, c);
+        if (gen->order == NULL) gen->error = "Not enough memory!";
+    }
+}
+
+// writes up to cap bytes of the canvas into buf and returns how many, 0 once everything is written or on error
+// (see gen->error). only generates about as many nodes and edges as fit into cap, and stops after a step of
+// sorting them once it has written anything, so each call takes bounded time
+uint32_t jcanvas_gen_next(jcanvas_gen* gen, char* buf, uint32_t cap)
+{
+    uint32_t written = 0;
+    while (written < cap && gen->error == NULL) {
+        if (gen->pending_at == gen->pending.len) {
+            if (gen->stage == GEN_DONE) break;
+            gen->pending.len = gen->pending_at = 0;
+            if (gen_step(gen) && written > 0) break;
+            continue;
+        }
+        uint32_t n = gen->pending.len - gen->pending_at;
+        if (n > cap - written) n = cap - written;
+        copy_mem(gen->pending.data + gen->pending_at, buf + written, n);
+        gen->pending_at += n; written += n;
+    }
+    if (gen->error) gen->canvas->last_error = (char*)gen->error;
+    return gen->error ? 0 : written;
+}
+
+void jcanvas_gen_end(jcanvas_gen* gen)
+{
+    const jcanvas_allocator* a = &gen->canvas->allocator;
+    str_free(a, &gen->pending);
+    lazy_order_free(a, gen->order);
+    gen->order = NULL;
+    gen->pending_at = 0;
+}
+//#endregion
+
+//#region snapshot
+#define VIEW_NO_EXTRA 0xff
+
+// chunks are immutable once made. the references are atomic since views may be destroyed on any thread
+struct jcanvas_node_chunk {
+    atomic_uint refs;
+    uint32_t count, extra_count;
+    uint8_t extra_of[VIEW_CHUNK]; // index into extras or VIEW_NO_EXTRA
+    jcanvas_node_extra* extras;
+    jcanvas_node nodes[VIEW_CHUNK];
+};
+
+struct jcanvas_edge_chunk {
+    atomic_uint refs;
+    uint32_t count, ids_len;
+    char* ids; // copies of the long edge ids, the canvas frees its own when an edge is removed
+    jcanvas_edge edges[VIEW_CHUNK];
+};
+
+static bool bytes_eq(const void* a, const void* b, size_t len)
+{
+    const unsigned char* x = a; const unsigned char* y = b;
+    for (size_t i = 0; i < len; i++) if (x[i] != y[i]) return false;
+    return true;
+}
+
+static void node_chunk_release(const jcanvas_allocator* a, jcanvas_node_chunk* chunk)
+{
+    if (atomic_fetch_sub(&chunk->refs, 1) != 1) return;
+    free_array(a, chunk->extras, chunk->extra_count, sizeof(jcanvas_node_extra));
+    a->free(a->ctx, chunk, sizeof(jcanvas_node_chunk));
+}
+
+static void edge_chunk_release(const jcanvas_allocator* a, jcanvas_edge_chunk* chunk)
+{
+    if (atomic_fetch_sub(&chunk->refs, 1) != 1) return;
+    free_array(a, chunk->ids, chunk->ids_len, 1);
+    a->free(a->ctx, chunk, sizeof(jcanvas_edge_chunk));
+}
+
+static const jcanvas_node_extra* node_chunk_extra(const jcanvas_node_chunk* chunk, uint32_t i)
+{
+    return chunk->extra_of[i] == VIEW_NO_EXTRA ? NULL : &chunk->extras[chunk->extra_of[i]];
+}
+
+static jcanvas_node_chunk* node_chunk_make(jcanvas* c, uint32_t first, uint32_t count)
+{
+    const jcanvas_allocator* a = &c->allocator;
+    jcanvas_node_chunk* chunk = a->allocate(a->ctx, sizeof(jcanvas_node_chunk));
+    if (chunk == NULL) return NULL;
+    atomic_init(&chunk->refs, 1);
+    chunk->count = count; chunk->extra_count = 0; chunk->extras = NULL;
+    for (uint32_t i = 0; i < count; i++) chunk->nodes[i] = c->nodes[first + i];
+
+    for (uint32_t i = 0; i < count; i++) chunk->extra_count += node_extra(c, first + i) != NULL;
+    if (chunk->extra_count > 0) {
+        chunk->extras = a->allocate(a->ctx, (size_t)chunk->extra_count * sizeof(jcanvas_node_extra));
+        if (chunk->extras == NULL) {
+            a->free(a->ctx, chunk, sizeof(jcanvas_node_chunk));
+            return NULL;
+        }
+    }
+    uint32_t next = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        jcanvas_node_extra* extra = node_extra(c, first + i);
+        chunk->extra_of[i] = extra ? next : VIEW_NO_EXTRA;
+        if (extra) {
+            chunk->extras[next] = *extra;
+            chunk->extras[next++].node = i; // relative to the chunk
+        }
+    }
+    return chunk;
+}
+
+// copied long ids point into the chunk and not to the canvas' strings
+static jcanvas_edge_chunk* edge_chunk_make(jcanvas* c, uint32_t first, uint32_t count)
+{
+    const jcanvas_allocator* a = &c->allocator;
+    jcanvas_edge_chunk* chunk = a->allocate(a->ctx, sizeof(jcanvas_edge_chunk));
+    if (chunk == NULL) return NULL;
+    atomic_init(&chunk->refs, 1);
+    chunk->count = count; chunk->ids_len = 0; chunk->ids = NULL;
+    for (uint32_t i = 0; i < count; i++) chunk->edges[i] = c->edges[first + i];
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (chunk->edges[i].id.raw[15] == SSTR_REF) chunk->ids_len += chunk->edges[i].id.ref.len;
+    }
+    if (chunk->ids_len > 0) {
+        chunk->ids = a->allocate(a->ctx, chunk->ids_len);
+        if (chunk->ids == NULL) {
+            a->free(a->ctx, chunk, sizeof(jcanvas_edge_chunk));
+            return NULL;
+        }
+    }
+    char* next = chunk->ids;
+    for (uint32_t i = 0; i < count; i++) {
+        sstr* id = &chunk->edges[i].id;
+        if (id->raw[15] != SSTR_REF) continue;
+        for (uint32_t j = 0; j < id->ref.len; j++) next[j] = id->ref.data[j];
+        id->ref.data = next;
+        next += id->ref.len;
+    }
+    return chunk;
+}
+
+static bool view_alloc(jcanvas_view* v, const jcanvas_allocator* a, uint32_t node_count, uint32_t edge_count)
+{
+    *v = (jcanvas_view){ *a };
+    uint32_t node_chunks = view_chunk_count(node_count), edge_chunks = view_chunk_count(edge_count);
+    if (node_chunks) v->node_chunks = a->allocate(a->ctx, node_chunks * sizeof(jcanvas_node_chunk*));
+    if (edge_chunks) v->edge_chunks = a->allocate(a->ctx, edge_chunks * sizeof(jcanvas_edge_chunk*));
+    if ((node_chunks && v->node_chunks == NULL) || (edge_chunks && v->edge_chunks == NULL)) {
+        free_array(a, v->node_chunks, node_chunks, sizeof(jcanvas_node_chunk*));
+        free_array(a, v->edge_chunks, edge_chunks, sizeof(jcanvas_edge_chunk*));
+        *v = (jcanvas_view){0};
+        return false;
+    }
+    v->node_count = node_count; v->edge_count = edge_count;
+    return true;
+}
+
+void jcanvas_view_destroy(jcanvas_view* v)
+{
+    const jcanvas_allocator* a = &v->allocator;
+    uint32_t node_chunks = view_chunk_count(v->node_count), edge_chunks = view_chunk_count(v->edge_count);
+    for (uint32_t k = 0; k < node_chunks; k++) {
+        if (v->node_chunks[k]) node_chunk_release(a, v->node_chunks[k]);
+    }
+    for (uint32_t k = 0; k < edge_chunks; k++) {
+        if (v->edge_chunks[k]) edge_chunk_release(a, v->edge_chunks[k]);
+    }
+    free_array(a, v->node_chunks, node_chunks, sizeof(jcanvas_node_chunk*));
+    free_array(a, v->edge_chunks, edge_chunks, sizeof(jcanvas_edge_chunk*));
+    *v = (jcanvas_view){0};
+}
+
+// has to run on the thread that edits the canvas. chunks that were edited since the last snapshot (or grew)
+// are copied, the others shared, so it costs a copy of the changed chunks and a pointer per chunk. the view
+// can then be read from any thread while the canvas keeps changing
+bool jcanvas_snapshot(jcanvas* c, jcanvas_view* result)
+{
+    const jcanvas_allocator* a = &c->allocator;
+    jcanvas_view* last = &c->last_view;
+    jcanvas_view next, own;
+    if (!view_alloc(&next, a, c->node_count, c->edge_count)) {
+        c->last_error = "Not enough memory!";
+        return false;
+    }
+    bool ok = view_alloc(&own, a, c->node_count, c->edge_count);
+    uint32_t changed_words = view_changed_words(&own);
+    uint64_t* changed = NULL;
+    if (ok && changed_words > 0) {
+        changed = a->allocate(a->ctx, (size_t)changed_words * sizeof(uint64_t));
+        ok = changed != NULL;
+    }
+    // unset chunks are skipped by jcanvas_view_destroy, so a failure part way can be cleaned up by it
+    uint32_t node_chunks = view_chunk_count(c->node_count), edge_chunks = view_chunk_count(c->edge_count);
+    for (uint32_t k = 0; k < node_chunks; k++) next.node_chunks[k] = NULL;
+    for (uint32_t k = 0; k < edge_chunks; k++) next.edge_chunks[k] = NULL;
+
+    uint32_t last_node_chunks = view_chunk_count(last->node_count), last_edge_chunks = view_chunk_count(last->edge_count);
+    for (uint32_t k = 0; k < node_chunks && ok; k++) {
+        uint32_t first = k * VIEW_CHUNK;
+        uint32_t count = c->node_count - first < VIEW_CHUNK ? c->node_count - first : VIEW_CHUNK;
+        jcanvas_node_chunk* chunk = k < last_node_chunks ? last->node_chunks[k] : NULL;
+        if (chunk && chunk->count == count && !(c->view_changed[k / 64] >> (k % 64) & 1)) atomic_fetch_add(&chunk->refs, 1);
+        else chunk = node_chunk_make(c, first, count);
+        next.node_chunks[k] = chunk;
+        ok = chunk != NULL;
+    }
+    for (uint32_t k = 0; k < edge_chunks && ok; k++) {
+        uint32_t first = k * VIEW_CHUNK;
+        uint32_t count = c->edge_count - first < VIEW_CHUNK ? c->edge_count - first : VIEW_CHUNK;
+        jcanvas_edge_chunk* chunk = k < last_edge_chunks ? last->edge_chunks[k] : NULL;
+        uint32_t bit = last_node_chunks + k;
+        if (chunk && chunk->count == count && !(c->view_changed[bit / 64] >> (bit % 64) & 1)) atomic_fetch_add(&chunk->refs, 1);
+        else chunk = edge_chunk_make(c, first, count);
+        next.edge_chunks[k] = chunk;
+        ok = chunk != NULL;
+    }
+    if (!ok) {
+        free_array(a, changed, changed_words, sizeof(uint64_t));
+        jcanvas_view_destroy(&next);
+        jcanvas_view_destroy(&own);
+        c->last_error = "Not enough memory!";
+        return false;
+    }
+
+    // the canvas holds on to the same chunks, so the next snapshot can share them
+    for (uint32_t k = 0; k < node_chunks; k++) {
+        own.node_chunks[k] = next.node_chunks[k];
+        atomic_fetch_add(&own.node_chunks[k]->refs, 1);
+    }
+    for (uint32_t k = 0; k < edge_chunks; k++) {
+        own.edge_chunks[k] = next.edge_chunks[k];
+        atomic_fetch_add(&own.edge_chunks[k]->refs, 1);
+    }
+    free_array(a, c->view_changed, view_changed_words(last), sizeof(uint64_t));
+    jcanvas_view_destroy(last);
+    *last = own;
+    for (uint32_t w = 0; w < changed_words; w++) changed[w] = 0;
+    c->view_changed = changed;
+    next.canonical_order = c->canonical_order;
+    *result = next;
+    return true;
+}
+
+const jcanvas_node* jcanvas_view_node(const jcanvas_view* v, uint32_t index)
+{
+    if (index >= v->node_count) return NULL;
+    return &v->node_chunks[index / VIEW_CHUNK]->nodes[index % VIEW_CHUNK];
+}
+
+const jcanvas_node_extra* jcanvas_view_extra(const jcanvas_view* v, uint32_t index)
+{
+    if (index >= v->node_count) return NULL;
+    return node_chunk_extra(v->node_chunks[index / VIEW_CHUNK], index % VIEW_CHUNK);
+}
+
+const jcanvas_edge* jcanvas_view_edge(const jcanvas_view* v, uint32_t index)
+{
+    if (index >= v->edge_count) return NULL;
+    return &v->edge_chunks[index / VIEW_CHUNK]->edges[index % VIEW_CHUNK];
+}
+
+static str view_node_id_of(const void* v, uint32_t index) { return sstr_view(&jcanvas_view_node(v, index)->id); }
+static str view_edge_id_of(const void* v, uint32_t index) { return sstr_view(&jcanvas_view_edge(v, index)->id); }
+
+static bool generate_view(const jcanvas_view* v, jcanvas_out* out)
+{
+    const jcanvas_allocator* a = out->a;
+    uint32_t* nodes = NULL;
+    uint32_t* edges = NULL;
+    if (v->canonical_order && (!id_order(a, v->node_count, view_node_id_of, v, &nodes) || !id_order(a, v->edge_count, view_edge_id_of, v, &edges))) {
+        out->error = "Not enough memory!";
+    }
+    str_append(a, &out->buf, "{\"nodes\":[", 10);
+    for (uint32_t i = 0; i < v->node_count && out->error == NULL; i++) {
+        uint32_t n = nodes ? nodes[i] : i;
+        if (i > 0) str_append(a, &out->buf, ",", 1);
+        jcanvas_generate_node(out, jcanvas_view_node(v, n), jcanvas_view_extra(v, n));
+        out_maybe_flush(out);
+    }
+    str_append(a, &out->buf, "],\"edges\":[", 11);
+    for (uint32_t i = 0; i < v->edge_count && out->error == NULL; i++) {
+        if (i > 0) str_append(a, &out->buf, ",", 1);
+        jcanvas_generate_edge(out, jcanvas_view_edge(v, edges ? edges[i] : i));
+        out_maybe_flush(out);
+    }
+    str_append(a, &out->buf, "]}", 2);
+    free_array(a, nodes, v->node_count, sizeof(uint32_t));
+    free_array(a, edges, v->edge_count, sizeof(uint32_t));
+    return out->error == NULL;
+}
+
+// several threads may generate from the same view at once, errors go to *error instead of the canvas
+str jcanvas_view_generate(const jcanvas_view* v, const char** error)
+{
+    jcanvas_out out = { &v->allocator };
+    out.buf = str_init(out.a, 100);
+    if (!generate_view(v, &out)) {
+        if (error) *error = out.error;
+        str_free(out.a, &out.buf);
+        return out.buf;
+    }
+    str_append(out.a, &out.buf, "\0", 1); // null terminator for printing
+    return out.buf;
+}
+
+bool jcanvas_view_generate_to_file(const jcanvas_view* v, FILE* file, const char** error)
+{
+    jcanvas_out out = { &v->allocator };
+    out.buf = str_init(out.a, OUT_FLUSH_SIZE);
+    out.file = file;
+    bool ok = generate_view(v, &out) && out_flush(&out);
+    if (!ok && error) *error = out.error;
+    str_free(out.a, &out.buf);
+    return ok;
+}
+
+void jcanvas_view_free_str(const jcanvas_view* v, str* s)
+{
+    str_free(&v->allocator, s);
+}
+//#endregion
+
+//#region journal
+typedef struct {
+    const uint8_t* at;
+    const uint8_t* end;
+    bool ok; // false once a read went past the end of the record
+} journal_reader;
+
+static uint32_t le32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static bool jr_has(journal_reader* r, uint32_t len)
+{
+    if (r->ok && (uint64_t)(r->end - r->at) >= len) return true;
+    r->ok = false;
+    return false;
+}
+
+static uint8_t jr_u8(journal_reader* r)
+{
+    return jr_has(r, 1) ? *r->at++ : 0;
+}
+
+static uint32_t jr_u32(journal_reader* r)
+{
+    if (!jr_has(r, 4)) return 0;
+    uint32_t v = le32(r->at);
+    r->at += 4;
+    return v;
+}
+
+static uint64_t jr_u64(journal_reader* r)
+{
+    uint64_t low = jr_u32(r);
+    return low | (uint64_t)jr_u32(r) << 32;
+}
+
+// node indices of records have to be in range when they are replayed
+static uint32_t jr_node(jcanvas* c, journal_reader* r)
+{
+    uint32_t index = jr_u32(r);
+    if (index >= c->node_count) r->ok = false;
+    return r->ok ? index : 0;
+}
+
+// room for len bytes of strings the canvas keeps until jcanvas_destroy, they are never freed one by one
+static char* owned_string_alloc(jcanvas* c, uint32_t len)
+{
+    jcanvas_string_block* block = c->owned_strings;
+    if (block == NULL || block->size - block->used < len) {
+        uint32_t size = len > STRING_BLOCK_SIZE ? len : STRING_BLOCK_SIZE;
+        block = c->allocator.allocate(c->allocator.ctx, sizeof(jcanvas_string_block) + size);
+        if (block == NULL) return NULL;
+        block->size = size; block->used = 0;
+        block->next = c->owned_strings; c->owned_strings = block;
+    }
+    block->used += len;
+    return block->data + block->used - len;
+}
+
+// prefix + id, inline if it fits. longer node ids go to the canvas' string blocks, longer edge ids
+// are allocated like the ones of make_edge_id, since removing an edge frees its id
+static bool instance_id(jcanvas* c, str prefix, str id, bool edge, sstr* result)
+{
+    uint32_t len = prefix.len + id.len;
+    char* data;
+    if (len <= SSTR_INLINE_CAP) data = result->in.data;
+    else if (edge) data = c->allocator.allocate(c->allocator.ctx, (size_t)len + 1);
+    else data = owned_string_alloc(c, len);
+    if (data == NULL) return false;
+    copy_mem(prefix.data, data, prefix.len);
+    copy_mem(id.data, data + prefix.len, id.len);
+    if (len <= SSTR_INLINE_CAP) {
+        result->in.len = (uint8_t)len;
+    } else {
+        if (edge) data[len] = 0;
+        result->ref.data = data; result->ref.len = len;
+        result->raw[15] = SSTR_REF;
+    }
+    return true;
+}
+
+// copies a string of the record into memory owned by the canvas
+static str jr_str(jcanvas* c, journal_reader* r)
+{
+    uint32_t len = jr_u32(r);
+    if (len == 0 || !jr_has(r, len)) return (str){0};
+    str result = make_str_l(owned_string_alloc(c, len), len);
+    if (result.data == NULL) {
+        r->ok = false;
+        return (str){0};
+    }
+    copy_mem((char*)r->at, result.data, len);
+    r->at += len;
+    return result;
+}
+
+static bool journal_apply(jcanvas* c, uint8_t op, journal_reader* r)
+{
+    str id, s;
+    uint32_t index;
+    switch (op) {
+        case JOURNAL_TEXT_NODE: id = jr_str(c, r); s = jr_str(c, r); return r->ok && jcanvas_text_node_s(c, id, s);
+        case JOURNAL_FILE_NODE: id = jr_str(c, r); s = jr_str(c, r); return r->ok && jcanvas_file_node_s(c, id, s);
+        case JOURNAL_LINK_NODE: id = jr_str(c, r); s = jr_str(c, r); return r->ok && jcanvas_link_node_s(c, id, s);
+        case JOURNAL_GROUP_NODE: id = jr_str(c, r); return r->ok && jcanvas_group_node_s(c, id);
+        case JOURNAL_TEXT_FILE_NODE: {
+            id = jr_str(c, r); s = jr_str(c, r);
+            uint64_t offset = jr_u64(r), len = jr_u64(r);
+            return r->ok && jcanvas_text_node_from_file_s(c, id, s, offset, len);
+        }
+        case JOURNAL_POS: {
+            index = jr_node(c, r);
+            int64_t x = (int64_t)jr_u64(r), y = (int64_t)jr_u64(r), width = (int64_t)jr_u64(r), height = (int64_t)jr_u64(r);
+            return r->ok && jcanvas_pos_node(c, &c->nodes[index], x, y, width, height);
+        }
+        case JOURNAL_COLOR: {
+            index = jr_node(c, r); s = jr_str(c, r);
+            return r->ok && jcanvas_set_color(c, &c->nodes[index], make_sstr(s));
+        }
+        case JOURNAL_LABEL: index = jr_node(c, r); s = jr_str(c, r); return r->ok && jcanvas_set_label_s(c, &c->nodes[index], s);
+        case JOURNAL_SUBPATH: index = jr_node(c, r); s = jr_str(c, r); return r->ok && jcanvas_set_subpath_s(c, &c->nodes[index], s);
+        case JOURNAL_BACKGROUND: index = jr_node(c, r); s = jr_str(c, r); return r->ok && jcanvas_set_background_image_s(c, &c->nodes[index], s);
+        case JOURNAL_BACKGROUND_STYLE: {
+            index = jr_node(c, r);
+            uint8_t style = jr_u8(r);
+            return r->ok && style <= STYLE_REPEAT && jcanvas_set_background_style(c, &c->nodes[index], style);
+        }
+        case JOURNAL_CONNECT: {
+            uint32_t from = jr_node(c, r), to = jr_node(c, r);
+            return r->ok && jcanvas_connect(c, &c->nodes[from], &c->nodes[to]);
+        }
+        case JOURNAL_EDGE: {
+            uint32_t from = jr_node(c, r), to = jr_node(c, r);
+            id = jr_str(c, r);
+            uint8_t from_side = jr_u8(r), to_side = jr_u8(r), from_end = jr_u8(r), to_end = jr_u8(r);
+            str color = jr_str(c, r), label = jr_str(c, r);
+            if (!r->ok || from_side > SIDE_LEFT || to_side > SIDE_LEFT || from_end > END_ARROW || to_end > END_ARROW) return false;
+            jcanvas_edge* e = connect_with_id(c, from, to, id);
+            if (e == NULL) return false;
+            e->from_side = from_side; e->to_side = to_side; e->from_end = from_end; e->to_end = to_end;
+            e->color = make_sstr(color); e->label = label;
+            return true;
+        }
+        case JOURNAL_REMOVE_NODE: index = jr_node(c, r); return r->ok && jcanvas_remove_node(c, &c->nodes[index]);
+        case JOURNAL_REMOVE_EDGE: {
+            index = jr_u32(r);
+            return r->ok && index < c->edge_count && jcanvas_remove_edge(c, &c->edges[index]);
+        }
+        case JOURNAL_EDGE_LABEL: {
+            index = jr_u32(r); s = jr_str(c, r);
+            return r->ok && index < c->edge_count && jcanvas_set_edge_label_s(c, &c->edges[index], s);
+        }
+        case JOURNAL_EDGE_COLOR: {
+            index = jr_u32(r); s = jr_str(c, r);
+            return r->ok && index < c->edge_count && jcanvas_set_edge_color(c, &c->edges[index], make_sstr(s));
+        }
+        case JOURNAL_EDGE_ENDS: {
+            index = jr_u32(r);
+            uint8_t from_end = jr_u8(r), to_end = jr_u8(r);
+            if (!r->ok || index >= c->edge_count || from_end > END_ARROW || to_end > END_ARROW) return false;
+            return jcanvas_set_edge_ends(c, &c->edges[index], from_end, to_end);
+        }
+        case JOURNAL_MULTI_EDGES: {
+            uint8_t allow = jr_u8(r);
+            if (!r->ok || allow > 1) return false;
+            c->allow_multi_edges = c->journal_multi_edges = allow;
+            return true;
+        }
+        default: return false;
+    }
+}
+
+// as few records as make up the canvas as it is now
+static void journal_write_canvas(jcanvas* c, FILE* file)
+{
+    fwrite(JOURNAL_MAGIC, 1, 4, file);
+    journal_writer w = journal_begin(file, JOURNAL_MULTI_EDGES, 1);
+    jw_u8(&w, c->allow_multi_edges);
+    journal_end(&w);
+    c->journal_multi_edges = c->allow_multi_edges;
+    for (uint32_t i = 0; i < c->node_count; i++) journal_node_state(file, c, i);
+    for (uint32_t i = 0; i < c->edge_count; i++) journal_edge(file, &c->edges[i]);
+}
+
+static bool journal_replay(jcanvas* c, FILE* file, uint64_t size)
+{
+    str buf = {0};
+    uint64_t good = 4; // end of the last complete record
+    bool ok = true;
+    uint8_t head[5];
+    while (ok && size - good >= 9 && fread(head, 1, 5, file) == 5) {
+        uint32_t len = le32(head + 1);
+        if (size - good - 9 < len) break; // torn, the rest of the record never made it to the file
+        if (len + 4 > buf.cap) {
+            str_free(&c->allocator, &buf);
+            buf = str_init(&c->allocator, len + 4);
+            if (buf.data == NULL) {
+                c->last_error = "Not enough memory!";
+                return false;
+            }
+        }
+        const uint8_t* payload = (const uint8_t*)buf.data;
+        if (fread(buf.data, 1, len + 4, file) != len + 4) break;
+        if (journal_check(journal_check(JOURNAL_CHECK_BASIS, head, 5), payload, len) != le32(payload + len)) break;
+        journal_reader r = { payload, payload + len, true };
+        ok = journal_apply(c, head[0], &r);
+        if (ok) good += 9 + len;
+    }
+    str_free(&c->allocator, &buf);
+    if (!ok) {
+        c->last_error = "Journal doesn't replay onto this canvas!";
+        return false;
+    }
+    // the next edit overwrites a torn last record
+    if (!file_seek(file, (int64_t)good, SEEK_SET)) {
+        c->last_error = "Failed to seek in the journal!";
+        return false;
+    }
+    return true;
+}
+
+// replays the journal in file into the (empty) canvas and appends every later edit to it. an empty file
+// starts a new journal with the current canvas. file has to be opened for reading and writing ("r+b" or "w+b")
+bool jcanvas_journal_open(jcanvas* c, FILE* file)
+{
+    int64_t size;
+    if (!file_seek(file, 0, SEEK_END) || (size = file_tell(file)) < 0 || !file_seek(file, 0, SEEK_SET)) {
+        c->last_error = "Failed to seek in the journal!";
+        return false;
+    }
+    c->journal = NULL;
+    if (size == 0) return jcanvas_journal_compact(c, file);
+
+    char magic[4];
+    if (fread(magic, 1, 4, file) != 4 || !str_eq(make_str_l(magic, 4), make_str_l(JOURNAL_MAGIC, 4))) {
+        c->last_error = "Not a journal file!";
+        return false;
+    }
+    if (c->node_count > 0 || c->edge_count > 0) {
+        c->last_error = "A journal can only be replayed into an empty canvas!";
+        return false;
+    }
+    if (!journal_replay(c, file, (uint64_t)size)) return false;
+    c->journal = file;
+    return true;
+}
+
+// writes the canvas as it is now into file, which replaces the journal from then on. the caller
+// swaps the files (e.g. writes a temporary one and renames it over the old journal)
+bool jcanvas_journal_compact(jcanvas* c, FILE* file)
+{
+    c->journal = NULL;
+    journal_write_canvas(c, file);
+    if (fflush(file) != 0 || ferror(file)) {
+        c->last_error = "Failed to write the journal!";
+        return false;
+    }
+    c->journal = file;
+    return true;
+}
+
+// edits are written through the FILE's buffer, this pushes them to the file and reports write errors
+bool jcanvas_journal_flush(jcanvas* c)
+{
+    if (c->journal == NULL) return true;
+    if (fflush(c->journal) != 0 || ferror(c->journal)) {
+        c->last_error = "Failed to write the journal!";
+        return false;
+    }
+    return true;
+}
+
+// stops journaling, the file isn't closed
+bool jcanvas_journal_close(jcanvas* c)
+{
+    bool ok = jcanvas_journal_flush(c);
+    c->journal = NULL;
+    return ok;
+}
+//#endregion
+
+//#region id_index
+#define INDEX_HEADER_SIZE 24
+#define INDEX_ENTRY_SIZE 24
+#define INDEX_IO_ENTRIES 2048
+
+// header: "JCX1", u32 count, u32 cap, u32 reserved, u64 seed. then cap entries of u64 hash, u64 offset,
+// u32 len, u32 kind, all little endian
+static void put_le32(uint8_t* p, uint32_t v)
+{
+    p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24);
+}
+
+static void put_le64(uint8_t* p, uint64_t v)
+{
+    put_le32(p, (uint32_t)v); put_le32(p + 4, (uint32_t)(v >> 32));
+}
+
+static uint64_t le64(const uint8_t* p)
+{
+    return (uint64_t)le32(p) | (uint64_t)le32(p + 4) << 32;
+}
+
+static bool index_write(const jcanvas_index* index, FILE* file)
+{
+    uint8_t buf[INDEX_IO_ENTRIES * INDEX_ENTRY_SIZE];
+    copy_mem("JCX1", (char*)buf, 4);
+    put_le32(buf + 4, index->count); put_le32(buf + 8, index->cap); put_le32(buf + 12, 0);
+    put_le64(buf + 16, index->seed);
+    if (fwrite(buf, 1, INDEX_HEADER_SIZE, file) != INDEX_HEADER_SIZE) return false;
+
+    for (uint32_t i = 0; i < index->cap; i += INDEX_IO_ENTRIES) {
+        uint32_t n = index->cap - i < INDEX_IO_ENTRIES ? index->cap - i : INDEX_IO_ENTRIES;
+        for (uint32_t j = 0; j < n; j++) {
+            const jcanvas_index_entry* e = &index->entries[i + j];
+            uint8_t* p = buf + (size_t)j * INDEX_ENTRY_SIZE;
+            put_le64(p, e->hash); put_le64(p + 8, e->offset); put_le32(p + 16, e->len); put_le32(p + 20, e->kind);
+        }
+        if (fwrite(buf, INDEX_ENTRY_SIZE, n, file) != n) return false;
+    }
+    return fflush(file) == 0;
+}
+
+// like jcanvas_generate_to_file, and writes the offset and length of every node and edge into index_file,
+// so single objects can be read back with jcanvas_index_fetch without parsing the canvas
+bool jcanvas_generate_to_file_indexed(jcanvas* c, FILE* file, FILE* index_file)
+{
+    uint64_t objects = (uint64_t)c->node_count + c->edge_count;
+    uint32_t cap = 16;
+    while (cap < objects * 2) {
+        if (cap == 1u << 31) {
+            c->last_error = "Too many objects for an index!";
+            return false;
+        }
+        cap *= 2;
+    }
+    const jcanvas_allocator* a = &c->allocator;
+    jcanvas_index index = { .allocator = *a, .seed = c->hash_seed, .cap = cap };
+    index.entries = a->allocate(a->ctx, (size_t)cap * sizeof(jcanvas_index_entry));
+    if (index.entries == NULL) {
+        c->last_error = "Failed to allocate the index!";
+        return false;
+    }
+    for (uint32_t i = 0; i < cap; i++) index.entries[i].len = 0;
+
+    jcanvas_out out = { a };
+    out.buf = str_init(out.a, OUT_FLUSH_SIZE);
+    out.file = file;
+    out.index = &index;
+    bool ok = generate(c, &out) && out_flush(&out);
+    if (!ok) c->last_error = (char*)out.error;
+    str_free(out.a, &out.buf);
+    if (ok && !index_write(&index, index_file)) {
+        c->last_error = "Failed to write the index file!";
+        ok = false;
+    }
+    jcanvas_index_destroy(&index);
+    return ok;
+}
+
+// allocator may be NULL for the default one
+bool jcanvas_index_load(jcanvas_index* index, FILE* index_file, const jcanvas_allocator* allocator, const char** error)
+{
+    *index = (jcanvas_index){ .allocator = allocator ? *allocator : default_allocator };
+    uint8_t buf[INDEX_IO_ENTRIES * INDEX_ENTRY_SIZE];
+    if (fread(buf, 1, INDEX_HEADER_SIZE, index_file) != INDEX_HEADER_SIZE || !bytes_eq(buf, "JCX1", 4)) {
+        if (error) *error = "Not an index file";
+        return false;
+    }
+    uint32_t count = le32(buf + 4), cap = le32(buf + 8);
+    uint64_t seed = le64(buf + 16);
+    if (cap < 16 || (cap & (cap - 1)) != 0 || count >= cap) {
+        if (error) *error = "Invalid index file";
+        return false;
+    }
+    const jcanvas_allocator* a = &index->allocator;
+    jcanvas_index_entry* entries = a->allocate(a->ctx, (size_t)cap * sizeof(jcanvas_index_entry));
+    if (entries == NULL) {
+        if (error) *error = "Failed to allocate the index";
+        return false;
+    }
+
+    uint32_t used = 0;
+    for (uint32_t i = 0; i < cap; i += INDEX_IO_ENTRIES) {
+        uint32_t n = cap - i < INDEX_IO_ENTRIES ? cap - i : INDEX_IO_ENTRIES;
+        if (fread(buf, INDEX_ENTRY_SIZE, n, index_file) != n) {
+            a->free(a->ctx, entries, (size_t)cap * sizeof(jcanvas_index_entry));
+            if (error) *error = "Index file is truncated";
+            return false;
+        }
+        for (uint32_t j = 0; j < n; j++) {
+            const uint8_t* p = buf + (size_t)j * INDEX_ENTRY_SIZE;
+            entries[i + j] = (jcanvas_index_entry){ le64(p), le64(p + 8), le32(p + 16), le32(p + 20) };
+            used += entries[i + j].len != 0;
+        }
+    }
+    // lookups stop at an empty slot, a table without one (corrupt or crafted) would make them loop forever
+    if (used != count) {
+        a->free(a->ctx, entries, (size_t)cap * sizeof(jcanvas_index_entry));
+        if (error) *error = "Invalid index file";
+        return false;
+    }
+    index->seed = seed;
+    index->entries = entries;
+    index->count = count;
+    index->cap = cap;
+    if (error) *error = NULL;
+    return true;
+}
+
+// one positioned read: pread on linux, which doesn't move the file position so threads can share
+// canvas_file, a seek and read elsewhere
+static bool read_at(FILE* file, char* buf, uint32_t len, uint64_t offset)
+{
+#ifdef __linux__
+    int fd = fileno(file);
+    uint32_t done = 0;
+    while (done < len) {
+        ssize_t n = pread(fd, buf + done, len - done, (off_t)(offset + done));
+        if (n <= 0) return false;
+        done += (uint32_t)n;
+    }
+    return true;
+#else
+    if (!file_seek(file, (int64_t)offset, SEEK_SET)) return false;
+    return fread(buf, 1, len, file) == len;
+#endif
+}
+
+// a different id with the same hash doesn't match the start of the object: {"id":"<id>"
+static bool object_has_id(const char* object, uint32_t len, str id)
+{
+    return len > id.len + 8 && bytes_eq(object, "{\"id\":\"", 7) && bytes_eq(object + 7, id.data, id.len) && object[7 + id.len] == '"';
+}
+
+// reads the object with the given id from canvas_file (the file the index was written with) into buf and
+// returns its length, 0 if there is none. id is compared as it is written in the file. if the object is
+// longer than cap nothing is read and its length is returned, so the call can be repeated with a bigger buf
+uint32_t jcanvas_index_fetch(const jcanvas_index* index, FILE* canvas_file, str id, char* buf, uint32_t cap, const char** error)
+{
+    if (error) *error = NULL;
+    if (index->cap == 0) return 0;
+    uint64_t hash = jcanvas_hash(id, index->seed);
+    uint32_t mask = index->cap - 1;
+    // at most cap probes, also for an index that was filled up in memory
+    for (uint32_t i = (uint32_t)hash & mask, probes = 0; index->entries[i].len != 0 && probes < index->cap; i = (i + 1) & mask, probes++) {
+        const jcanvas_index_entry* e = &index->entries[i];
+        if (e->hash != hash) continue;
+        if (e->len > cap) return e->len;
+        if (!read_at(canvas_file, buf, e->len, e->offset)) {
+            if (error) *error = "Failed to read the canvas file";
+            return 0;
+        }
+        if (object_has_id(buf, e->len, id)) return e->len;
+    }
+    return 0;
+}
+
+// overwrites the fixed width fields at the end of a node object
+static bool patch_node_object(char* object, uint32_t len, const jcanvas_node* node)
+{
+    if (len < FIXED_TAIL_SIZE + 2 || object[len - 1] != '}') return false;
+    char* tail = object + len - FIXED_TAIL_SIZE;
+    if (!bytes_eq(tail - 2, "\",\"x\":\"", 7)) return false;
+    char color[FIXED_COLOR_WIDTH];
+    if (!fixed_color(color, node)) return false;
+    fixed_numbers(tail, node);
+    copy_mem(color, tail + FIXED_NUMBERS_SIZE, FIXED_COLOR_WIDTH);
+    return true;
+}
+
+static bool write_at(FILE* file, const char* buf, uint32_t len, uint64_t offset)
+{
+    if (!file_seek(file, (int64_t)offset, SEEK_SET)) return false;
+    return fwrite(buf, 1, len, file) == len;
+}
+
+// writes the positions and colors of the given nodes into canvas_file, which has to be generated with
+// fixed_width_fields and indexed (index loaded from its index file) and opened for reading and writing.
+// returns false if one of the nodes isn't in the file or its new color is too long for its field; the
+// nodes before it are patched already, generate the file again in that case
+bool jcanvas_patch_nodes(jcanvas* c, const jcanvas_index* index, FILE* canvas_file, const uint32_t* nodes, uint32_t count)
+{
+    if (count == 0) return true;
+    if (index->cap == 0) {
+        c->last_error = "Node isn't in the canvas file, generate it again!";
+        return false;
+    }
+    if (fflush(canvas_file) != 0) {
+        c->last_error = "Failed to write the canvas file!";
+        return false;
+    }
+    char* mapped = NULL;
+    uint64_t size = 0;
+#ifdef __linux__
+    // all patches go straight into the page cache, without a read and write per node
+    int fd = fileno(canvas_file);
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        size = (uint64_t)st.st_size;
+        mapped = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapped == MAP_FAILED) mapped = NULL;
+    }
+#endif
+    str scratch = {0};
+    bool ok = true;
+    uint32_t mask = index->cap - 1;
+    for (uint32_t n = 0; n < count && ok; n++) {
+        const jcanvas_node* node = &c->nodes[nodes[n]];
+        str id = sstr_view(&node->id);
+        uint64_t hash = jcanvas_hash(id, index->seed);
+        const jcanvas_index_entry* found = NULL;
+        char* object = NULL;
+        for (uint32_t i = (uint32_t)hash & mask, probes = 0; index->entries[i].len != 0 && !found && probes < index->cap; i = (i + 1) & mask, probes++) {
+            const jcanvas_index_entry* e = &index->entries[i];
+            if (e->hash != hash || e->kind != 0) continue;
+            if (mapped) {
+                if (e->offset > size || e->len > size - e->offset) continue;
+                object = mapped + e->offset;
+            }
+            else {
+                if (!ensure_capacity(&c->allocator, &scratch.cap, e->len, &scratch.data, 1)) {
+                    c->last_error = "Not enough memory!"; ok = false;
+                    break;
+                }
+                object = scratch.data;
+                if (!read_at(canvas_file, object, e->len, e->offset)) {
+                    c->last_error = "Failed to read the canvas file!"; ok = false;
+                    break;
+                }
+            }
+            if (object_has_id(object, e->len, id)) found = e;
+        }
+        if (!ok) break;
+        if (!found || !patch_node_object(object, found->len, node)) {
+            c->last_error = "Node doesn't fit the canvas file, generate it again!";
+            ok = false;
+        }
+        else if (!mapped && !write_at(canvas_file, object, found->len, found->offset)) {
+            c->last_error = "Failed to write the canvas file!";
+            ok = false;
+        }
+    }
+#ifdef __linux__
+    if (mapped) munmap(mapped, size);
+#endif
+    str_free(&c->allocator, &scratch);
+    return ok;
+}
+
+void jcanvas_index_destroy(jcanvas_index* index)
+{
+    const jcanvas_allocator* a = &index->allocator;
+    free_array(a, index->entries, index->cap, sizeof(jcanvas_index_entry));
+    index->entries = NULL;
+    index->count = index->cap = 0;
+}
+//#endregion
+
+//#region tiling
+typedef struct {
+    int64_t x, y;
+    uint32_t tile; // index + 1, 0 for empty slots
+} tile_slot;
+
+static int64_t floor_div(int64_t a, int64_t b)
+{
+    int64_t q = a / b;
+    return (a % b != 0 && a < 0) ? q - 1 : q;
+}
+
+// grid cell of the node's center
+static void node_cell(const jcanvas_node* node, int64_t tile_size, int64_t* x, int64_t* y)
+{
+    *x = floor_div((int64_t)node->x + (int64_t)node->width / 2, tile_size);
+    *y = floor_div((int64_t)node->y + (int64_t)node->height / 2, tile_size);
+}
+
+static uint64_t cell_hash(int64_t x, int64_t y)
+{
+    return mix64((uint64_t)x * 0x9e3779b97f4a7c15ull ^ (uint64_t)y);
+}
+
+static bool tile_slots_grow(const jcanvas_allocator* a, tile_slot** slots, uint32_t* cap)
+{
+    uint32_t new_cap = *cap ? *cap * 2 : 64;
+    tile_slot* result = a->allocate(a->ctx, (size_t)new_cap * sizeof(tile_slot));
+    if (result == NULL) return false;
+    for (uint32_t i = 0; i < new_cap; i++) result[i].tile = 0;
+    for (uint32_t i = 0; i < *cap; i++) {
+        if ((*slots)[i].tile == 0) continue;
+        uint32_t slot = cell_hash((*slots)[i].x, (*slots)[i].y) & (new_cap - 1);
+        while (result[slot].tile != 0) slot = (slot + 1) & (new_cap - 1);
+        result[slot] = (*slots)[i];
+    }
+    free_array(a, *slots, *cap, sizeof(tile_slot));
+    *slots = result; *cap = new_cap;
+    return true;
+}
+
+// index of the tile of cell x, y, added if it's new. UINT32_MAX if out of memory
+static uint32_t tiling_cell(const jcanvas_allocator* a, jcanvas_tiling* tiling, tile_slot** slots, uint32_t* slots_cap, int64_t x, int64_t y)
+{
+    if ((tiling->tile_count + 1) * 2 > *slots_cap && !tile_slots_grow(a, slots, slots_cap)) return UINT32_MAX;
+    uint32_t mask = *slots_cap - 1;
+    uint32_t slot = cell_hash(x, y) & mask;
+    for (; (*slots)[slot].tile != 0; slot = (slot + 1) & mask) {
+        if ((*slots)[slot].x == x && (*slots)[slot].y == y) return (*slots)[slot].tile - 1;
+    }
+    uint32_t needed = tiling->tile_count + 1 < 16 ? 16 : tiling->tile_count + 1;
+    if (!ensure_capacity(a, &tiling->tile_cap, needed, &tiling->tiles, sizeof(jcanvas_tile))) return UINT32_MAX;
+    tiling->tiles[tiling->tile_count] = (jcanvas_tile){ x, y, 0, 0, 0, 0 };
+    (*slots)[slot] = (tile_slot){ x, y, ++tiling->tile_count };
+    return tiling->tile_count - 1;
+}
+
+// splits the canvas into square tiles of tile_size. writing the tiles only reads the canvas and the
+// tiling, so ranges of them can be written on several threads with jcanvas_tiling_write_range. with
+// canonical_order the nodes and edges are visited sorted by id, so the tiles come in the order of their first
+// node and every list is sorted by id (the counting sort keeps the order)
+bool jcanvas_tiling_plan(jcanvas* c, jcanvas_tiling* tiling, int64_t tile_size)
+{
+    *tiling = (jcanvas_tiling){ .allocator = c->allocator, .tile_size = tile_size };
+    if (tile_size <= 0) {
+        c->last_error = "Tile size has to be positive!";
+        return false;
+    }
+    const jcanvas_allocator* a = &c->allocator;
+    uint32_t slots_cap = 0, cross_count = 0, inner_count = 0;
+    tile_slot* slots = NULL;
+    uint32_t* node_tile = c->node_count ? a->allocate(a->ctx, (size_t)c->node_count * sizeof(uint32_t)) : NULL;
+    bool ok = c->node_count == 0 || node_tile != NULL;
+    uint32_t* node_order = NULL;
+    uint32_t* edge_order = NULL;
+    if (ok && c->canonical_order) {
+        ok = id_order(a, c->node_count, node_id_of, c, &node_order) && id_order(a, c->edge_count, edge_id_of, c, &edge_order);
+    }
+
+    for (uint32_t k = 0; k < c->node_count && ok; k++) {
+        uint32_t i = node_order ? node_order[k] : k;
+        int64_t x, y;
+        node_cell(&c->nodes[i], tile_size, &x, &y);
+        node_tile[i] = tiling_cell(a, tiling, &slots, &slots_cap, x, y);
+        if (node_tile[i] == UINT32_MAX) ok = false;
+        else tiling->tiles[node_tile[i]].node_count++;
+    }
+    free_array(a, slots, slots_cap, sizeof(tile_slot));
+    if (ok && tiling->tile_cap > tiling->tile_count) {
+        // the tile list is final, give back what the growth left over (if that fails it's kept as it is)
+        jcanvas_tile* tiles = a->reallocate(a->ctx, tiling->tiles, (size_t)tiling->tile_cap * sizeof(jcanvas_tile), (size_t)tiling->tile_count * sizeof(jcanvas_tile));
+        if (tiles) { tiling->tiles = tiles; tiling->tile_cap = tiling->tile_count; }
+    }
+
+    for (uint32_t i = 0; i < c->edge_count && ok; i++) {
+        uint32_t from = node_tile[c->edges[i].from_index];
+        if (from == node_tile[c->edges[i].to_index]) { tiling->tiles[from].edge_count++; inner_count++; }
+        else cross_count++;
+    }
+    if (ok && c->node_count) ok = (tiling->nodes = a->allocate(a->ctx, (size_t)c->node_count * sizeof(uint32_t))) != NULL;
+    if (ok && inner_count) ok = (tiling->edges = a->allocate(a->ctx, (size_t)inner_count * sizeof(uint32_t))) != NULL;
+    if (ok && cross_count) ok = (tiling->cross_edges = a->allocate(a->ctx, (size_t)cross_count * sizeof(uint32_t))) != NULL;
+
+    if (ok) {
+        // counting sort by tile, the counts become cursors while placing
+        uint32_t node_begin = 0, edge_begin = 0;
+        for (uint32_t t = 0; t < tiling->tile_count; t++) {
+            jcanvas_tile* tile = &tiling->tiles[t];
+            tile->node_begin = node_begin; node_begin += tile->node_count; tile->node_count = 0;
+            tile->edge_begin = edge_begin; edge_begin += tile->edge_count; tile->edge_count = 0;
+        }
+        for (uint32_t k = 0; k < c->node_count; k++) {
+            uint32_t i = node_order ? node_order[k] : k;
+            jcanvas_tile* tile = &tiling->tiles[node_tile[i]];
+            tiling->nodes[tile->node_begin + tile->node_count++] = i;
+        }
+        for (uint32_t k = 0; k < c->edge_count; k++) {
+            uint32_t i = edge_order ? edge_order[k] : k;
+            uint32_t from = node_tile[c->edges[i].from_index];
+            if (from == node_tile[c->edges[i].to_index]) {
+                jcanvas_tile* tile = &tiling->tiles[from];
+                tiling->edges[tile->edge_begin + tile->edge_count++] = i;
+            }
+            else tiling->cross_edges[tiling->cross_edge_count++] = i;
+        }
+    }
+    free_array(a, node_tile, c->node_count, sizeof(uint32_t));
+    free_array(a, node_order, c->node_count, sizeof(uint32_t));
+    free_array(a, edge_order, c->edge_count, sizeof(uint32_t));
+    if (!ok) {
+        free_array(a, tiling->tiles, tiling->tile_cap, sizeof(jcanvas_tile));
+        tiling->tiles = NULL; tiling->tile_count = 0;
+        free_array(a, tiling->nodes, c->node_count, sizeof(uint32_t));
+        free_array(a, tiling->edges, inner_count, sizeof(uint32_t));
+        free_array(a, tiling->cross_edges, cross_count, sizeof(uint32_t));
+        *tiling = (jcanvas_tiling){ .allocator = c->allocator, .tile_size = tile_size };
+        c->last_error = "Not enough memory!";
+    }
+    return ok;
+}
+
+static void append_tile_name(const jcanvas_allocator* a, str* s, int64_t x, int64_t y)
+{
+    char buf[50];
+    str_append(a, s, "tile_", 5);
+    str_append(a, s, buf, int_to_str(buf, x));
+    str_append(a, s, "_", 1);
+    str_append(a, s, buf, int_to_str(buf, y));
+    str_append(a, s, ".canvas", 7);
+}
+
+static FILE* open_in_dir(const jcanvas_allocator* a, const char* dir, const char* name, int64_t x, int64_t y)
+{
+    str path = {0};
+    str_append(a, &path, (char*)dir, 0);
+    if (path.len > 0 && path.data[path.len - 1] != '/') str_append(a, &path, "/", 1);
+    if (name) str_append(a, &path, (char*)name, 0);
+    else append_tile_name(a, &path, x, y);
+    str_append(a, &path, "\0", 1);
+    FILE* file = path.data ? fopen(path.data, "wb") : NULL;
+    str_free(a, &path);
+    return file;
+}
+
+// writes tiles [begin, end) into out_dir as tile_<x>_<y>.canvas
+bool jcanvas_tiling_write_range(jcanvas* c, const jcanvas_tiling* tiling, const char* out_dir, uint32_t begin, uint32_t end, const char** error)
+{
+    const jcanvas_allocator* a = &c->allocator;
+    const char* failed = NULL;
+    for (uint32_t t = begin; t < end && t < tiling->tile_count && failed == NULL; t++) {
+        const jcanvas_tile* tile = &tiling->tiles[t];
+        FILE* file = open_in_dir(a, out_dir, NULL, tile->x, tile->y);
+        if (file == NULL) {
+            failed = "Failed to create a tile file";
+            break;
+        }
+        jcanvas_out out = { a };
+        out.buf = str_init(a, OUT_FLUSH_SIZE);
+        out.file = file;
+        const uint32_t* edges = tiling->edges ? tiling->edges + tile->edge_begin : NULL; // NULL would mean all edges, but edge_count is 0 then
+        if (generate_objects(c, &out, tiling->nodes + tile->node_begin, tile->node_count, edges, tile->edge_count)) out_flush(&out);
+        if (fclose(file) != 0 && out.error == NULL) out.error = "Failed to write a tile file";
+        str_free(a, &out.buf);
+        failed = out.error;
+    }
+    if (error) *error = failed;
+    return failed == NULL;
+}
+
+// writes manifest.json into out_dir: the tiles with their files, and the edges between tiles with the files
+// of both ends. numbers are quoted like in canvas files
+bool jcanvas_tiling_write_manifest(jcanvas* c, const jcanvas_tiling* tiling, const char* out_dir, const char** error)
+{
+    const jcanvas_allocator* a = &c->allocator;
+    FILE* file = open_in_dir(a, out_dir, "manifest.json", 0, 0);
+    if (file == NULL) {
+        if (error) *error = "Failed to create the manifest";
+        return false;
+    }
+    jcanvas_out out = { a };
+    out.buf = str_init(a, OUT_FLUSH_SIZE);
+    out.file = file;
+    str* result = &out.buf;
+    char buf[50];
+    str_append(a, result, "{\"tileSize\":\"", 13); str_append(a, result, buf, int_to_str(buf, tiling->tile_size));
+    str_append(a, result, "\",\"tiles\":[", 11);
+    for (uint32_t t = 0; t < tiling->tile_count && out.error == NULL; t++) {
+        const jcanvas_tile* tile = &tiling->tiles[t];
+        if (t > 0) str_append(a, result, ",", 1);
+        str_append(a, result, "{\"x\":\"", 6); str_append(a, result, buf, int_to_str(buf, tile->x));
+        str_append(a, result, "\",\"y\":\"", 7); str_append(a, result, buf, int_to_str(buf, tile->y));
+        str_append(a, result, "\",\"file\":\"", 10); append_tile_name(a, result, tile->x, tile->y);
+        str_append(a, result, "\",\"nodes\":\"", 11); str_append(a, result, buf, int_to_str(buf, tile->node_count));
+        str_append(a, result, "\",\"edges\":\"", 11); str_append(a, result, buf, int_to_str(buf, tile->edge_count));
+        str_append(a, result, "\"}", 2);
+        out_maybe_flush(&out);
+    }
+    str_append(a, result, "],\"crossEdges\":[", 16);
+    for (uint32_t i = 0; i < tiling->cross_edge_count && out.error == NULL; i++) {
+        const jcanvas_edge* edge = &c->edges[tiling->cross_edges[i]];
+        int64_t x, y;
+        if (i > 0) str_append(a, result, ",", 1);
+        node_cell(&c->nodes[edge->from_index], tiling->tile_size, &x, &y);
+        str_append(a, result, "{\"fromTile\":\"", 13); append_tile_name(a, result, x, y);
+        node_cell(&c->nodes[edge->to_index], tiling->tile_size, &x, &y);
+        str_append(a, result, "\",\"toTile\":\"", 12); append_tile_name(a, result, x, y);
+        str_append(a, result, "\",\"edge\":", 9);
+        jcanvas_generate_edge(&out, edge);
+        str_append(a, result, "}", 1);
+        out_maybe_flush(&out);
+    }
+    str_append(a, result, "]}", 2);
+    out_flush(&out);
+    if (fclose(file) != 0 && out.error == NULL) out.error = "Failed to write the manifest";
+    str_free(a, &out.buf);
+    if (error) *error = out.error;
+    return out.error == NULL;
+}
+
+void jcanvas_tiling_destroy(jcanvas_tiling* tiling)
+{
+    const jcanvas_allocator* a = &tiling->allocator;
+    uint32_t node_total = 0, edge_total = 0;
+    if (tiling->tile_count > 0) {
+        const jcanvas_tile* last = &tiling->tiles[tiling->tile_count - 1];
+        node_total = last->node_begin + last->node_count;
+        edge_total = last->edge_begin + last->edge_count;
+    }
+    free_array(a, tiling->tiles, tiling->tile_cap, sizeof(jcanvas_tile));
+    free_array(a, tiling->nodes, node_total, sizeof(uint32_t));
+    free_array(a, tiling->edges, edge_total, sizeof(uint32_t));
+    free_array(a, tiling->cross_edges, tiling->cross_edge_count, sizeof(uint32_t));
+    *tiling = (jcanvas_tiling){ .allocator = *a };
+}
+
+// splits the canvas into tiles of tile_size and writes them and their manifest into out_dir, which has to exist
+bool jcanvas_generate_tiled(jcanvas* c, int64_t tile_size, const char* out_dir)
+{
+    jcanvas_tiling tiling;
+    if (!jcanvas_tiling_plan(c, &tiling, tile_size)) return false;
+    const char* error = NULL;
+    bool ok = jcanvas_tiling_write_range(c, &tiling, out_dir, 0, tiling.tile_count, &error)
+        && jcanvas_tiling_write_manifest(c, &tiling, out_dir, &error);
+    if (!ok) c->last_error = (char*)error;
+    jcanvas_tiling_destroy(&tiling);
+    return ok;
+}
+//#endregion
+
+//#region lod
+// spreads the low 32 bits of v over the even bits
+static uint64_t morton_spread(uint64_t v)
+{
+    v &= 0xffffffffull;
+    v = (v | v << 16) & 0x0000ffff0000ffffull;
+    v = (v | v << 8) & 0x00ff00ff00ff00ffull;
+    v = (v | v << 4) & 0x0f0f0f0f0f0f0f0full;
+    v = (v | v << 2) & 0x3333333333333333ull;
+    v = (v | v << 1) & 0x5555555555555555ull;
+    return v;
+}
+
+// same node in another canvas with the same hash seed, strings are shared with the original
+static jcanvas_node* copy_node(jcanvas* c, const jcanvas* from, const jcanvas_node* node, const jcanvas_node_extra* extra)
+{
+    if (extra && !extras_prepare(c)) {
+        c->last_error = "Not enough memory!";
+        return NULL;
+    }
+    jcanvas_node* result = make_node_hashed(c, sstr_view(&node->id), node_id_hash((jcanvas*)from, node), node->type);
+    if (result == NULL) return NULL;
+    result->text_in_file = node->text_in_file;
+    result->as = node->as;
+    result->x = node->x; result->y = node->y; result->width = node->width; result->height = node->height;
+    jcanvas_set_color(c, result, jcanvas_get_color(node));
+    if (extra) *node_extra_make(c, c->node_count - 1) = *extra;
+    return result;
+}
+
+// "<count> <what>" in the canvas' own memory
+static str lod_count_label(jcanvas* c, uint32_t count, const char* what, uint32_t what_len)
+{
+    char buf[50];
+    int len = int_to_str(buf, count);
+    char* data = owned_string_alloc(c, len + 1 + what_len);
+    if (data == NULL) return (str){0};
+    copy_mem(buf, data, len);
+    data[len] = ' ';
+    copy_mem((char*)what, data + len + 1, what_len);
+    return make_str_l(data, len + 1 + what_len);
+}
+
+// whether an id of the nodes (edges) of c starts with "lod", only then the ids made up for the levels can clash
+// with the ones copied from c
+static bool lod_prefix_taken(const jcanvas* c, bool edges)
+{
+    uint32_t count = edges ? c->edge_count : c->node_count;
+    for (uint32_t i = 0; i < count; i++) {
+        str id = sstr_view(edges ? &c->edges[i].id : &c->nodes[i].id);
+        if (id.len >= 3 && id.data[0] == 'l' && id.data[1] == 'o' && id.data[2] == 'd') return true;
+    }
+    return false;
+}
+
+// "lod<level>-<number>" for a group, "lod<level>-e<number>" for a merged edge. the numbers make them unique
+// within the level, so they only have to be checked against the ids of the canvas the level is made from (the
+// copied ones), in taken. ' is appended until it's free. it's put together in buf and only copied into lod's
+// memory then, the canvases share their hash seed so the hash is good for both
+static bool lod_id(jcanvas* lod, map* taken, uint32_t level, bool edge, uint32_t number, sstr* id, uint64_t* hash)
+{
+    char buf[128];
+    uint32_t len = 3;
+    copy_mem("lod", buf, 3);
+    len += int_to_str(buf + len, level);
+    buf[len++] = '-';
+    if (edge) buf[len++] = 'e';
+    len += int_to_str(buf + len, number);
+    *id = (sstr){0};
+    *hash = jcanvas_hash(make_str_l(buf, len), lod->hash_seed);
+    while (taken && map_get(taken, make_str_l(buf, len), *hash, NULL)) {
+        if (len == sizeof(buf)) {
+            lod->last_error = edge ? "Failed to make an edge id!" : "Failed to make a group id!";
+            return false;
+        }
+        buf[len++] = '\'';
+        *hash = jcanvas_hash(make_str_l(buf, len), lod->hash_seed);
+    }
+    if (!instance_id(lod, (str){0}, make_str_l(buf, len), edge, id)) {
+        lod->last_error = "Not enough memory!";
+        return false;
+    }
+    return true;
+}
+
+// a cell of one level: the bounds of the nodes in it, and the node itself if it's alone
+typedef struct lod_cluster {
+    uint64_t cell;
+    int64_t x0, y0, x1, y1;
+    uint32_t count, node;
+} lod_cluster;
+
+// the clusters of the finest level, runs of nodes (sorted by cell) in the same cell. cluster_of gets the
+// cluster of every node
+static uint32_t lod_first_clusters(const jcanvas* c, const uint64_t* cells, const uint32_t* order, lod_cluster* clusters, uint32_t* cluster_of)
+{
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < c->node_count; i++) {
+        const jcanvas_node* n = &c->nodes[order[i]];
+        lod_cluster k = { cells[i], n->x, n->y, (int64_t)n->x + n->width, (int64_t)n->y + n->height, 1, order[i] };
+        if (count > 0 && clusters[count - 1].cell == k.cell) {
+            lod_cluster* last = &clusters[count - 1];
+            if (k.x0 < last->x0) last->x0 = k.x0;
+            if (k.y0 < last->y0) last->y0 = k.y0;
+            if (k.x1 > last->x1) last->x1 = k.x1;
+            if (k.y1 > last->y1) last->y1 = k.y1;
+            last->count++;
+        } else clusters[count++] = k;
+        cluster_of[order[i]] = count - 1;
+    }
+    return count;
+}
+
+// merges the clusters of 2 by 2 cells into the ones of the next level, in place, the morton order keeps them
+// next to each other. parent gets the new cluster of every old one
+static uint32_t lod_merge_clusters(lod_cluster* clusters, uint32_t count, uint32_t* parent)
+{
+    uint32_t merged = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        lod_cluster k = clusters[i];
+        k.cell >>= 2;
+        if (merged > 0 && clusters[merged - 1].cell == k.cell) {
+            lod_cluster* last = &clusters[merged - 1];
+            if (k.x0 < last->x0) last->x0 = k.x0;
+            if (k.y0 < last->y0) last->y0 = k.y0;
+            if (k.x1 > last->x1) last->x1 = k.x1;
+            if (k.y1 > last->y1) last->y1 = k.y1;
+            last->count += k.count;
+        } else clusters[merged++] = k;
+        parent[i] = merged - 1;
+    }
+    return merged;
+}
+
+// sorts the links (pair_key of two clusters in keys, count << 32 | edge in links) and merges the ones between
+// the same clusters, summing their counts. the edge is kept for a link of one edge
+static bool lod_sort_links(const jcanvas_allocator* a, uint32_t cluster_count, uint64_t* keys, uint64_t* links, uint32_t* count, uint32_t* order, uint64_t* scratch)
+{
+    uint32_t n = *count, cluster_bits = 0;
+    while (cluster_bits < 32 && (1ull << cluster_bits) < cluster_count) cluster_bits++;
+    for (uint32_t i = 0; i < n; i++) order[i] = i;
+    if (!radix_sort(a, keys, order, n, 32 + cluster_bits)) return false;
+    for (uint32_t i = 0; i < n; i++) scratch[i] = links[order[i]];
+    uint32_t unique = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        if (unique > 0 && keys[unique - 1] == keys[i]) links[unique - 1] += scratch[i] & 0xffffffff00000000ull;
+        else {
+            keys[unique] = keys[i];
+            links[unique++] = scratch[i];
+        }
+    }
+    *count = unique;
+    return true;
+}
+
+// the links of the next level: both ends go to their parent clusters, links within one are dropped
+static void lod_merge_links(uint64_t* keys, uint64_t* links, uint32_t* count, const uint32_t* parent)
+{
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < *count; i++) {
+        uint32_t from = parent[keys[i] >> 32], to = parent[(uint32_t)keys[i]];
+        if (from == to) continue;
+        keys[kept] = pair_key(from, to);
+        links[kept++] = links[i];
+    }
+    *count = kept;
+}
+
+// a node of lod for every cluster, the node itself if it's alone, a group around the nodes labeled with their
+// count otherwise
+static bool lod_nodes(jcanvas* c, jcanvas* lod, uint32_t level, map* taken, const lod_cluster* clusters, uint32_t count)
+{
+    bool ok = ensure_capacity(&lod->allocator, &lod->node_cap, count, &lod->nodes, sizeof(jcanvas_node))
+        && bitmaps_reserve(lod, lod->node_cap) && extras_reserve(lod, lod->node_cap)
+        && map_reserve(&lod->allocator, &lod->id_to_nodes, count);
+    if (!ok) return false;
+    for (uint32_t k = 0; k < count; k++) {
+        const lod_cluster* cluster = &clusters[k];
+        if (cluster->count == 1) {
+            if (copy_node(lod, c, &c->nodes[cluster->node], node_extra(c, cluster->node)) == NULL) return false;
+            continue;
+        }
+        sstr id;
+        uint64_t hash;
+        if (!lod_id(lod, taken, level, false, k, &id, &hash)) return false;
+        jcanvas_node* node = make_node_hashed(lod, sstr_view(&id), hash, NODE_TYPE_GROUP);
+        if (node == NULL) return false;
+        node->as.group_node.label = lod_count_label(lod, cluster->count, "nodes", 5);
+        if (node->as.group_node.label.data == NULL) return false;
+        jcanvas_pos_node(lod, node, cluster->x0, cluster->y0, cluster->x1 - cluster->x0, cluster->y1 - cluster->y0);
+    }
+    return true;
+}
+#define LOD_PREFETCH_DISTANCE 8
+
+// an edge of lod for every link, the edge itself if it's alone, an edge labeled with the count otherwise.
+// the edges are made first, then go into the reserved maps in one pass that prefetches a few slots ahead like
+// jcanvas_instantiate, the keys and ids are unique already
+static bool lod_edges(jcanvas* c, jcanvas* lod, uint32_t level, map* taken, const uint64_t* keys, const uint64_t* links, uint32_t count)
+{
+    const jcanvas_allocator* a = &lod->allocator;
+    bool ok = ensure_capacity(a, &lod->edge_cap, count, &lod->edges, sizeof(jcanvas_edge))
+        && map_reserve(a, &lod->id_to_edges, count)
+        && pair_set_reserve(a, &lod->edge_pairs, count);
+    if (!ok) return false;
+    uint32_t made = 0;
+    // the kept edges first, in the order of their links like the merged ones
+    for (uint32_t pass = 0; pass < 2 && ok; pass++) {
+        for (uint32_t i = 0; i < count && ok; i++) {
+            uint32_t edges = (uint32_t)(links[i] >> 32);
+            if ((edges == 1) != (pass == 0)) continue;
+            uint32_t from = (uint32_t)(keys[i] >> 32), to = (uint32_t)keys[i];
+            jcanvas_edge* edge = &lod->edges[made];
+            if (pass == 0) {
+                const jcanvas_edge* original = &c->edges[(uint32_t)links[i]];
+                *edge = *original;
+                edge->id = (sstr){0};
+                ok = instance_id(lod, (str){0}, sstr_view(&original->id), true, &edge->id);
+            } else {
+                *edge = (jcanvas_edge){0};
+                ok = lod_id(lod, taken, level, true, made, &edge->id, &edge->id_hash);
+                if (ok) edge->label = lod_count_label(lod, edges, "edges", 5);
+                if (ok) ok = edge->label.data != NULL;
+            }
+            if (!ok) {
+                edge_id_free(a, &edge->id);
+                break;
+            }
+            edge->from_index = from; edge->to_index = to;
+            edge->from_node = lod->nodes[from].id; edge->to_node = lod->nodes[to].id;
+            if (pass == 1) jcanvas_infer_edge_sides(edge, &lod->nodes[from], &lod->nodes[to]);
+            made++;
+        }
+    }
+    map* edges_map = &lod->id_to_edges;
+    pair_set* pairs = &lod->edge_pairs;
+    for (uint32_t i = 0; i < made && ok; i++) {
+        if (i + LOD_PREFETCH_DISTANCE < made) {
+            const jcanvas_edge* ahead = &lod->edges[i + LOD_PREFETCH_DISTANCE];
+            PREFETCH(&edges_map->slots[ahead->id_hash & (edges_map->cap - 1)]);
+            PREFETCH(&pairs->keys[mix64(pair_key(ahead->from_index, ahead->to_index)) & (pairs->cap - 1)]);
+        }
+        jcanvas_edge* edge = &lod->edges[i];
+        ok = map_insert_reserved(edges_map, edge->id, edge->id_hash, i)
+            && pair_set_insert(a, pairs, pair_key(edge->from_index, edge->to_index));
+        if (ok) lod->edge_count++;
+    }
+    for (uint32_t i = lod->edge_count; i < made; i++) edge_id_free(a, &lod->edges[i].id);
+    view_edges_changed(lod, 0, lod->edge_count);
+    lod->adjacency.valid = false;
+    return ok;
+}
+
+// fills result[0] to result[levels - 1] with coarser and coarser versions of the canvas. the bounds of the node
+// centers are split into 2^finest by 2^finest cells for result[0], every next level merges 2 by 2 cells of the
+// one before (a quadtree). the nodes of a cell become a group labeled with their count, edges from one cell to
+// another one edge. the nodes are sorted by cell once, after that each level is made from the clusters and
+// merged edges of the one before, so the coarse levels cost as much as they have nodes and edges
+bool jcanvas_build_lod(jcanvas* c, uint32_t levels, uint32_t finest, jcanvas* result)
+{
+    if (finest > 31 || levels == 0 || levels > finest + 1) {
+        c->last_error = "Levels have to be between 1 and finest + 1, and finest at most 31!";
+        return false;
+    }
+    const jcanvas_allocator* a = &c->allocator;
+    uint32_t initialized = 0;
+    bool ok = true;
+    for (; initialized < levels && ok; initialized++) {
+        ok = jcanvas_init_with_allocator(&result[initialized], a);
+        // so the hashes cached on the nodes and edges of c are good for the levels too
+        if (ok) result[initialized].hash_seed = c->hash_seed;
+    }
+    if (!ok) initialized--;
+
+    uint32_t n = c->node_count, e = c->edge_count, sorted = n > e ? n : e;
+    uint64_t* cells = n ? a->allocate(a->ctx, (size_t)n * sizeof(uint64_t)) : NULL;
+    uint32_t* order = sorted ? a->allocate(a->ctx, (size_t)sorted * sizeof(uint32_t)) : NULL;
+    lod_cluster* clusters = n ? a->allocate(a->ctx, (size_t)n * sizeof(lod_cluster)) : NULL;
+    uint32_t* parent = n ? a->allocate(a->ctx, (size_t)n * sizeof(uint32_t)) : NULL;
+    uint64_t* keys = e ? a->allocate(a->ctx, (size_t)e * sizeof(uint64_t)) : NULL;
+    uint64_t* links = e ? a->allocate(a->ctx, (size_t)e * sizeof(uint64_t)) : NULL;
+    uint64_t* scratch = e ? a->allocate(a->ctx, (size_t)e * sizeof(uint64_t)) : NULL;
+    if (n && (cells == NULL || order == NULL || clusters == NULL || parent == NULL)) ok = false;
+    if (e && (keys == NULL || links == NULL || scratch == NULL)) ok = false;
+    if (!ok) c->last_error = "Not enough memory!";
+
+    uint32_t cluster_count = 0, link_count = 0;
+    if (ok && n > 0) {
+        int64_t x0 = INT64_MAX, y0 = INT64_MAX, x1 = INT64_MIN, y1 = INT64_MIN;
+        for (uint32_t i = 0; i < n; i++) {
+            int64_t x = (int64_t)c->nodes[i].x + (int64_t)c->nodes[i].width / 2;
+            int64_t y = (int64_t)c->nodes[i].y + (int64_t)c->nodes[i].height / 2;
+            if (x < x0) x0 = x;
+            if (x > x1) x1 = x;
+            if (y < y0) y0 = y;
+            if (y > y1) y1 = y;
+        }
+        // cell size 2^scale, so the larger side of the bounds fits 2^finest cells
+        uint64_t side = (uint64_t)(x1 - x0) > (uint64_t)(y1 - y0) ? (uint64_t)(x1 - x0) : (uint64_t)(y1 - y0);
+        uint32_t scale = 0;
+        while (scale < 64 && (side >> scale) >= (1ull << finest)) scale++;
+        for (uint32_t i = 0; i < n; i++) {
+            uint64_t x = ((uint64_t)((int64_t)c->nodes[i].x + (int64_t)c->nodes[i].width / 2 - x0)) >> scale;
+            uint64_t y = ((uint64_t)((int64_t)c->nodes[i].y + (int64_t)c->nodes[i].height / 2 - y0)) >> scale;
+            cells[i] = morton_spread(x) | morton_spread(y) << 1;
+            order[i] = i;
+        }
+        ok = radix_sort(a, cells, order, n, 2 * finest);
+        if (ok) {
+            cluster_count = lod_first_clusters(c, cells, order, clusters, parent);
+            for (uint32_t i = 0; i < e; i++) {
+                uint32_t from = parent[c->edges[i].from_index], to = parent[c->edges[i].to_index];
+                if (from == to) continue;
+                keys[link_count] = pair_key(from, to);
+                links[link_count++] = 1ull << 32 | i;
+            }
+            ok = lod_sort_links(a, cluster_count, keys, links, &link_count, order, scratch);
+        }
+        if (!ok) c->last_error = "Not enough memory!";
+    }
+
+    map* nodes_taken = lod_prefix_taken(c, false) ? &c->id_to_nodes : NULL;
+    map* edges_taken = lod_prefix_taken(c, true) ? &c->id_to_edges : NULL;
+    for (uint32_t level = 0; level < levels && ok; level++) {
+        if (level > 0) {
+            uint32_t before = cluster_count;
+            cluster_count = lod_merge_clusters(clusters, before, parent);
+            lod_merge_links(keys, links, &link_count, parent);
+            ok = lod_sort_links(a, cluster_count, keys, links, &link_count, order, scratch);
+            if (!ok) {
+                c->last_error = "Not enough memory!";
+                break;
+            }
+        }
+        ok = lod_nodes(c, &result[level], level, nodes_taken, clusters, cluster_count)
+            && lod_edges(c, &result[level], level, edges_taken, keys, links, link_count);
+        if (!ok) c->last_error = result[level].last_error ? result[level].last_error : "Not enough memory!";
+    }
+
+    free_array(a, cells, n, sizeof(uint64_t));
+    free_array(a, order, sorted, sizeof(uint32_t));
+    free_array(a, clusters, n, sizeof(lod_cluster));
+    free_array(a, parent, n, sizeof(uint32_t));
+    free_array(a, keys, e, sizeof(uint64_t));
+    free_array(a, links, e, sizeof(uint64_t));
+    free_array(a, scratch, e, sizeof(uint64_t));
+    if (!ok) {
+        for (uint32_t i = 0; i < initialized; i++) jcanvas_destroy(&result[i]);
+    }
+    return ok;
+}
+//#endregion
+
+//#region instancing
+// undoes a failed jcanvas_instantiate, everything past the given counts was added by it
+static void instances_remove(jcanvas* c, uint32_t node_count, uint32_t edge_count, uint32_t extra_count)
+{
+    while (c->edge_count > edge_count) {
+        jcanvas_edge* e = &c->edges[--c->edge_count];
+        map_remove(&c->id_to_edges, sstr_view(&e->id), e->id_hash);
+        pair_set_remove(&c->edge_pairs, pair_key(e->from_index, e->to_index));
+        edge_id_free(&c->allocator, &e->id);
+    }
+    while (c->node_count > node_count) {
+        uint32_t index = --c->node_count;
+        map_remove(&c->id_to_nodes, sstr_view(&c->nodes[index].id), node_id_hash(c, &c->nodes[index]));
+        for (uint32_t set = 0; set < JCANVAS_BITMAP_SETS; set++) bitmap_put(&c->bitmaps, set, index, false);
+        if (c->extra_of) c->extra_of[index] = JCANVAS_NO_EXTRA;
+    }
+    c->extra_count = extra_count;
+}
+
+// ids of edges that were copied but not added yet
+static void instance_edge_ids_free(jcanvas* c, uint32_t from, uint32_t to)
+{
+    for (uint32_t i = from; i < to; i++) edge_id_free(&c->allocator, &c->edges[i].id);
+}
+
+#define INSTANCE_PREFETCH_DISTANCE 8
+
+// adds count copies of the nodes and edges of template_canvas. instance i gets the ids of the template
+// prefixed with id_prefix(user, i) and is moved by offsets[i] (offsets may be NULL).
+// the copies are made first, then their ids go into the reserved id maps in one pass that prefetches
+// the slots a few ids ahead, since at this size nearly every probe misses the cache.
+// strings other than ids are shared with the template, so they have to outlive c like any other str.
+// if an id is taken already, nothing is added
+bool jcanvas_instantiate(jcanvas* c, const jcanvas* template_canvas, uint32_t count, const jcanvas_offset* offsets, jcanvas_id_prefix_fn id_prefix, void* user)
+{
+    const jcanvas* t = template_canvas;
+    const jcanvas_allocator* a = &c->allocator;
+    if (c == t) {
+        c->last_error = "A canvas can't be instantiated into itself!";
+        return false;
+    }
+    uint64_t new_nodes = (uint64_t)count * t->node_count, new_edges = (uint64_t)count * t->edge_count;
+    if (c->node_count + new_nodes >= MAP_EMPTY || c->edge_count + new_edges >= MAP_EMPTY) {
+        c->last_error = "Too many nodes or edges!";
+        return false;
+    }
+    uint32_t first_node = c->node_count, first_edge = c->edge_count, first_extra = c->extra_count;
+    uint32_t node_end = first_node + (uint32_t)new_nodes, edge_end = first_edge + (uint32_t)new_edges;
+
+    // the hashes of the new node ids, then of the new edge ids
+    uint32_t hashes_cap = (uint32_t)(new_nodes + new_edges);
+    uint64_t* hashes = hashes_cap ? a->allocate(a->ctx, (size_t)hashes_cap * sizeof(uint64_t)) : NULL;
+    bool ok = hashes_cap == 0 || hashes != NULL;
+    if (ok) ok = nodes_reserve(c, node_end, false);
+    if (ok && t->extra_count > 0) {
+        ok = extras_prepare(c);
+        if (ok) ok = ensure_capacity(a, &c->extra_cap, c->extra_count + count * t->extra_count, &c->extras, sizeof(jcanvas_node_extra));
+    }
+    if (ok) ok = extras_reserve(c, c->node_cap);
+    if (ok) ok = map_reserve(a, &c->id_to_nodes, node_end);
+    if (ok) ok = edges_reserve(c, edge_end, false);
+    if (ok) ok = map_reserve(a, &c->id_to_edges, edge_end);
+    if (ok) ok = pair_set_reserve(a, &c->edge_pairs, c->edge_pairs.count + (uint32_t)new_edges);
+    if (!ok) {
+        free_array(a, hashes, hashes_cap, sizeof(uint64_t));
+        c->last_error = "Not enough memory!";
+        return false;
+    }
+
+    // copy the nodes and edges with their new ids and positions
+    char* error = NULL;
+    uint32_t node_at = first_node, edge_at = first_edge;
+    for (uint32_t k = 0; k < count && error == NULL; k++) {
+        str prefix = id_prefix(user, k);
+        int64_t dx = offsets ? offsets[k].x : 0, dy = offsets ? offsets[k].y : 0;
+        uint32_t base = node_at;
+        for (uint32_t i = 0; i < t->node_count; i++) {
+            const jcanvas_node* from = &t->nodes[i];
+            jcanvas_node* node = &c->nodes[node_at];
+            int64_t x = from->x + dx, y = from->y + dy;
+            if (!coords_fit(x, y, from->width, from->height)) {
+                error = "Instance coordinates don't fit compact nodes";
+                break;
+            }
+            *node = *from;
+            node->x = x; node->y = y; node->id = (sstr){0};
+            if (!instance_id(c, prefix, sstr_view(&from->id), false, &node->id)) {
+                error = "Not enough memory!";
+                break;
+            }
+            uint64_t hash = jcanvas_hash(sstr_view(&node->id), c->hash_seed);
+#ifndef JCANVAS_COMPACT_NODES
+            node->id_hash = hash;
+#endif
+            hashes[node_at++ - first_node] = hash;
+        }
+        for (uint32_t i = 0; i < t->edge_count && error == NULL; i++) {
+            const jcanvas_edge* from = &t->edges[i];
+            jcanvas_edge* edge = &c->edges[edge_at];
+            *edge = *from;
+            edge->id = (sstr){0};
+            if (!instance_id(c, prefix, sstr_view(&from->id), true, &edge->id)) {
+                error = "Not enough memory!";
+                break;
+            }
+            edge->id_hash = jcanvas_hash(sstr_view(&edge->id), c->hash_seed);
+            edge->from_index = base + from->from_index; edge->to_index = base + from->to_index;
+            edge->from_node = c->nodes[edge->from_index].id; edge->to_node = c->nodes[edge->to_index].id;
+            hashes[new_nodes + edge_at++ - first_edge] = edge->id_hash;
+        }
+    }
+
+    // then add them to the indices
+    map* nodes_map = &c->id_to_nodes;
+    for (uint32_t i = first_node; i < node_end && error == NULL; i++) {
+        uint32_t ahead = i - first_node + INSTANCE_PREFETCH_DISTANCE;
+        if (ahead < new_nodes) PREFETCH(&nodes_map->slots[hashes[ahead] & (nodes_map->cap - 1)]);
+        jcanvas_node* node = &c->nodes[i];
+        if (!map_insert_reserved(nodes_map, node->id, hashes[i - first_node], i)) {
+            error = "Node with that id already exists";
+            break;
+        }
+        bitmap_put(&c->bitmaps, TYPE_SET(node->type), i, true);
+        bitmap_put(&c->bitmaps, COLOR_SET(node_color_class(node)), i, true);
+        const jcanvas_node_extra* extra = node_extra(t, (i - first_node) % t->node_count);
+        if (extra) {
+            c->extras[c->extra_count] = *extra;
+            c->extras[c->extra_count].node = i;
+            c->extra_of[i] = c->extra_count++;
+        }
+        c->node_count++;
+    }
+    map* edges_map = &c->id_to_edges;
+    for (uint32_t i = first_edge; i < edge_end && error == NULL; i++) {
+        uint32_t ahead = i - first_edge + INSTANCE_PREFETCH_DISTANCE;
+        if (ahead < new_edges) PREFETCH(&edges_map->slots[hashes[new_nodes + ahead] & (edges_map->cap - 1)]);
+        jcanvas_edge* edge = &c->edges[i];
+        uint64_t key = pair_key(edge->from_index, edge->to_index);
+        if (!c->allow_multi_edges && pair_set_contains(&c->edge_pairs, key)) {
+            error = "Failed to connect edges: Nodes are already connected!";
+            break;
+        }
+        if (!map_insert_reserved(edges_map, edge->id, edge->id_hash, i)) {
+            error = "Edge with that id already exists";
+            break;
+        }
+        pair_set_insert(a, &c->edge_pairs, key);
+        c->edge_count++;
+    }
+    free_array(a, hashes, hashes_cap, sizeof(uint64_t));
+    if (error) {
+        instance_edge_ids_free(c, c->edge_count, edge_at);
+        instances_remove(c, first_node, first_edge, first_extra);
+        c->last_error = error;
+        return false;
+    }
+    c->adjacency.valid = false;
+    view_nodes_changed(c, first_node, c->node_count);
+    view_edges_changed(c, first_edge, c->edge_count);
+    if (c->journal) {
+        journal_multi_edges(c);
+        for (uint32_t i = first_node; i < c->node_count; i++) journal_node_state(c->journal, c, i);
+        for (uint32_t i = first_edge; i < c->edge_count; i++) journal_edge(c->journal, &c->edges[i]);
+    }
+    return true;
+}
+//#endregion
+
+//#region import
+#define IMPORT_READ_CHUNK (1024 * 1024)
+#define IMPORT_BATCH 256
+
+// reads the rest of file into result, into memory owned by the canvas if owned (strings of the nodes point into
+// it, result->cap is 0 then) and from the allocator otherwise (free it with import_free). an owned file is read
+// straight into a string block of its own, so it's only in memory once. an empty file gives an empty result.
+// returns false with c->last_error set on failure
+static bool import_read(jcanvas* c, FILE* file, bool owned, str* result)
+{
+    const jcanvas_allocator* a = &c->allocator;
+    size_t header = owned ? sizeof(jcanvas_string_block) : 0;
+    uint32_t cap = 0, len = 0;
+    *result = (str){0};
+    int64_t start = file_tell(file);
+    if (start >= 0 && file_seek(file, 0, SEEK_END)) {
+        int64_t end = file_tell(file);
+        file_seek(file, start, SEEK_SET);
+        if (end >= start && (uint64_t)(end - start) < UINT32_MAX) cap = (uint32_t)(end - start) + 1;
+    }
+    if (cap == 0) cap = IMPORT_READ_CHUNK;
+    char* memory = a->allocate(a->ctx, header + cap);
+    bool ok = memory != NULL;
+    while (ok) {
+        if (len == cap) {
+            uint32_t grown = cap < UINT32_MAX - IMPORT_READ_CHUNK ? grown_capacity(cap, cap + IMPORT_READ_CHUNK, 50, 0) : 0;
+            char* moved = grown > cap ? a->reallocate(a->ctx, memory, header + cap, header + grown) : NULL;
+            ok = moved != NULL;
+            if (!ok) break;
+            memory = moved; cap = grown;
+        }
+        size_t n = fread(memory + header + len, 1, cap - len, file);
+        len += (uint32_t)n;
+        if (n == 0) break;
+    }
+    if (ok && ferror(file)) {
+        c->last_error = "Failed to read the input file!";
+        ok = false;
+    } else if (!ok) c->last_error = "Input file is too large!";
+    if (!ok || len == 0) {
+        if (memory) a->free(a->ctx, memory, header + cap);
+        return ok;
+    }
+    if (!owned) {
+        *result = (str){ memory, len, cap };
+        return true;
+    }
+    // the block is full, it goes behind the current one so that one's room is still used
+    jcanvas_string_block* block = (jcanvas_string_block*)memory;
+    block->size = cap; block->used = cap;
+    jcanvas_string_block** at = c->owned_strings ? &c->owned_strings->next : &c->owned_strings;
+    block->next = *at; *at = block;
+    *result = (str){ block->data, len, 0 };
+    return true;
+}
+
+// releases what import_read read when it isn't owned by the canvas (cap is 0 otherwise, so it's left alone)
+static void import_free(jcanvas* c, str* data)
+{
+    str_free(&c->allocator, data);
+}
+
+// reads the csv field at *at, unquoting it in place. row_end is set if it was the last one of its row
+static str csv_field(char** at, char* end, bool* row_end)
+{
+    char* p = *at;
+    str result;
+    if (p < end && *p == '"') {
+        char* out = ++p;
+        result.data = p;
+        while (p < end) {
+            if (*p == '"') {
+                if (p + 1 < end && p[1] == '"') { *out++ = '"'; p += 2; continue; }
+                p++;
+                break;
+            }
+            *out++ = *p++;
+        }
+        result.len = (uint32_t)(out - result.data);
+        while (p < end && *p != ',' && *p != '\n') p++;
+    } else {
+        result.data = p;
+        while (p < end && *p != ',' && *p != '\n') p++;
+        result.len = (uint32_t)(p - result.data);
+        if (result.len > 0 && result.data[result.len - 1] == '\r') result.len--;
+    }
+    *row_end = p >= end || *p == '\n';
+    *at = p < end ? p + 1 : p;
+    return result;
+}
+
+// integer part of a number, a fraction is dropped. false if there are no digits or it's out of range
+static bool import_int(str s, int64_t* value)
+{
+    uint32_t i = 0;
+    while (i < s.len && s.data[i] == ' ') i++;
+    bool negative = i < s.len && s.data[i] == '-';
+    if (i < s.len && (s.data[i] == '-' || s.data[i] == '+')) i++;
+    uint32_t digits = 0;
+    int64_t v = 0;
+    for (; i < s.len && s.data[i] >= '0' && s.data[i] <= '9'; i++, digits++) {
+        int digit = s.data[i] - '0';
+        if (v > (INT64_MAX - digit) / 10) return false;
+        v = v * 10 + digit;
+    }
+    *value = negative ? -v : v;
+    return digits > 0;
+}
+
+// canvas strings are JSON escaped, so a field that needs escaping is copied escaped into the canvas' memory
+static str import_json_str(jcanvas* c, str s)
+{
+    static const char hex[] = "0123456789abcdef";
+    uint32_t len = 0;
+    for (uint32_t i = 0; i < s.len; i++) {
+        unsigned char ch = (unsigned char)s.data[i];
+        if (ch == '"' || ch == '\\' || ch == '\n' || ch == '\r' || ch == '\t') len += 2;
+        else if (ch < 0x20) len += 6;
+        else len++;
+    }
+    if (len == s.len) return s;
+    char* data = owned_string_alloc(c, len);
+    if (data == NULL) return (str){0};
+    char* out = data;
+    for (uint32_t i = 0; i < s.len; i++) {
+        unsigned char ch = (unsigned char)s.data[i];
+        switch (ch) {
+            case '"': *out++ = '\\'; *out++ = '"'; break;
+            case '\\': *out++ = '\\'; *out++ = '\\'; break;
+            case '\n': *out++ = '\\'; *out++ = 'n'; break;
+            case '\r': *out++ = '\\'; *out++ = 'r'; break;
+            case '\t': *out++ = '\\'; *out++ = 't'; break;
+            default:
+                if (ch >= 0x20) { *out++ = (char)ch; break; }
+                copy_mem("\\u00", out, 4);
+                out[4] = hex[ch >> 4]; out[5] = hex[ch & 15];
+                out += 6;
+        }
+    }
+    return make_str_l(data, len);
+}
+
+enum { CSV_ID, CSV_TEXT, CSV_X, CSV_Y, CSV_WIDTH, CSV_HEIGHT, CSV_COLOR, CSV_COLUMNS };
+
+// adds a text node for every row of a csv table. the first row names the columns: id is required, text, x, y,
+// width, height and color are used if they are there, others are ignored. rows with an empty or taken id, a
+// number that isn't one or is out of range (or coordinates or a color compact nodes can't hold) are skipped. the file is read into memory owned by the canvas and the
+// strings of the nodes point into it. the nodes are made first and then added to the id index in one pass,
+// like jcanvas_instantiate does
+bool jcanvas_import_nodes_csv(jcanvas* c, FILE* file, jcanvas_import_stats* stats)
+{
+    const jcanvas_allocator* a = &c->allocator;
+    jcanvas_import_stats counts = {0};
+    str data;
+    if (!import_read(c, file, true, &data)) return false;
+    if (data.len == 0) {
+        c->last_error = "CSV table has no id column!";
+        return false;
+    }
+    char* at = data.data;
+    char* end = data.data + data.len;
+
+    int32_t columns[CSV_COLUMNS] = { -1, -1, -1, -1, -1, -1, -1 };
+    static const char* names[CSV_COLUMNS] = { "id", "text", "x", "y", "width", "height", "color" };
+    bool row_end = at >= end;
+    for (int32_t column = 0; !row_end; column++) {
+        str name = csv_field(&at, end, &row_end);
+        for (uint32_t k = 0; k < CSV_COLUMNS; k++) {
+            if (columns[k] < 0 && str_eq(name, make_str((char*)names[k]))) columns[k] = column;
+        }
+    }
+    if (columns[CSV_ID] < 0) {
+        c->last_error = "CSV table has no id column!";
+        return false;
+    }
+
+    uint64_t rows_cap = 1;
+    for (char* p = at; p < end; p++) rows_cap += *p == '\n';
+    if (c->node_count + rows_cap >= MAP_EMPTY) {
+        c->last_error = "Too many nodes!";
+        return false;
+    }
+    uint32_t first = c->node_count, rows_max = (uint32_t)rows_cap;
+    uint64_t* hashes = a->allocate(a->ctx, (size_t)rows_max * sizeof(uint64_t));
+    str* colors = columns[CSV_COLOR] >= 0 ? a->allocate(a->ctx, (size_t)rows_max * sizeof(str)) : NULL;
+    bool ok = hashes != NULL && (columns[CSV_COLOR] < 0 || colors != NULL);
+    if (ok) ok = nodes_reserve(c, first + rows_max, false);
+    if (ok) ok = map_reserve(a, &c->id_to_nodes, first + rows_max);
+    if (!ok) c->last_error = "Not enough memory!";
+
+    // parse the rows into the node array
+    uint32_t made = 0;
+    while (ok && at < end) {
+        str fields[CSV_COLUMNS] = {0};
+        row_end = false;
+        for (int32_t column = 0; !row_end; column++) {
+            str field = csv_field(&at, end, &row_end);
+            for (uint32_t k = 0; k < CSV_COLUMNS; k++) if (columns[k] == column) fields[k] = field;
+        }
+        if (fields[CSV_ID].len == 0 && fields[CSV_TEXT].len == 0 && at >= end) break; // trailing newline
+        counts.rows++;
+        int64_t v[4] = { 0, 0, 200, 200 };
+        bool numbers = true;
+        for (uint32_t k = 0; k < 4; k++) if (fields[CSV_X + k].len > 0) numbers &= import_int(fields[CSV_X + k], &v[k]);
+        if (fields[CSV_ID].len == 0 || !numbers || !coords_fit(v[0], v[1], v[2], v[3])) {
+            counts.skipped++;
+            continue;
+        }
+        str id = import_json_str(c, fields[CSV_ID]);
+        str text = import_json_str(c, fields[CSV_TEXT]);
+        if (id.data == NULL || (fields[CSV_TEXT].len > 0 && text.data == NULL)) {
+            c->last_error = "Not enough memory!";
+            ok = false;
+            break;
+        }
+        jcanvas_node* node = &c->nodes[first + made];
+        *node = (jcanvas_node){0};
+        node->id = make_sstr(id); node->type = NODE_TYPE_TEXT; node->text_in_file = false;
+        node->as.text = text;
+        node->x = v[0]; node->y = v[1]; node->width = v[2]; node->height = v[3];
+#ifdef JCANVAS_COMPACT_NODES
+        node->color = COLOR_NONE;
+#endif
+        hashes[made] = jcanvas_hash(id, c->hash_seed);
+#ifndef JCANVAS_COMPACT_NODES
+        node->id_hash = hashes[made];
+#endif
+        if (colors) colors[made] = fields[CSV_COLOR];
+        made++;
+    }
+
+    // then index them, dropping taken ids. the edits are journaled once everything is in place
+    FILE* journal = c->journal;
+    c->journal = NULL;
+    map* nodes_map = &c->id_to_nodes;
+    for (uint32_t k = 0; k < made && ok; k++) {
+        if (k + INSTANCE_PREFETCH_DISTANCE < made) PREFETCH(&nodes_map->slots[hashes[k + INSTANCE_PREFETCH_DISTANCE] & (nodes_map->cap - 1)]);
+        uint32_t index = c->node_count;
+        if (first + k != index) c->nodes[index] = c->nodes[first + k];
+        jcanvas_node* node = &c->nodes[index];
+        if (!map_insert_reserved(nodes_map, node->id, hashes[k], index)) {
+            counts.skipped++;
+            continue;
+        }
+        bitmap_put(&c->bitmaps, TYPE_SET(NODE_TYPE_TEXT), index, true);
+        bitmap_put(&c->bitmaps, COLOR_SET(COLOR_NONE), index, true);
+        c->node_count++;
+        char* error = c->last_error;
+        if (colors && colors[k].len > 0 && !jcanvas_set_color(c, node, make_sstr(colors[k]))) {
+            // a color compact nodes can't store, the row is left out like one with a bad number
+            c->last_error = error;
+            c->node_count--;
+            map_remove(nodes_map, sstr_view(&node->id), hashes[k]);
+            bitmap_put(&c->bitmaps, TYPE_SET(NODE_TYPE_TEXT), index, false);
+            bitmap_put(&c->bitmaps, COLOR_SET(COLOR_NONE), index, false);
+            counts.skipped++;
+        }
+    }
+    c->journal = journal;
+    counts.added = c->node_count - first;
+    view_nodes_changed(c, first, c->node_count);
+    if (c->journal) {
+        for (uint32_t i = first; i < c->node_count; i++) journal_node_state(c->journal, c, i);
+    }
+    c->adjacency.valid = false;
+    free_array(a, hashes, rows_max, sizeof(uint64_t));
+    free_array(a, colors, rows_max, sizeof(str));
+    if (stats) *stats = counts;
+    return ok;
+}
+
+static bool edge_list_space(char ch)
+{
+    return ch == ' ' || ch == '\t' || ch == ',' || ch == '\r';
+}
+
+// connects the nodes named on every line of an edge list: two node ids separated by spaces, tabs or a
+// comma, anything after them (like a weight) is ignored. empty lines and lines starting with # or % are
+// comments. lines naming unknown nodes or nodes that are connected already are skipped. ids are looked up
+// as they are written. the lines are resolved in batches, hashing the ids of a batch first and then looking
+// them up with the slots a few lines ahead prefetched. resolving is a small part of the work, most of it is
+// making the edge ids and adding them to the indexes, so the lines aren't split across threads
+bool jcanvas_import_edges(jcanvas* c, FILE* file, jcanvas_import_stats* stats)
+{
+    const jcanvas_allocator* a = &c->allocator;
+    jcanvas_import_stats counts = {0};
+    str data;
+    if (!import_read(c, file, false, &data)) return false;
+    if (data.len == 0) {
+        if (stats) *stats = counts;
+        return true;
+    }
+    char* at = data.data;
+    char* end = data.data + data.len;
+
+    uint64_t lines = 1;
+    for (char* p = at; p < end; p++) lines += *p == '\n';
+    uint32_t first = c->edge_count;
+    bool ok = first + lines < MAP_EMPTY;
+    if (ok) ok = edges_reserve(c, first + (uint32_t)lines, false);
+    if (ok) ok = map_reserve(a, &c->id_to_edges, first + (uint32_t)lines);
+    if (ok) ok = pair_set_reserve(a, &c->edge_pairs, c->edge_pairs.count + (uint32_t)lines);
+    if (!ok) c->last_error = first + lines < MAP_EMPTY ? "Not enough memory!" : "Too many edges!";
+
+    FILE* journal = c->journal;
+    c->journal = NULL;
+    map* nodes_map = &c->id_to_nodes;
+    str ids[2 * IMPORT_BATCH];
+    uint64_t hashes[2 * IMPORT_BATCH];
+    while (ok && at < end) {
+        uint32_t batch = 0;
+        while (batch < IMPORT_BATCH && at < end) {
+            char* line_end = at;
+            while (line_end < end && *line_end != '\n') line_end++;
+            char* p = at;
+            at = line_end < end ? line_end + 1 : line_end;
+            while (p < line_end && edge_list_space(*p)) p++;
+            if (p == line_end || *p == '#' || *p == '%') continue;
+            counts.rows++;
+            str* pair = &ids[2 * batch];
+            for (uint32_t k = 0; k < 2; k++) {
+                while (p < line_end && edge_list_space(*p)) p++;
+                pair[k].data = p;
+                while (p < line_end && !edge_list_space(*p)) p++;
+                pair[k].len = (uint32_t)(p - pair[k].data);
+            }
+            if (pair[1].len == 0) {
+                counts.skipped++;
+                continue;
+            }
+            hashes[2 * batch] = jcanvas_hash(pair[0], c->hash_seed);
+            hashes[2 * batch + 1] = jcanvas_hash(pair[1], c->hash_seed);
+            batch++;
+        }
+
+        for (uint32_t k = 0; k < batch && ok; k++) {
+            if (k + INSTANCE_PREFETCH_DISTANCE < batch && nodes_map->cap > 0) {
+                PREFETCH(&nodes_map->slots[hashes[2 * (k + INSTANCE_PREFETCH_DISTANCE)] & (nodes_map->cap - 1)]);
+                PREFETCH(&nodes_map->slots[hashes[2 * (k + INSTANCE_PREFETCH_DISTANCE) + 1] & (nodes_map->cap - 1)]);
+            }
+            uint32_t from, to;
+            if (!map_get(nodes_map, ids[2 * k], hashes[2 * k], &from) || !map_get(nodes_map, ids[2 * k + 1], hashes[2 * k + 1], &to)
+                || (!c->allow_multi_edges && pair_set_contains(&c->edge_pairs, pair_key(from, to)))) {
+                counts.skipped++;
+                continue;
+            }
+            if (connect_with_id(c, from, to, (str){0}) == NULL) ok = false;
+        }
+    }
+    c->journal = journal;
+    import_free(c, &data);
+    counts.added = c->edge_count - first;
+    jcanvas_infer_edge_sides_range(c, first, c->edge_count);
+    if (c->journal) {
+        journal_multi_edges(c);
+        for (uint32_t i = first; i < c->edge_count; i++) journal_edge(c->journal, &c->edges[i]);
+    }
+    if (stats) *stats = counts;
+    return ok;
+}
+//#endregion
+
+static uint32_t count_trailing_zeros(uint64_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(x);
+#else
+    uint32_t n = 0;
+    while ((x & 1) == 0) { x >>= 1; n++; }
+    return n;
+#endif
+}
+
+// ORs the selected sets word by word and ANDs the type and color results, then checks the
+// region only for the nodes that survived
+uint32_t jcanvas_query_nodes(jcanvas* c, const jcanvas_query* query, uint32_t* result, uint32_t cap)
+{
+    jcanvas_bitmaps* b = &c->bitmaps;
+    uint32_t words = (c->node_count + 63) / 64;
+    uint32_t found = 0;
+    for (uint32_t w = 0; w < words; w++) {
+        uint64_t mask = UINT64_MAX;
+        if (w == words - 1 && c->node_count % 64) mask = ((uint64_t)1 << (c->node_count % 64)) - 1;
+
+        if (query->types) {
+            uint64_t types = 0;
+            for (uint32_t t = 0; t <= NODE_TYPE_GROUP; t++) {
+                if (query->types & (1u << t)) types |= bitmap_set(b, TYPE_SET(t))[w];
+            }
+            mask &= types;
+        }
+        if (query->colors && mask) {
+            uint64_t colors = 0;
+            for (uint32_t k = 0; k <= COLOR_CUSTOM; k++) {
+                if (query->colors & (1u << k)) colors |= bitmap_set(b, COLOR_SET(k))[w];
+            }
+            mask &= colors;
+        }
+
+        while (mask) {
+            uint32_t index = w * 64 + count_trailing_zeros(mask);
+            mask &= mask - 1;
+            if (query->in_region) {
+                jcanvas_node* node = &c->nodes[index];
+                if (node->x >= query->x + query->width || node->x + node->width <= query->x) continue;
+                if (node->y >= query->y + query->height || node->y + node->height <= query->y) continue;
+            }
+            if (found < cap) result[found] = index;
+            found++;
+        }
+    }
+    return found;
+}
+
+static void report_violation(jcanvas_validation_report* report, jcanvas_violation_kind kind, bool is_edge, uint32_t index)
+{
+    if (report->count < report->cap) {
+        report->violations[report->count] = (jcanvas_violation){ kind, is_edge, index };
+    }
+    report->count++;
+}
+
+static bool resolve_edge_node(jcanvas* c, uint32_t index, str id)
+{
+    if (index < c->node_count && str_eq(sstr_view(&c->nodes[index].id), id)) return true;
+    return map_get(&c->id_to_nodes, id, jcanvas_hash(id, c->hash_seed), NULL);
+}
+
+bool jcanvas_validate_range(jcanvas* c, jcanvas_validation_report* report, uint32_t node_begin, uint32_t node_end, uint32_t edge_begin, uint32_t edge_end)
+{
+    uint32_t count_before = report->count;
+    if (node_end > c->node_count) node_end = c->node_count;
+    if (edge_end > c->edge_count) edge_end = c->edge_count;
+
+    for (uint32_t i = node_begin; i < node_end; i++) {
+        jcanvas_node* node = &c->nodes[i];
+        uint32_t indexed;
+        str id = sstr_view(&node->id);
+        if (id.len == 0) report_violation(report, VIOLATION_EMPTY_ID, false, i);
+        // the index holds exactly one slot per id, any other node with that id is a duplicate
+        else if (!map_get(&c->id_to_nodes, id, node_id_hash(c, node), &indexed) || indexed != i) report_violation(report, VIOLATION_DUPLICATE_ID, false, i);
+
+        jcanvas_node_extra* extra = node_extra(c, i);
+        if ((uint32_t)node->type > NODE_TYPE_GROUP) report_violation(report, VIOLATION_INVALID_TYPE, false, i);
+        else if (node->type == NODE_TYPE_GROUP && extra && (uint32_t)extra->as.group_node.background_style > STYLE_REPEAT) {
+            report_violation(report, VIOLATION_INVALID_BACKGROUND_STYLE, false, i);
+        }
+
+        if (node->width <= 0 || node->height <= 0) report_violation(report, VIOLATION_INVALID_SIZE, false, i);
+        else if (node->x > JCANVAS_COORD_MAX - node->width || node->y > JCANVAS_COORD_MAX - node->height) {
+            report_violation(report, VIOLATION_COORDINATE_OVERFLOW, false, i);
+        }
+    }
+
+    for (uint32_t i = edge_begin; i < edge_end; i++) {
+        jcanvas_edge* edge = &c->edges[i];
+        uint32_t indexed;
+        str id = sstr_view(&edge->id);
+        if (id.len == 0) report_violation(report, VIOLATION_EMPTY_ID, true, i);
+        else if (!map_get(&c->id_to_edges, id, edge->id_hash, &indexed) || indexed != i) report_violation(report, VIOLATION_DUPLICATE_ID, true, i);
+
+        if (!resolve_edge_node(c, edge->from_index, sstr_view(&edge->from_node))) report_violation(report, VIOLATION_MISSING_FROM_NODE, true, i);
+        if (!resolve_edge_node(c, edge->to_index, sstr_view(&edge->to_node))) report_violation(report, VIOLATION_MISSING_TO_NODE, true, i);
+
+        if ((uint32_t)edge->from_side > SIDE_LEFT || (uint32_t)edge->to_side > SIDE_LEFT) report_violation(report, VIOLATION_INVALID_SIDE, true, i);
+        if ((uint32_t)edge->from_end > END_ARROW || (uint32_t)edge->to_end > END_ARROW) report_violation(report, VIOLATION_INVALID_END, true, i);
+    }
+    return report->count == count_before;
+}
+
+// returns true if the canvas has no violations
+bool jcanvas_validate(jcanvas* c, jcanvas_validation_report* report)
+{
+    report->count = 0;
+    return jcanvas_validate_range(c, report, 0, c->node_count, 0, c->edge_count);
+}
+
+//#region group_tree
+// a group is put into the grid level whose cells are at least as large as the group, so it covers at most 3x3
+// cells there. any node it contains has its top left corner in one of them
+static uint32_t group_level(int64_t size)
+{
+    uint32_t level = 0;
+    while (level < 62 && ((int64_t)1 << level) < size) level++;
+    return level;
+}
+
+static uint64_t group_cell_key(uint32_t level, int64_t x, int64_t y)
+{
+    return mix64(cell_hash(x, y) ^ level);
+}
+
+// whether group g can be the parent of node i: it contains the node, and if both have the same bounds
+// the group comes first, so the tree has no cycles
+static bool group_contains(const jcanvas* c, uint32_t g, uint32_t i)
+{
+    const jcanvas_node* group = &c->nodes[g];
+    const jcanvas_node* node = &c->nodes[i];
+    if (g == i || node->x < group->x || node->y < group->y) return false;
+    if (node->x + node->width > group->x + group->width || node->y + node->height > group->y + group->height) return false;
+    bool same = node->x == group->x && node->y == group->y && node->width == group->width && node->height == group->height;
+    return !same || g < i;
+}
+
+// the innermost of two groups containing the same node: the smaller one, or the later one for the same area
+static bool group_inner(const jcanvas* c, uint32_t a, uint32_t b)
+{
+    if (b == JCANVAS_NO_GROUP) return true;
+    double area_a = (double)c->nodes[a].width * c->nodes[a].height, area_b = (double)c->nodes[b].width * c->nodes[b].height;
+    return area_a < area_b || (area_a == area_b && a > b);
+}
+
+// finds the innermost group around every node with a grid per power of two size: the groups are put into the
+// cells they cover, the cells are sorted by key, and every node looks up the cell of its top left corner on each
+// level with groups at least its size. that is O(n log n) instead of testing every node against every group
+bool jcanvas_build_group_tree(jcanvas* c, jcanvas_group_tree* tree)
+{
+    const jcanvas_allocator* a = &c->allocator;
+    uint32_t n = c->node_count, groups = 0;
+    for (uint32_t i = 0; i < n; i++) groups += c->nodes[i].type == NODE_TYPE_GROUP;
+    *tree = (jcanvas_group_tree){ .allocator = *a, .node_count = n };
+    tree->parent = a->allocate(a->ctx, ((size_t)n + 1) * sizeof(uint32_t)); // one more, so an empty canvas doesn't allocate 0 bytes
+    tree->child_start = a->allocate(a->ctx, ((size_t)n + 3) * sizeof(uint32_t));
+    tree->children = a->allocate(a->ctx, ((size_t)n + 1) * sizeof(uint32_t));
+    uint32_t cells_cap = groups * 9;
+    uint64_t* keys = groups ? a->allocate(a->ctx, (size_t)cells_cap * sizeof(uint64_t)) : NULL;
+    uint32_t* values = groups ? a->allocate(a->ctx, (size_t)cells_cap * sizeof(uint32_t)) : NULL;
+    bool ok = tree->parent && tree->child_start && tree->children && (groups == 0 || (keys && values));
+
+    uint32_t cells = 0;
+    uint64_t levels = 0;
+    for (uint32_t g = 0; g < n && ok; g++) {
+        const jcanvas_node* group = &c->nodes[g];
+        if (group->type != NODE_TYPE_GROUP) continue;
+        uint32_t level = group_level(group->width > group->height ? group->width : group->height);
+        int64_t size = (int64_t)1 << level;
+        int64_t x0 = floor_div(group->x, size), x1 = floor_div(group->x + group->width, size);
+        int64_t y0 = floor_div(group->y, size), y1 = floor_div(group->y + group->height, size);
+        for (int64_t y = y0; y <= y1; y++) {
+            for (int64_t x = x0; x <= x1; x++) {
+                keys[cells] = group_cell_key(level, x, y);
+                values[cells++] = g;
+            }
+        }
+        levels |= (uint64_t)1 << level;
+    }
+    if (ok) ok = radix_sort(a, keys, values, cells, 64);
+
+    for (uint32_t i = 0; i < n && ok; i++) {
+        const jcanvas_node* node = &c->nodes[i];
+        uint32_t best = JCANVAS_NO_GROUP;
+        int64_t node_size = node->width > node->height ? node->width : node->height;
+        for (uint64_t rest = levels; rest; rest &= rest - 1) {
+            uint32_t level = count_trailing_zeros(rest);
+            int64_t size = (int64_t)1 << level;
+            if (size < node_size) continue;
+            uint64_t key = group_cell_key(level, floor_div(node->x, size), floor_div(node->y, size));
+            uint32_t lo = 0, hi = cells;
+            while (lo < hi) {
+                uint32_t mid = lo + (hi - lo) / 2;
+                if (keys[mid] < key) lo = mid + 1; else hi = mid;
+            }
+            // other cells may share the key, group_contains sorts them out
+            for (; lo < cells && keys[lo] == key; lo++) {
+                uint32_t g = values[lo];
+                if (group_contains(c, g, i) && group_inner(c, g, best)) best = g;
+            }
+        }
+        tree->parent[i] = best;
+    }
+
+    // the children of every group next to each other, the top level nodes after them all
+    if (ok) {
+        // counted two slots ahead, so filling moves every start one slot ahead to where it belongs
+        uint32_t* start = tree->child_start;
+        for (uint32_t i = 0; i < n + 3; i++) start[i] = 0;
+        for (uint32_t i = 0; i < n; i++) start[(tree->parent[i] == JCANVAS_NO_GROUP ? n : tree->parent[i]) + 2]++;
+        for (uint32_t i = 2; i < n + 3; i++) start[i] += start[i - 1];
+        for (uint32_t i = 0; i < n; i++) tree->children[start[(tree->parent[i] == JCANVAS_NO_GROUP ? n : tree->parent[i]) + 1]++] = i;
+    }
+    free_array(a, keys, cells_cap, sizeof(uint64_t));
+    free_array(a, values, cells_cap, sizeof(uint32_t));
+    if (!ok) {
+        jcanvas_group_tree_destroy(tree);
+        c->last_error = "Not enough memory!";
+    }
+    return ok;
+}
+
+// the nodes directly inside group, or the top level nodes for JCANVAS_NO_GROUP
+uint32_t jcanvas_group_children(const jcanvas_group_tree* tree, uint32_t group, const uint32_t** children)
+{
+    uint32_t slot = group == JCANVAS_NO_GROUP ? tree->node_count : group;
+    if (slot > tree->node_count) return 0;
+    if (children) *children = &tree->children[tree->child_start[slot]];
+    return tree->child_start[slot + 1] - tree->child_start[slot];
+}
+
+// moves a group and everything inside it, also nested groups, by dx, dy. if a node wouldn't fit compact
+// nodes anymore nothing is moved
+bool jcanvas_move_group(jcanvas* c, const jcanvas_group_tree* tree, uint32_t group, int64_t dx, int64_t dy)
+{
+    if (tree->node_count != c->node_count || group >= c->node_count) {
+        c->last_error = "Group tree doesn't match the canvas!";
+        return false;
+    }
+    const jcanvas_allocator* a = &c->allocator;
+    uint32_t* moved = a->allocate(a->ctx, (size_t)c->node_count * sizeof(uint32_t));
+    if (moved == NULL) {
+        c->last_error = "Not enough memory!";
+        return false;
+    }
+    // the subtree breadth first, the list itself is the queue
+    uint32_t count = 0;
+    moved[count++] = group;
+    for (uint32_t k = 0; k < count; k++) {
+        const uint32_t* children;
+        uint32_t child_count = jcanvas_group_children(tree, moved[k], &children);
+        for (uint32_t i = 0; i < child_count; i++) moved[count++] = children[i];
+    }
+    bool ok = true;
+    for (uint32_t k = 0; k < count && ok; k++) {
+        const jcanvas_node* node = &c->nodes[moved[k]];
+        ok = coords_fit(node->x + dx, node->y + dy, node->width, node->height);
+    }
+    if (!ok) c->last_error = "Moved nodes don't fit compact nodes";
+    for (uint32_t k = 0; k < count && ok; k++) {
+        jcanvas_node* node = &c->nodes[moved[k]];
+        jcanvas_pos_node(c, node, node->x + dx, node->y + dy, node->width, node->height);
+    }
+    free_array(a, moved, c->node_count, sizeof(uint32_t));
+    return ok;
+}
+
+void jcanvas_group_tree_destroy(jcanvas_group_tree* tree)
+{
+    const jcanvas_allocator* a = &tree->allocator;
+    free_array(a, tree->parent, tree->node_count + 1, sizeof(uint32_t));
+    free_array(a, tree->child_start, tree->node_count + 3, sizeof(uint32_t));
+    free_array(a, tree->children, tree->node_count + 1, sizeof(uint32_t));
+    tree->parent = tree->child_start = tree->children = NULL;
+}
+//#endregion
+
+//#region stream_reader
+#define STREAM_CHUNK_SIZE (64 * 1024)
+
+typedef struct {
+    FILE* file;
+    char* buf;
+    uint32_t pos, len;
+    str scratch; // raw string values of the object currently being read
+    const jcanvas_allocator* a;
+    const char* error;
+} stream_reader;
+
+// a string value, as offset into scratch since scratch may move while the object is read
+typedef struct {
+    uint32_t offset, len;
+    bool present;
+} stream_field;
+
+static int sr_peek(stream_reader* r)
+{
+    if (r->pos == r->len) {
+        r->len = (uint32_t)fread(r->buf, 1, STREAM_CHUNK_SIZE, r->file);
+        r->pos = 0;
+        if (r->len == 0) return -1;
+    }
+    return (unsigned char)r->buf[r->pos];
+}
+
+static int sr_next(stream_reader* r)
+{
+    int ch = sr_peek(r);
+    if (ch >= 0) r->pos++;
+    return ch;
+}
+
+static int sr_skip_ws(stream_reader* r)
+{
+    int ch = sr_peek(r);
+    while (ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t') {
+        r->pos++;
+        ch = sr_peek(r);
+    }
+    return ch;
+}
+
+static bool sr_expect(stream_reader* r, char expected)
+{
+    if (sr_skip_ws(r) != expected) {
+        r->error = "Unexpected character in canvas file";
+        return false;
+    }
+    r->pos++;
+    return true;
+}
+
+// reads a string after its opening quote. the raw (still escaped) bytes are appended to into,
+// or dropped if into is NULL
+static bool sr_string(stream_reader* r, str* into)
+{
+    bool escaped = false;
+    while (true) {
+        // copy whole runs out of the chunk instead of going byte by byte
+        if (sr_peek(r) < 0) {
+            r->error = "Unterminated string in canvas file";
+            return false;
+        }
+        uint32_t start = r->pos;
+        while (r->pos < r->len) {
+            char ch = r->buf[r->pos];
+            if (ch == '"' && !escaped) break;
+            escaped = ch == '\\' && !escaped;
+            r->pos++;
+        }
+        if (into && !str_append_s(r->a, into, make_str_l(&r->buf[start], r->pos - start))) {
+            r->error = "Not enough memory!";
+            return false;
+        }
+        if (r->pos < r->len) {
+            r->pos++; // closing quote
+            return true;
+        }
+    }
+}
+
+// reads a key into a small fixed buffer, longer keys are truncated and won't match any known key
+static bool sr_key(stream_reader* r, char* key, uint32_t cap)
+{
+    if (!sr_expect(r, '"')) return false;
+    uint32_t len = 0;
+    bool escaped = false;
+    while (true) {
+        int ch = sr_next(r);
+        if (ch < 0) {
+            r->error = "Unterminated string in canvas file";
+            return false;
+        }
+        if (ch == '"' && !escaped) break;
+        escaped = ch == '\\' && !escaped;
+        if (len < cap - 1) key[len++] = (char)ch;
+    }
+    key[len] = 0;
+    return sr_expect(r, ':');
+}
+
+static bool sr_skip_value(stream_reader* r)
+{
+    uint32_t depth = 0;
+    int ch = sr_skip_ws(r);
+    do {
+        ch = sr_next(r);
+        if (ch < 0) {
+            r->error = "Unexpected end of canvas file";
+            return false;
+        }
+        if (ch == '"') {
+            if (!sr_string(r, NULL)) return false;
+        } else if (ch == '{' || ch == '[') {
+            depth++;
+        } else if (ch == '}' || ch == ']') {
+            depth--;
+        } else if (depth == 0) {
+            // scalar: consume until the next delimiter
+            while ((ch = sr_peek(r)) >= 0 && ch != ',' && ch != '}' && ch != ']' && ch != ' ' && ch != '\n' && ch != '\r' && ch != '\t') {
+                r->pos++;
+            }
+        }
+    } while (depth > 0);
+    return true;
+}
+
+static bool sr_field(stream_reader* r, stream_field* field)
+{
+    if (!sr_expect(r, '"')) return false;
+    field->offset = r->scratch.len;
+    if (!sr_string(r, &r->scratch)) return false;
+    field->len = r->scratch.len - field->offset;
+    field->present = true;
+    return true;
+}
+
+// numbers are accepted bare and quoted, since jcanvas_generate writes them as strings.
+// fractions are truncated
+static bool sr_number(stream_reader* r, int64_t* result)
+{
+    bool quoted = sr_skip_ws(r) == '"';
+    if (quoted) r->pos++;
+    bool negative = sr_peek(r) == '-';
+    if (negative) r->pos++;
+    int64_t value = 0;
+    int ch;
+    while ((ch = sr_peek(r)) >= '0' && ch <= '9') {
+        value = value * 10 + (ch - '0');
+        r->pos++;
+    }
+    while ((ch = sr_peek(r)) == '.' || ch == 'e' || ch == 'E' || ch == '+' || ch == '-' || (ch >= '0' && ch <= '9')) {
+        r->pos++;
+    }
+    if (quoted && sr_next(r) != '"') {
+        r->error = "Invalid number in canvas file";
+        return false;
+    }
+    *result = negative ? -value : value;
+    return true;
+}
+
+static str sr_view(stream_reader* r, stream_field field)
+{
+    if (!field.present) return (str){0};
+    return make_str_l(r->scratch.data + field.offset, field.len);
+}
+
+// maps a string to its index in one of the _*_strings tables, or -1
+static int sr_enum(stream_reader* r, stream_field field, const str* strings, int count)
+{
+    str value = sr_view(r, field);
+    for (int i = 0; i < count; i++) {
+        if (str_eq(value, strings[i])) return i;
+    }
+    return -1;
+}
+
+static bool sr_key_is(char* key, char* expected)
+{
+    return str_eq(make_str(key), make_str(expected));
+}
+
+static bool sr_node(stream_reader* r, jcanvas_node_fn on_node, void* user, bool* stop)
+{
+    stream_field id = {0}, type = {0}, text = {0}, file = {0}, subpath = {0}, link = {0};
+    stream_field label = {0}, background = {0}, background_style = {0}, color = {0};
+    jcanvas_node node = {0};
+    jcanvas_node_extra extra = {0};
+    int64_t x = 0, y = 0, width = 0, height = 0;
+    r->scratch.len = 0;
+
+    if (!sr_expect(r, '{')) return false;
+    if (sr_skip_ws(r) == '}') r->pos++;
+    else while (true) {
+        char key[32];
+        if (!sr_key(r, key, sizeof(key))) return false;
+        bool ok;
+        if (sr_key_is(key, "id")) ok = sr_field(r, &id);
+        else if (sr_key_is(key, "type")) ok = sr_field(r, &type);
+        else if (sr_key_is(key, "text")) ok = sr_field(r, &text);
+        else if (sr_key_is(key, "file")) ok = sr_field(r, &file);
+        else if (sr_key_is(key, "subpath")) ok = sr_field(r, &subpath);
+        else if (sr_key_is(key, "url")) ok = sr_field(r, &link);
+        else if (sr_key_is(key, "link")) ok = sr_field(r, &link);
+        else if (sr_key_is(key, "label")) ok = sr_field(r, &label);
+        else if (sr_key_is(key, "background")) ok = sr_field(r, &background);
+        else if (sr_key_is(key, "backgroundStyle")) ok = sr_field(r, &background_style);
+        else if (sr_key_is(key, "color")) ok = sr_field(r, &color);
+        else if (sr_key_is(key, "x")) ok = sr_number(r, &x);
+        else if (sr_key_is(key, "y")) ok = sr_number(r, &y);
+        else if (sr_key_is(key, "width")) ok = sr_number(r, &width);
+        else if (sr_key_is(key, "height")) ok = sr_number(r, &height);
+        else ok = sr_skip_value(r);
+        if (!ok) return false;
+
+        sr_skip_ws(r);
+        int ch = sr_next(r);
+        if (ch == '}') break;
+        if (ch != ',') {
+            r->error = "Expected ',' or '}' in canvas file";
+            return false;
+        }
+    }
+
+    int node_type = sr_enum(r, type, _type_strings, 4);
+    if (node_type < 0) {
+        r->error = "Node with unknown type in canvas file";
+        return false;
+    }
+    node.type = node_type;
+    node.id = make_sstr(sr_view(r, id));
+    if (!coords_fit(x, y, width, height)) {
+        r->error = "Node coordinates in canvas file don't fit compact nodes";
+        return false;
+    }
+    node.x = x; node.y = y; node.width = width; node.height = height;
+#ifdef JCANVAS_COMPACT_NODES
+    if (!pack_color(make_sstr(sr_view(r, color)), &node.color)) {
+        r->error = "Node color in canvas file doesn't fit compact nodes";
+        return false;
+    }
+#else
+    node.color = make_sstr(sr_view(r, color));
+#endif
+    bool has_extra = false;
+    switch (node.type) {
+        case NODE_TYPE_TEXT: node.as.text = sr_view(r, text); break;
+        case NODE_TYPE_FILE: {
+            node.as.file.path = sr_view(r, file);
+            extra.as.file.subpath = sr_view(r, subpath);
+            has_extra = subpath.len > 0;
+        } break;
+        case NODE_TYPE_LINK: node.as.link = sr_view(r, link); break;
+        case NODE_TYPE_GROUP: {
+            node.as.group_node.label = sr_view(r, label);
+            extra.as.group_node.background = sr_view(r, background);
+            int style = sr_enum(r, background_style, _background_style_strings, 3);
+            extra.as.group_node.background_style = style < 0 ? STYLE_OVER : style;
+            has_extra = background.len > 0 || style > 0;
+        } break;
+    }
+    if (on_node && !on_node(user, &node, has_extra ? &extra : NULL)) *stop = true;
+    return true;
+}
+
+static bool sr_edge(stream_reader* r, jcanvas_edge_fn on_edge, void* user, bool* stop)
+{
+    stream_field id = {0}, from_node = {0}, from_side = {0}, from_end = {0};
+    stream_field to_node = {0}, to_side = {0}, to_end = {0}, color = {0}, label = {0};
+    r->scratch.len = 0;
+
+    if (!sr_expect(r, '{')) return false;
+    if (sr_skip_ws(r) == '}') r->pos++;
+    else while (true) {
+        char key[32];
+        if (!sr_key(r, key, sizeof(key))) return false;
+        bool ok;
+        if (sr_key_is(key, "id")) ok = sr_field(r, &id);
+        else if (sr_key_is(key, "fromNode")) ok = sr_field(r, &from_node);
+        else if (sr_key_is(key, "fromSide")) ok = sr_field(r, &from_side);
+        else if (sr_key_is(key, "fromEnd")) ok = sr_field(r, &from_end);
+        else if (sr_key_is(key, "toNode")) ok = sr_field(r, &to_node);
+        else if (sr_key_is(key, "toSide")) ok = sr_field(r, &to_side);
+        else if (sr_key_is(key, "toEnd")) ok = sr_field(r, &to_end);
+        else if (sr_key_is(key, "color")) ok = sr_field(r, &color);
+        else if (sr_key_is(key, "label")) ok = sr_field(r, &label);
+        else ok = sr_skip_value(r);
+        if (!ok) return false;
+
+        sr_skip_ws(r);
+        int ch = sr_next(r);
+        if (ch == '}') break;
+        if (ch != ',') {
+            r->error = "Expected ',' or '}' in canvas file";
+            return false;
+        }
+    }
+
+    jcanvas_edge edge = {0};
+    edge.id = make_sstr(sr_view(r, id));
+    edge.from_node = make_sstr(sr_view(r, from_node));
+    edge.to_node = make_sstr(sr_view(r, to_node));
+    edge.color = make_sstr(sr_view(r, color));
+    edge.label = sr_view(r, label);
+    int side = sr_enum(r, from_side, _side_strings, 4);
+    edge.from_side = side < 0 ? SIDE_RIGHT : side;
+    side = sr_enum(r, to_side, _side_strings, 4);
+    edge.to_side = side < 0 ? SIDE_LEFT : side;
+    int end = sr_enum(r, from_end, _end_strings, 2);
+    edge.from_end = end < 0 ? END_NONE : end;
+    end = sr_enum(r, to_end, _end_strings, 2);
+    edge.to_end = end < 0 ? END_ARROW : end;
+    // there is no node array to point into while streaming
+    edge.from_index = edge.to_index = UINT32_MAX;
+    if (on_edge && !on_edge(user, &edge)) *stop = true;
+    return true;
+}
+
+static bool sr_array(stream_reader* r, bool nodes, jcanvas_node_fn on_node, jcanvas_edge_fn on_edge, void* user, bool* stop)
+{
+    if (!sr_expect(r, '[')) return false;
+    if (sr_skip_ws(r) == ']') { r->pos++; return true; }
+    while (!*stop) {
+        bool ok = nodes ? sr_node(r, on_node, user, stop) : sr_edge(r, on_edge, user, stop);
+        if (!ok) return false;
+        sr_skip_ws(r);
+        int ch = sr_next(r);
+        if (ch == ']') break;
+        if (ch != ',') {
+            r->error = "Expected ',' or ']' in canvas file";
+            return false;
+        }
+    }
+    return true;
+}
+
+// reads a canvas file in fixed size chunks and hands every node and edge to the callbacks.
+// only the chunk and the strings of the current node/edge are kept in memory. allocator may be NULL for the default one
+bool jcanvas_stream_read(FILE* file, jcanvas_node_fn on_node, jcanvas_edge_fn on_edge, void* user, const jcanvas_allocator* allocator, const char** error)
+{
+    stream_reader r = {0};
+    r.file = file; r.a = allocator ? allocator : &default_allocator;
+    r.buf = r.a->allocate(r.a->ctx, STREAM_CHUNK_SIZE);
+    r.scratch = str_init(r.a, 256);
+    bool ok = r.buf != NULL && r.scratch.data != NULL;
+    if (!ok) r.error = "Not enough memory!";
+
+    bool stop = false;
+    if (ok) ok = sr_expect(&r, '{');
+    if (ok && sr_skip_ws(&r) == '}') r.pos++;
+    else while (ok && !stop) {
+        char key[32];
+        ok = sr_key(&r, key, sizeof(key));
+        if (!ok) break;
+        if (sr_key_is(key, "nodes")) ok = sr_array(&r, true, on_node, on_edge, user, &stop);
+        else if (sr_key_is(key, "edges")) ok = sr_array(&r, false, on_node, on_edge, user, &stop);
+        else ok = sr_skip_value(&r);
+        if (!ok || stop) break;
+
+        sr_skip_ws(&r);
+        int ch = sr_next(&r);
+        if (ch == '}') break;
+        if (ch != ',') {
+            r.error = "Expected ',' or '}' in canvas file";
+            ok = false;
+        }
+    }
+
+    if (r.buf) r.a->free(r.a->ctx, r.buf, STREAM_CHUNK_SIZE);
+    str_free(r.a, &r.scratch);
+    if (error) *error = ok ? NULL : r.error;
+    return ok;
+}
+//#endregion
+
+void jcanvas_destroy(jcanvas* c)
+{
+    const jcanvas_allocator* a = &c->allocator;
+    if (c->edges) {
+        for (uint32_t i = 0; i < c->edge_count; i++) edge_id_free(a, &c->edges[i].id);
+    }
+    free_array(a, c->nodes, c->node_cap, sizeof(jcanvas_node));
+    free_array(a, c->edges, c->edge_cap, sizeof(jcanvas_edge));
+    free_array(a, c->id_to_nodes.slots, c->id_to_nodes.cap, sizeof(map_slot));
+    free_array(a, c->id_to_edges.slots, c->id_to_edges.cap, sizeof(map_slot));
+    free_array(a, c->edge_pairs.keys, c->edge_pairs.cap, sizeof(uint64_t));
+    free_array(a, c->bitmaps.bits, JCANVAS_BITMAP_SETS * c->bitmaps.words_cap, sizeof(uint64_t));
+    free_array(a, c->extras, c->extra_cap, sizeof(jcanvas_node_extra));
+    free_array(a, c->extra_of, c->extra_of_cap, sizeof(uint32_t));
+    free_array(a, c->view_changed, view_changed_words(&c->last_view), sizeof(uint64_t));
+    jcanvas_view_destroy(&c->last_view);
+    while (c->owned_strings) {
+        jcanvas_string_block* next = c->owned_strings->next;
+        a->free(a->ctx, c->owned_strings, sizeof(jcanvas_string_block) + c->owned_strings->size);
+        c->owned_strings = next;
     }
+    jcanvas_adjacency* adj = &c->adjacency;
+    free_array(a, adj->out_start, adj->nodes_cap, sizeof(uint32_t));
+    free_array(a, adj->out_count, adj->nodes_cap, sizeof(uint32_t));
+    free_array(a, adj->in_start, adj->nodes_cap, sizeof(uint32_t));
+    free_array(a, adj->in_count, adj->nodes_cap, sizeof(uint32_t));
+    free_array(a, adj->out_edges, adj->edges_cap, sizeof(uint32_t));
+    free_array(a, adj->in_edges, adj->edges_cap, sizeof(uint32_t));
 }
\ No newline at end of file
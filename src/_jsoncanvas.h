@@ -1,8 +1,10 @@
 #pragma once
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
 
-// Define
+// Define the default allocator, used unless a canvas is initialized with its own
 #ifndef ALLOCATE
     #define ALLOCATE malloc
 #endif
@@ -19,7 +21,33 @@ typedef struct {
     uint32_t cap;
 } str;
 
-typedef str jcanvas_color;
+#define SSTR_INLINE_CAP 15
+#define SSTR_REF 0xff
+
+// small string used for ids and colors. strings of up to 15 bytes are stored in place,
+// longer ones point to memory owned elsewhere. raw[15] holds the inline length or SSTR_REF
+typedef union {
+    struct {
+        char data[SSTR_INLINE_CAP];
+        uint8_t len;
+    } in;
+    struct {
+        char* data;
+        uint32_t len;
+    } ref;
+    uint8_t raw[16];
+} sstr;
+
+typedef sstr jcanvas_color;
+
+// every allocation of a canvas goes through its allocator. sizes are passed back on
+// reallocate and free, so pools and bounded allocators don't have to track them
+typedef struct {
+    void* (*allocate)(void* ctx, size_t size);
+    void* (*reallocate)(void* ctx, void* ptr, size_t old_size, size_t new_size);
+    void (*free)(void* ctx, void* ptr, size_t size);
+    void* ctx;
+} jcanvas_allocator;
 
 typedef enum {
     STYLE_OVER,
@@ -27,32 +55,74 @@ typedef enum {
     STYLE_REPEAT,
 } jcanvas_background_style; 
 
+// defining JCANVAS_COMPACT_NODES before including stores coordinates as int32, node colors as a
+// packed code and drops the cached id hash, which halves jcanvas_node. only for canvases whose bounds fit
+#ifdef JCANVAS_COMPACT_NODES
+typedef int32_t jcanvas_coord;
+#define JCANVAS_COORD_MIN INT32_MIN
+#define JCANVAS_COORD_MAX INT32_MAX
+#else
+typedef int64_t jcanvas_coord;
+#define JCANVAS_COORD_MIN INT64_MIN
+#define JCANVAS_COORD_MAX INT64_MAX
+#endif
+
+enum jcanvas_node_type {
+    NODE_TYPE_TEXT,
+    NODE_TYPE_FILE,
+    NODE_TYPE_LINK,
+    NODE_TYPE_GROUP,
+};
+
+// the fields most nodes don't use live in a jcanvas_node_extra (see jcanvas_get_extra)
 typedef struct {
-    str id;
-    int64_t x, y, width, height;
+    sstr id;
+#ifndef JCANVAS_COMPACT_NODES
+    uint64_t id_hash; // jcanvas_hash of id with the canvas' seed, computed once on creation
+#endif
+    jcanvas_coord x, y, width, height;
+#ifdef JCANVAS_COMPACT_NODES
+    uint32_t color; // jcanvas_color_class in the low byte, 0xrrggbb above it for custom colors. read it with jcanvas_get_color
+#else
     jcanvas_color color;
-
-    enum jcanvas_node_type {
-        NODE_TYPE_TEXT,
-        NODE_TYPE_FILE,
-        NODE_TYPE_LINK,
-        NODE_TYPE_GROUP,
-    } type;
+#endif
+    uint8_t type; // enum jcanvas_node_type
+    bool text_in_file; // text node whose content is as.text_file instead of as.text
 
     union {
         str text;
         struct {
             str path;
-            str subpath;
+        } text_file;
+        struct {
+            str path;
         } file;
         str link;
         struct {
             str label;
+        } group_node;
+    } as;
+} jcanvas_node;
+
+#define JCANVAS_NO_EXTRA UINT32_MAX
+#define JCANVAS_NO_GROUP UINT32_MAX
+
+// optional node fields, stored apart from jcanvas_node for the nodes that have them
+typedef struct {
+    uint32_t node; // index into jcanvas.nodes
+    union {
+        struct {
+            uint64_t offset, len;
+        } text_file;
+        struct {
+            str subpath;
+        } file;
+        struct {
             str background;
             jcanvas_background_style background_style;
         } group_node;
     } as;
-} jcanvas_node;
+} jcanvas_node_extra;
 
 typedef enum {
    SIDE_TOP,
@@ -67,51 +137,331 @@ typedef enum {
 } jcanvas_end;
 
 typedef struct {
-    str id;
-    str from_node;
+    sstr id;
+    uint64_t id_hash;
+    sstr from_node;
     jcanvas_side from_side;
     jcanvas_end from_end;
     jcanvas_side to_side;
     jcanvas_end to_end;
-    str to_node;
+    sstr to_node;
     jcanvas_color color;
     str label;
+    uint32_t from_index, to_index; // indices into jcanvas.nodes
 } jcanvas_edge;
 
-typedef struct map {
-    struct map* left;
-    struct map* right;
-    struct map* parent;
+#define MAP_EMPTY UINT32_MAX
+
+typedef struct {
     uint64_t hash;
-    void* value;
-    bool is_red;
+    sstr key; // a copy of the id, inline ids can't be pointed to since the arrays move
+    uint32_t value; // MAP_EMPTY marks an unused slot
+} map_slot;
+
+// open addressing hash map from ids to indices into the node/edge arrays
+typedef struct {
+    map_slot* slots;
+    uint32_t count, cap;
 } map;
 
+// open addressing set of (from-node index, to-node index) pairs packed into one key
+typedef struct {
+    uint64_t* keys;
+    uint32_t count, cap;
+} pair_set;
+
+// compressed sparse row adjacency, built lazily from the edge array.
+// the out edges of node i are out_edges[out_start[i] .. out_start[i] + out_count[i]], same for in edges.
+// the counts are kept apart from the starts so removals can drop entries in place
+typedef struct {
+    uint32_t* out_start;
+    uint32_t* out_count;
+    uint32_t* in_start;
+    uint32_t* in_count;
+    uint32_t* out_edges;
+    uint32_t* in_edges;
+    uint32_t nodes_cap, edges_cap;
+    bool valid;
+} jcanvas_adjacency;
+
+typedef enum {
+    COLOR_NONE,
+    COLOR_RED,
+    COLOR_ORANGE,
+    COLOR_YELLOW,
+    COLOR_GREEN,
+    COLOR_CYAN,
+    COLOR_PURPLE,
+    COLOR_CUSTOM, // any hex color
+} jcanvas_color_class;
+
+#define JCANVAS_BITMAP_SETS (NODE_TYPE_GROUP + 1 + COLOR_CUSTOM + 1)
+
+// one bit per node for every node type and color class. the sets are stored one after
+// another (words_cap words each), so a query only reads the sets it filters on
+typedef struct {
+    uint64_t* bits;
+    uint32_t words_cap;
+} jcanvas_bitmaps;
+
+// filter for jcanvas_query_nodes, zeroed fields match everything
 typedef struct {
+    uint32_t types;  // mask of (1 << NODE_TYPE_*)
+    uint32_t colors; // mask of (1 << COLOR_*)
+    bool in_region;  // only nodes overlapping x, y, width, height
+    int64_t x, y, width, height;
+} jcanvas_query;
+
+typedef struct jcanvas_node_chunk jcanvas_node_chunk;
+typedef struct jcanvas_edge_chunk jcanvas_edge_chunk;
+
+// immutable copy of a canvas made by jcanvas_snapshot, stored in chunks of nodes and edges. chunks that
+// didn't change are shared with the previous snapshot instead of copied, and released with the last view using them
+typedef struct {
+    jcanvas_allocator allocator;
+    jcanvas_node_chunk** node_chunks;
+    jcanvas_edge_chunk** edge_chunks;
+    uint32_t node_count, edge_count;
+    bool canonical_order; // taken from the canvas
+} jcanvas_view;
+
+// where a node or edge object starts in a canvas file written by jcanvas_generate_to_file_indexed
+typedef struct {
+    uint64_t hash;   // jcanvas_hash of the object's id with the index' seed
+    uint64_t offset;
+    uint32_t len;    // 0 for empty slots
+    uint32_t kind;   // 0 for nodes, 1 for edges
+} jcanvas_index_entry;
+
+// id -> position of every object of a canvas file, as an open addressing table of cap (a power of two) entries,
+// so a lookup only touches a slot or two before the one read of the object itself
+typedef struct {
+    jcanvas_allocator allocator;
+    uint64_t seed;
+    jcanvas_index_entry* entries;
+    uint32_t count, cap;
+} jcanvas_index;
+
+// one square of the grid jcanvas_tiling_plan splits a canvas into
+typedef struct {
+    int64_t x, y; // grid cell, the tile covers x * tile_size to (x + 1) * tile_size
+    uint32_t node_begin, node_count; // range of jcanvas_tiling.nodes
+    uint32_t edge_begin, edge_count; // range of jcanvas_tiling.edges
+} jcanvas_tile;
+
+// nodes go to the tile their center is in, edges to the tile of their nodes. edges between two tiles
+// are cross edges, written to the manifest instead of a tile
+typedef struct {
+    jcanvas_allocator allocator;
+    int64_t tile_size;
+    jcanvas_tile* tiles;
+    uint32_t* nodes; // node indices grouped by tile
+    uint32_t* edges; // edge indices grouped by tile
+    uint32_t* cross_edges;
+    uint32_t tile_count, cross_edge_count;
+    uint32_t tile_cap; // allocated length of tiles
+} jcanvas_tiling;
+
+typedef struct jcanvas_string_block jcanvas_string_block;
+
+// which group every node lies in, see jcanvas_build_group_tree. it isn't updated by later edits
+typedef struct {
+    jcanvas_allocator allocator;
+    uint32_t* parent; // per node the innermost group containing it, or JCANVAS_NO_GROUP
+    uint32_t* child_start; // children of node i are children[child_start[i]] up to children[child_start[i + 1]], top level nodes at i = node_count
+    uint32_t* children;
+    uint32_t node_count;
+} jcanvas_group_tree;
+
+// what jcanvas_import_nodes_csv / jcanvas_import_edges did
+typedef struct {
+    uint32_t rows;    // rows or lines with data
+    uint32_t added;   // nodes or edges made
+    uint32_t skipped; // rows that were left out (see the import functions)
+} jcanvas_import_stats;
+
+// laid out like struct iovec, so the pieces can be passed to writev as they are
+typedef struct {
+    void* base;
+    size_t len;
+} jcanvas_iovec;
+
+// a canvas generated by jcanvas_generate_iov, the concatenation of vecs
+typedef struct {
+    jcanvas_allocator allocator;
+    jcanvas_iovec* vecs;
+    uint32_t count, cap;
+    uint64_t len; // of all pieces together
+    jcanvas_string_block* blocks; // the generated pieces point into these
+} jcanvas_iov;
+
+// where jcanvas_instantiate puts an instance, relative to the template
+typedef struct {
+    int64_t x, y;
+} jcanvas_offset;
+
+// returns the id prefix of instance i. it is copied, so it only has to stay valid until the next call
+typedef str (*jcanvas_id_prefix_fn)(void* user, uint32_t instance);
+
+// how the node and edge arrays grow when they are full
+typedef struct {
+    uint32_t percent; // added to the capacity at every grow, 50 by default
+    uint32_t max_step; // if not 0, at most this many elements are added at once
+} jcanvas_growth;
+
+typedef struct {
+    jcanvas_allocator allocator;
+    uint64_t hash_seed; // random per canvas, so crafted ids can't force collisions
     map id_to_nodes;
     map id_to_edges;
+    pair_set edge_pairs;
+    bool allow_multi_edges; // if true, two nodes may be connected more than once
+    bool fixed_width_fields; // if true, positions and colors are generated padded, so jcanvas_patch_nodes can update them in place
+    bool canonical_order; // if true, nodes and edges are generated sorted by id, so equal canvases generate equal bytes. off by default, it costs about a third more
+    jcanvas_adjacency adjacency;
+    jcanvas_bitmaps bitmaps;
+    jcanvas_node_extra* extras;
+    uint32_t* extra_of; // per node index into extras or JCANVAS_NO_EXTRA, allocated with the first extra
+    uint32_t extra_count, extra_cap, extra_of_cap;
     jcanvas_node* nodes;
     jcanvas_edge* edges;
     uint32_t node_count, edge_count;
     uint32_t node_cap, edge_cap;
+    jcanvas_growth growth;
+    jcanvas_view last_view; // the canvas' own reference to the chunks of the latest snapshot
+    uint64_t* view_changed; // a bit per chunk of last_view (node chunks, then edge chunks) edited since
+    FILE* journal; // every edit is appended to it if set, see jcanvas_journal_open
+    bool journal_multi_edges; // allow_multi_edges as last written to the journal
+    jcanvas_string_block* owned_strings; // strings the canvas made itself (replayed from a journal, instance ids)
     char* last_error;
 } jcanvas;
 
+// position of a jcanvas_gen_begin / jcanvas_gen_next generation
+typedef struct {
+    jcanvas* canvas;
+    str pending; // the last generated piece, handed out from pending_at on
+    uint32_t pending_at;
+    uint32_t stage, next; // next node or edge to generate
+    struct jcanvas_lazy_order* order; // with canonical_order, the nodes or edges being generated sorted as far as they're read
+    const char* error;
+} jcanvas_gen;
+
+typedef enum {
+    VIOLATION_EMPTY_ID,
+    VIOLATION_DUPLICATE_ID,
+    VIOLATION_INVALID_TYPE,
+    VIOLATION_INVALID_BACKGROUND_STYLE,
+    VIOLATION_INVALID_SIZE,
+    VIOLATION_COORDINATE_OVERFLOW,
+    VIOLATION_MISSING_FROM_NODE,
+    VIOLATION_MISSING_TO_NODE,
+    VIOLATION_INVALID_SIDE,
+    VIOLATION_INVALID_END,
+} jcanvas_violation_kind;
+
+typedef struct {
+    jcanvas_violation_kind kind;
+    bool is_edge;
+    uint32_t index; // into jcanvas.nodes or jcanvas.edges
+} jcanvas_violation;
+
+// violations are written into caller provided storage. count keeps counting past cap,
+// so a report that overflowed still tells how many violations there are
+typedef struct {
+    jcanvas_violation* violations;
+    uint32_t cap;
+    uint32_t count;
+} jcanvas_validation_report;
+
+// callbacks of jcanvas_stream_read. the node/edge and its strings are only valid during the call,
+// extra is NULL if the node has no optional fields. return false to stop reading
+typedef bool (*jcanvas_node_fn)(void* user, const jcanvas_node* node, const jcanvas_node_extra* extra);
+typedef bool (*jcanvas_edge_fn)(void* user, const jcanvas_edge* edge);
+
+uint64_t jcanvas_hash(str s, uint64_t seed);
+sstr make_sstr(str s);
+str sstr_view(const sstr* s);
 bool jcanvas_init(jcanvas* result);
+bool jcanvas_init_with_allocator(jcanvas* result, const jcanvas_allocator* allocator);
+bool jcanvas_reserve(jcanvas* c, uint32_t nodes, uint32_t edges);
+bool jcanvas_shrink_to_fit(jcanvas* c);
 jcanvas_node* jcanvas_text_node_s(jcanvas* c, str id, str content);
 jcanvas_node* jcanvas_text_node(jcanvas* c, char* id, char* content);
+jcanvas_node* jcanvas_text_node_from_file_s(jcanvas* c, str id, str path, uint64_t offset, uint64_t len);
+jcanvas_node* jcanvas_text_node_from_file(jcanvas* c, char* id, char* path, uint64_t offset, uint64_t len);
 jcanvas_node* jcanvas_file_node_s(jcanvas* c, str id, str content);
 jcanvas_node* jcanvas_file_node(jcanvas* c, char* id, char* content);
 jcanvas_node* jcanvas_link_node_s(jcanvas* c, str id, str link);
 jcanvas_node* jcanvas_link_node(jcanvas* c, char* id, char* link);
 jcanvas_node* jcanvas_group_node_s(jcanvas* c, str id);
 jcanvas_node* jcanvas_group_node(jcanvas* c, char* id);
-void jcanvas_set_label_s(jcanvas_node* node, str label);
-void jcanvas_set_label(jcanvas_node* node, char* label);
-void jcanvas_set_background_image_s(jcanvas_node* node, str path);
-void jcanvas_set_background_image(jcanvas_node* node, char* path);
-void jcanvas_set_background_style(jcanvas_node* node, jcanvas_background_style style);
+bool jcanvas_set_color(jcanvas* c, jcanvas_node* node, jcanvas_color color);
+jcanvas_color jcanvas_get_color(const jcanvas_node* node);
+const jcanvas_node_extra* jcanvas_get_extra(jcanvas* c, jcanvas_node* node);
+bool jcanvas_set_label_s(jcanvas* c, jcanvas_node* node, str label);
+bool jcanvas_set_label(jcanvas* c, jcanvas_node* node, char* label);
+bool jcanvas_set_subpath_s(jcanvas* c, jcanvas_node* node, str subpath);
+bool jcanvas_set_subpath(jcanvas* c, jcanvas_node* node, char* subpath);
+bool jcanvas_set_background_image_s(jcanvas* c, jcanvas_node* node, str path);
+bool jcanvas_set_background_image(jcanvas* c, jcanvas_node* node, char* path);
+bool jcanvas_set_background_style(jcanvas* c, jcanvas_node* node, jcanvas_background_style style);
 jcanvas_edge* jcanvas_connect(jcanvas* c, jcanvas_node* a, jcanvas_node* b);
-void jcanvas_pos_node(jcanvas_node* node, int64_t x, int64_t y, int64_t width, int64_t height);
+jcanvas_edge* jcanvas_connect_by_id(jcanvas* c, str id_from, str id_to);
+bool jcanvas_set_edge_label_s(jcanvas* c, jcanvas_edge* edge, str label);
+bool jcanvas_set_edge_label(jcanvas* c, jcanvas_edge* edge, char* label);
+bool jcanvas_set_edge_color(jcanvas* c, jcanvas_edge* edge, jcanvas_color color);
+bool jcanvas_set_edge_ends(jcanvas* c, jcanvas_edge* edge, jcanvas_end from_end, jcanvas_end to_end);
+bool jcanvas_instantiate(jcanvas* c, const jcanvas* template_canvas, uint32_t count, const jcanvas_offset* offsets, jcanvas_id_prefix_fn id_prefix, void* user);
+uint32_t jcanvas_out_edges(jcanvas* c, jcanvas_node* node, const uint32_t** edges);
+uint32_t jcanvas_in_edges(jcanvas* c, jcanvas_node* node, const uint32_t** edges);
+uint32_t jcanvas_out_degree(jcanvas* c, jcanvas_node* node);
+uint32_t jcanvas_in_degree(jcanvas* c, jcanvas_node* node);
+bool jcanvas_remove_node(jcanvas* c, jcanvas_node* node);
+bool jcanvas_remove_edge(jcanvas* c, jcanvas_edge* edge);
+bool jcanvas_pos_node(jcanvas* c, jcanvas_node* node, int64_t x, int64_t y, int64_t width, int64_t height);
+void jcanvas_infer_all_edge_sides(jcanvas* c);
+void jcanvas_infer_edge_sides_range(jcanvas* c, uint32_t begin, uint32_t end);
+uint32_t jcanvas_query_nodes(jcanvas* c, const jcanvas_query* query, uint32_t* result, uint32_t cap);
+bool jcanvas_validate(jcanvas* c, jcanvas_validation_report* report);
+bool jcanvas_validate_range(jcanvas* c, jcanvas_validation_report* report, uint32_t node_begin, uint32_t node_end, uint32_t edge_begin, uint32_t edge_end);
+bool jcanvas_stream_read(FILE* file, jcanvas_node_fn on_node, jcanvas_edge_fn on_edge, void* user, const jcanvas_allocator* allocator, const char** error);
 str jcanvas_generate(jcanvas* c);
+bool jcanvas_generate_to_file(jcanvas* c, FILE* file);
+void jcanvas_gen_begin(jcanvas* c, jcanvas_gen* gen);
+uint32_t jcanvas_gen_next(jcanvas_gen* gen, char* buf, uint32_t cap);
+void jcanvas_gen_end(jcanvas_gen* gen);
+bool jcanvas_generate_iov(jcanvas* c, jcanvas_iov* result);
+void jcanvas_iov_free(jcanvas_iov* iov);
+bool jcanvas_generate_to_file_indexed(jcanvas* c, FILE* file, FILE* index_file);
+void jcanvas_free_str(jcanvas* c, str* s);
+bool jcanvas_snapshot(jcanvas* c, jcanvas_view* result);
+void jcanvas_node_changed(jcanvas* c, const jcanvas_node* node);
+void jcanvas_edge_changed(jcanvas* c, const jcanvas_edge* edge);
+const jcanvas_node* jcanvas_view_node(const jcanvas_view* v, uint32_t index);
+const jcanvas_node_extra* jcanvas_view_extra(const jcanvas_view* v, uint32_t index);
+const jcanvas_edge* jcanvas_view_edge(const jcanvas_view* v, uint32_t index);
+str jcanvas_view_generate(const jcanvas_view* v, const char** error);
+bool jcanvas_view_generate_to_file(const jcanvas_view* v, FILE* file, const char** error);
+void jcanvas_view_free_str(const jcanvas_view* v, str* s);
+void jcanvas_view_destroy(jcanvas_view* v);
+bool jcanvas_journal_open(jcanvas* c, FILE* file);
+bool jcanvas_journal_compact(jcanvas* c, FILE* file);
+bool jcanvas_journal_flush(jcanvas* c);
+bool jcanvas_journal_close(jcanvas* c);
+bool jcanvas_index_load(jcanvas_index* index, FILE* index_file, const jcanvas_allocator* allocator, const char** error);
+uint32_t jcanvas_index_fetch(const jcanvas_index* index, FILE* canvas_file, str id, char* buf, uint32_t cap, const char** error);
+bool jcanvas_patch_nodes(jcanvas* c, const jcanvas_index* index, FILE* canvas_file, const uint32_t* nodes, uint32_t count);
+bool jcanvas_generate_tiled(jcanvas* c, int64_t tile_size, const char* out_dir);
+bool jcanvas_tiling_plan(jcanvas* c, jcanvas_tiling* tiling, int64_t tile_size);
+bool jcanvas_tiling_write_range(jcanvas* c, const jcanvas_tiling* tiling, const char* out_dir, uint32_t begin, uint32_t end, const char** error);
+bool jcanvas_tiling_write_manifest(jcanvas* c, const jcanvas_tiling* tiling, const char* out_dir, const char** error);
+void jcanvas_tiling_destroy(jcanvas_tiling* tiling);
+bool jcanvas_build_lod(jcanvas* c, uint32_t levels, uint32_t finest, jcanvas* result);
+bool jcanvas_import_nodes_csv(jcanvas* c, FILE* file, jcanvas_import_stats* stats);
+bool jcanvas_import_edges(jcanvas* c, FILE* file, jcanvas_import_stats* stats);
+bool jcanvas_build_group_tree(jcanvas* c, jcanvas_group_tree* tree);
+uint32_t jcanvas_group_children(const jcanvas_group_tree* tree, uint32_t group, const uint32_t** children);
+bool jcanvas_move_group(jcanvas* c, const jcanvas_group_tree* tree, uint32_t group, int64_t dx, int64_t dy);
+void jcanvas_group_tree_destroy(jcanvas_group_tree* tree);
+void jcanvas_index_destroy(jcanvas_index* index);
 void jcanvas_destroy(jcanvas* c);
\ No newline at end of file
@@ -0,0 +1,1425 @@
+#include <stdio.h>
+#include <stdlib.h> // for malloc, realloc and free
+#include <string.h>
+#include <sys/stat.h> // for mkdir
+#define JSONCANVAS_IMPLEMENTATION // build with -DJCANVAS_COMPACT_NODES to test the compact layout too
+#include "jsoncanvas.h"
+
+static uint32_t failures;
+
+// keeps going after a failed check, so one run lists every failure
+#define CHECK(condition) do { if (!(condition)) { failures++; printf("  %s:%d: %s\n", __FILE__, __LINE__, #condition); } } while (0)
+
+static char ids[4000][32];
+
+static void make_ids(const char* prefix, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) snprintf(ids[i], sizeof(ids[i]), "%s%u", prefix, i);
+}
+
+static bool str_is(str s, const char* text)
+{
+    return s.len == strlen(text) && memcmp(s.data, text, s.len) == 0;
+}
+
+static bool same_output(jcanvas* a, jcanvas* b)
+{
+    str x = jcanvas_generate(a), y = jcanvas_generate(b);
+    bool same = x.data && y.data && x.len == y.len && memcmp(x.data, y.data, x.len) == 0;
+    jcanvas_free_str(a, &x);
+    jcanvas_free_str(b, &y);
+    return same;
+}
+
+// counts the bytes allocated through it, so leaks show up. fails every allocation once heap_limit is reached
+static int64_t heap, heap_limit = INT64_MAX;
+static uint32_t allocations;
+
+static void* counted_allocate(void* ctx, size_t size)
+{
+    if (heap + (int64_t)size > heap_limit) return NULL;
+    heap += size;
+    allocations++;
+    return malloc(size);
+}
+
+static void* counted_reallocate(void* ctx, void* p, size_t old_size, size_t new_size)
+{
+    if (heap + (int64_t)new_size - (int64_t)old_size > heap_limit) return NULL;
+    heap += (int64_t)new_size - (int64_t)old_size;
+    allocations++;
+    return realloc(p, new_size);
+}
+
+static void counted_free(void* ctx, void* p, size_t size)
+{
+    heap -= size;
+    free(p);
+}
+
+static const jcanvas_allocator counting = { counted_allocate, counted_reallocate, counted_free, NULL };
+
+static FILE* file_with(const char* text)
+{
+    FILE* file = tmpfile();
+    fputs(text, file);
+    rewind(file);
+    return file;
+}
+
+// every index of the canvas agrees with its node and edge arrays
+static void check_indices(jcanvas* c)
+{
+    CHECK(c->id_to_nodes.count == c->node_count && c->id_to_edges.count == c->edge_count);
+    for (uint32_t i = 0; i < c->node_count; i++) {
+        uint32_t at = UINT32_MAX;
+        str id = sstr_view(&c->nodes[i].id);
+        CHECK(map_get(&c->id_to_nodes, id, jcanvas_hash(id, c->hash_seed), &at) && at == i);
+
+        const uint32_t* edges;
+        uint32_t out = jcanvas_out_edges(c, &c->nodes[i], &edges), expected = 0;
+        for (uint32_t k = 0; k < out; k++) CHECK(c->edges[edges[k]].from_index == i);
+        for (uint32_t k = 0; k < c->edge_count; k++) expected += c->edges[k].from_index == i;
+        CHECK(out == expected && jcanvas_out_degree(c, &c->nodes[i]) == out);
+        uint32_t in = jcanvas_in_edges(c, &c->nodes[i], &edges);
+        expected = 0;
+        for (uint32_t k = 0; k < in; k++) CHECK(c->edges[edges[k]].to_index == i);
+        for (uint32_t k = 0; k < c->edge_count; k++) expected += c->edges[k].to_index == i;
+        CHECK(in == expected && jcanvas_in_degree(c, &c->nodes[i]) == in);
+    }
+    for (uint32_t i = 0; i < c->edge_count; i++) {
+        const jcanvas_edge* e = &c->edges[i];
+        uint32_t at = UINT32_MAX;
+        CHECK(map_get(&c->id_to_edges, sstr_view(&e->id), e->id_hash, &at) && at == i);
+        CHECK(e->from_index < c->node_count && e->to_index < c->node_count);
+        CHECK(str_eq(sstr_view(&e->from_node), sstr_view(&c->nodes[e->from_index].id)));
+        CHECK(pair_set_contains(&c->edge_pairs, pair_key(e->from_index, e->to_index)));
+    }
+}
+
+// connecting the same two nodes twice, with and without allow_multi_edges
+static void test_duplicate_edges(void)
+{
+    jcanvas c;
+    jcanvas_init(&c);
+    jcanvas_node* a = jcanvas_text_node(&c, "ab", "x");
+    jcanvas_node* b = jcanvas_text_node(&c, "c", "y");
+    jcanvas_node* d = jcanvas_text_node(&c, "a", "y");
+    jcanvas_node* e = jcanvas_text_node(&c, "bc", "y");
+    CHECK(jcanvas_connect(&c, a, b) != NULL);
+    CHECK(jcanvas_connect(&c, a, b) == NULL);
+    CHECK(jcanvas_connect(&c, b, a) != NULL); // the other way is another edge
+    CHECK(jcanvas_connect(&c, d, e) != NULL); // same id "abc" made from other nodes
+    CHECK(str_is(sstr_view(&c.edges[2].id), "abc#2"));
+    c.allow_multi_edges = true;
+    CHECK(jcanvas_connect(&c, a, b) != NULL && c.edge_count == 4);
+    check_indices(&c);
+    jcanvas_destroy(&c);
+}
+
+// out and in edges against counting them in the edge array, also after adding more
+static void test_adjacency(void)
+{
+    jcanvas c;
+    jcanvas_init(&c);
+    make_ids("n", 500);
+    for (uint32_t i = 0; i < 500; i++) jcanvas_text_node(&c, ids[i], "t");
+    for (uint32_t i = 0; i < 500; i++) {
+        for (uint32_t k = 1; k < 5; k++) jcanvas_connect(&c, &c.nodes[i], &c.nodes[(i * 7 + k * 13) % 500]);
+    }
+    check_indices(&c);
+    jcanvas_node* x = jcanvas_text_node(&c, "x", "t");
+    CHECK(jcanvas_in_degree(&c, x) == 0);
+    jcanvas_connect(&c, &c.nodes[0], x);
+    CHECK(jcanvas_in_degree(&c, &c.nodes[500]) == 1);
+    check_indices(&c);
+    jcanvas_destroy(&c);
+}
+
+// random removals keep the id maps, the pair set and the adjacency in step
+static void test_removal(void)
+{
+    for (int multi = 0; multi < 2; multi++) {
+        jcanvas c;
+        jcanvas_init(&c);
+        c.allow_multi_edges = multi;
+        make_ids("n", 300);
+        for (uint32_t i = 0; i < 300; i++) jcanvas_text_node(&c, ids[i], "t");
+        srand(1);
+        for (int i = 0; i < 1000; i++) jcanvas_connect(&c, &c.nodes[rand() % 300], &c.nodes[rand() % 300]);
+        for (int round = 0; round < 200; round++) {
+            int op = rand() % 3;
+            if (op == 0 && c.node_count) CHECK(jcanvas_remove_node(&c, &c.nodes[rand() % c.node_count]));
+            else if (op == 1 && c.edge_count) CHECK(jcanvas_remove_edge(&c, &c.edges[rand() % c.edge_count]));
+            else if (c.node_count) jcanvas_connect(&c, &c.nodes[rand() % c.node_count], &c.nodes[rand() % c.node_count]);
+        }
+        check_indices(&c);
+        CHECK(!jcanvas_remove_node(&c, NULL));
+        jcanvas_destroy(&c);
+    }
+}
+
+static bool count_node(void* user, const jcanvas_node* node, const jcanvas_node_extra* extra)
+{
+    (*(uint32_t*)user)++;
+    return true;
+}
+
+// every allocation goes through the canvas' allocator, and running out of memory fails the call instead of the program
+static void test_allocator(void)
+{
+    jcanvas c;
+    CHECK(jcanvas_init_with_allocator(&c, &counting));
+    make_ids("n", 1000);
+    for (uint32_t i = 0; i < 1000; i++) jcanvas_text_node(&c, ids[i], "t");
+    for (uint32_t i = 1; i < 1000; i++) jcanvas_connect(&c, &c.nodes[i - 1], &c.nodes[i]);
+    CHECK(heap > 0 && allocations > 0);
+    str s = jcanvas_generate(&c);
+    CHECK(s.data != NULL);
+    jcanvas_free_str(&c, &s);
+
+    // with no memory left, adding nodes fails once the arrays are full, and leaves the canvas as it was
+    heap_limit = heap;
+    jcanvas_node* added = &c.nodes[0];
+    uint32_t before = 0;
+    for (uint32_t i = 0; i < 1000 && added; i++) {
+        before = c.node_count;
+        added = jcanvas_text_node(&c, ids[i] + 1, "t"); // "0", "1", ...
+    }
+    CHECK(added == NULL && c.last_error != NULL && c.node_count == before);
+    heap_limit = INT64_MAX;
+    check_indices(&c);
+    jcanvas_destroy(&c);
+    CHECK(heap == 0);
+
+    // the stream reader takes one as well
+    uint32_t nodes = 0;
+    FILE* file = file_with("{\"nodes\":[{\"id\":\"a\",\"type\":\"text\",\"text\":\"t\",\"x\":0,\"y\":0,\"width\":1,\"height\":1}]}");
+    allocations = 0;
+    CHECK(jcanvas_stream_read(file, count_node, NULL, &nodes, &counting, NULL) && nodes == 1);
+    CHECK(allocations > 0 && heap == 0);
+    rewind(file);
+    heap_limit = 0;
+    const char* error = NULL;
+    CHECK(!jcanvas_stream_read(file, count_node, NULL, &nodes, &counting, &error) && error != NULL);
+    heap_limit = INT64_MAX;
+    fclose(file);
+}
+
+static bool reported(const jcanvas_validation_report* report, jcanvas_violation_kind kind, bool is_edge, uint32_t index)
+{
+    for (uint32_t i = 0; i < report->count && i < report->cap; i++) {
+        const jcanvas_violation* v = &report->violations[i];
+        if (v->kind == kind && v->is_edge == is_edge && v->index == index) return true;
+    }
+    return false;
+}
+
+// every kind of violation is found, a full report keeps counting, and ranges add up to the whole canvas
+static void test_validation(void)
+{
+    jcanvas c;
+    jcanvas_init(&c);
+    make_ids("n", 8);
+    for (uint32_t i = 0; i < 8; i++) jcanvas_pos_node(&c, jcanvas_text_node(&c, ids[i], "t"), i, i, 10, 10);
+    for (uint32_t i = 1; i < 8; i++) jcanvas_connect(&c, &c.nodes[i - 1], &c.nodes[i]);
+    jcanvas_violation violations[16];
+    jcanvas_validation_report report = { violations, 16, 0 };
+    CHECK(jcanvas_validate(&c, &report) && report.count == 0);
+
+    jcanvas_node saved[8];
+    jcanvas_edge saved_edges[7];
+    memcpy(saved, c.nodes, sizeof(saved));
+    memcpy(saved_edges, c.edges, sizeof(saved_edges));
+    c.nodes[1].id = c.nodes[0].id;
+    c.nodes[2].id = (sstr){0};
+    c.nodes[3].type = 9;
+    c.nodes[4].width = 0;
+    c.nodes[5].x = JCANVAS_COORD_MAX - 5;
+    c.edges[0].to_node = make_sstr(make_str("missing"));
+    c.edges[1].from_index = 100; // a stale index alone is fine, the id is looked up then
+    c.edges[2].to_index = 100;
+    c.edges[1].from_node = make_sstr(make_str("gone"));
+    c.edges[2].to_side = 7;
+    c.edges[3].from_end = 2;
+    CHECK(!jcanvas_validate(&c, &report) && report.count == 9);
+    CHECK(reported(&report, VIOLATION_DUPLICATE_ID, false, 1) && reported(&report, VIOLATION_EMPTY_ID, false, 2));
+    CHECK(reported(&report, VIOLATION_INVALID_TYPE, false, 3) && reported(&report, VIOLATION_INVALID_SIZE, false, 4));
+    CHECK(reported(&report, VIOLATION_COORDINATE_OVERFLOW, false, 5) && reported(&report, VIOLATION_MISSING_TO_NODE, true, 0));
+    CHECK(reported(&report, VIOLATION_MISSING_FROM_NODE, true, 1) && reported(&report, VIOLATION_INVALID_SIDE, true, 2));
+    CHECK(reported(&report, VIOLATION_INVALID_END, true, 3));
+
+    jcanvas_validation_report small = { violations, 2, 0 };
+    CHECK(!jcanvas_validate(&c, &small) && small.count == 9);
+    jcanvas_validation_report first = { violations, 16, 0 }, second = { violations + 8, 8, 0 };
+    jcanvas_validate_range(&c, &first, 0, 4, 0, 2);
+    jcanvas_validate_range(&c, &second, 4, 8, 2, 7);
+    CHECK(first.count + second.count == 9);
+
+    memcpy(c.nodes, saved, sizeof(saved));
+    memcpy(c.edges, saved_edges, sizeof(saved_edges));
+    CHECK(jcanvas_validate(&c, &report));
+    jcanvas_destroy(&c);
+}
+
+typedef struct {
+    jcanvas* source;
+    uint32_t nodes, edges, mismatches;
+    uint32_t stop_after;
+} stream_check;
+
+// every node read has to be a node of the source canvas with the same fields
+static bool stream_node(void* user, const jcanvas_node* node, const jcanvas_node_extra* extra)
+{
+    stream_check* s = user;
+    uint32_t at;
+    str id = sstr_view(&node->id);
+    s->nodes++;
+    if (!map_get(&s->source->id_to_nodes, id, jcanvas_hash(id, s->source->hash_seed), &at)) {
+        s->mismatches++;
+        return true;
+    }
+    jcanvas_node* original = &s->source->nodes[at];
+    bool same = node->type == original->type && node->x == original->x && node->y == original->y;
+    same = same && node->width == original->width && node->height == original->height;
+    if (node->type == NODE_TYPE_TEXT) same = same && str_eq(node->as.text, original->as.text);
+    if (node->type == NODE_TYPE_LINK) same = same && str_eq(node->as.link, original->as.link);
+    const jcanvas_node_extra* original_extra = jcanvas_get_extra(s->source, original);
+    same = same && (extra == NULL) == (original_extra == NULL);
+    if (extra && node->type == NODE_TYPE_FILE) same = same && str_eq(extra->as.file.subpath, original_extra->as.file.subpath);
+    if (extra && node->type == NODE_TYPE_GROUP) same = same && str_eq(extra->as.group_node.background, original_extra->as.group_node.background);
+    if (!same) s->mismatches++;
+    return s->stop_after == 0 || s->nodes < s->stop_after;
+}
+
+static bool stream_edge(void* user, const jcanvas_edge* edge)
+{
+    stream_check* s = user;
+    uint32_t at;
+    s->edges++;
+    if (!map_get(&s->source->id_to_edges, sstr_view(&edge->id), jcanvas_hash(sstr_view(&edge->id), s->source->hash_seed), &at)) s->mismatches++;
+    else if (!str_eq(sstr_view(&edge->from_node), sstr_view(&s->source->edges[at].from_node))) s->mismatches++;
+    else if (!str_eq(sstr_view(&edge->to_node), sstr_view(&s->source->edges[at].to_node))) s->mismatches++;
+    return true;
+}
+
+// reading a generated canvas back gives every node and edge as it was, also strings longer than a read chunk
+static void test_stream_read(void)
+{
+    jcanvas c;
+    jcanvas_init(&c);
+    char* big = malloc(200001);
+    memset(big, 'a', 200000);
+    big[200000] = 0;
+    for (uint32_t k = 1000; k < 199000; k += 997) memcpy(big + k, "\\\"", 2); // some of them across chunk boundaries
+    make_ids("n", 2000);
+    for (uint32_t i = 0; i < 2000; i++) {
+        jcanvas_node* n;
+        switch (i % 4) {
+            case 0: n = jcanvas_text_node(&c, ids[i], i == 4 ? big : "text with \\\"quotes\\\""); break;
+            case 1: n = jcanvas_file_node(&c, ids[i], "a.md"); jcanvas_set_subpath(&c, n, "#heading"); break;
+            case 2: n = jcanvas_link_node(&c, ids[i], "https://example.com"); break;
+            default: n = jcanvas_group_node(&c, ids[i]); jcanvas_set_background_image(&c, n, "bg.png"); break;
+        }
+        jcanvas_pos_node(&c, n, (int64_t)i - 1000, i, 10 + i, 20);
+    }
+    for (uint32_t i = 0; i < 2000; i++) jcanvas_connect(&c, &c.nodes[i], &c.nodes[(i * 7 + 1) % 2000]);
+    FILE* file = tmpfile();
+    CHECK(jcanvas_generate_to_file(&c, file));
+
+    rewind(file);
+    stream_check s = { &c };
+    const char* error = NULL;
+    CHECK(jcanvas_stream_read(file, stream_node, stream_edge, &s, NULL, &error));
+    CHECK(s.nodes == 2000 && s.edges == 2000 && s.mismatches == 0);
+
+    // returning false stops reading
+    rewind(file);
+    s = (stream_check){ &c, .stop_after = 3 };
+    CHECK(jcanvas_stream_read(file, stream_node, stream_edge, &s, NULL, &error) && s.nodes == 3 && s.edges == 0);
+    fclose(file);
+
+    // unknown keys are skipped, a cut off file is an error after the nodes before the cut
+    file = file_with("{ \"edges\" : [ ], \"extra\": {\"a\":[1,2,{\"b\":\"}\"}]}, \"nodes\":[{\"id\":\"n1\",\"type\":\"file\","
+        "\"file\":\"a.md\",\"subpath\":\"#heading\",\"x\":-999,\"y\":1,\"width\":11,\"height\":20,\"more\":null}, {\"id\":");
+    s = (stream_check){ &c };
+    CHECK(!jcanvas_stream_read(file, stream_node, stream_edge, &s, NULL, &error) && error != NULL);
+    CHECK(s.nodes == 1 && s.mismatches == 0);
+    fclose(file);
+    free(big);
+    jcanvas_destroy(&c);
+}
+
+// the nodes a query should find, by looking at every node
+static uint32_t query_by_hand(jcanvas* c, const jcanvas_query* q, uint32_t* result)
+{
+    uint32_t found = 0;
+    for (uint32_t i = 0; i < c->node_count; i++) {
+        const jcanvas_node* n = &c->nodes[i];
+        if (q->types && !(q->types & (1u << n->type))) continue;
+        if (q->colors && !(q->colors & (1u << jcanvas_classify_color(jcanvas_get_color(n))))) continue;
+        if (q->in_region && (n->x >= q->x + q->width || n->x + n->width <= q->x || n->y >= q->y + q->height || n->y + n->height <= q->y)) continue;
+        result[found++] = i;
+    }
+    return found;
+}
+
+// queries find what looking at every node finds, also after colors change and nodes are removed
+static void test_query(void)
+{
+    static uint32_t expected[2000], got[2000];
+    const jcanvas_color colors[] = { (jcanvas_color){ .in = {"", 0} }, jcanvas_red, jcanvas_cyan, make_sstr(make_str("#00ff00")) };
+    jcanvas c;
+    jcanvas_init(&c);
+    make_ids("n", 2000);
+    srand(3);
+    for (uint32_t i = 0; i < 2000; i++) {
+        jcanvas_node* n = i % 3 == 0 ? jcanvas_group_node(&c, ids[i]) : i % 3 == 1 ? jcanvas_text_node(&c, ids[i], "t") : jcanvas_file_node(&c, ids[i], "f");
+        jcanvas_pos_node(&c, n, rand() % 2000 - 1000, rand() % 2000 - 1000, 1 + rand() % 100, 1 + rand() % 100);
+        jcanvas_set_color(&c, n, colors[rand() % 4]);
+    }
+    const jcanvas_query queries[] = {
+        {0},
+        { .types = 1u << NODE_TYPE_FILE },
+        { .colors = (1u << COLOR_RED) | (1u << COLOR_CUSTOM) },
+        { .types = 1u << NODE_TYPE_GROUP, .colors = 1u << COLOR_NONE },
+        { .in_region = true, .x = -100, .y = -50, .width = 300, .height = 200 },
+        { .types = 1u << NODE_TYPE_TEXT, .colors = 1u << COLOR_CYAN, .in_region = true, .x = 0, .y = 0, .width = 1000, .height = 1000 },
+    };
+    for (int round = 0; round < 3; round++) {
+        for (size_t q = 0; q < sizeof(queries) / sizeof(queries[0]); q++) {
+            uint32_t count = query_by_hand(&c, &queries[q], expected);
+            CHECK(jcanvas_query_nodes(&c, &queries[q], got, 2000) == count && memcmp(got, expected, count * sizeof(uint32_t)) == 0);
+            CHECK(jcanvas_query_nodes(&c, &queries[q], got, 1) == count); // counts past cap
+        }
+        for (int k = 0; k < 300; k++) jcanvas_set_color(&c, &c.nodes[rand() % c.node_count], colors[rand() % 4]);
+        for (int k = 0; k < 300; k++) jcanvas_remove_node(&c, &c.nodes[rand() % c.node_count]);
+    }
+    jcanvas_destroy(&c);
+}
+
+// text nodes backed by a file generate its bytes, into memory and file to file
+static void test_text_from_file(void)
+{
+    FILE* text = fopen("test_output.txt", "wb");
+    CHECK(text != NULL);
+    if (text == NULL) return;
+    for (uint32_t i = 0; i < 300000; i++) fputc('a' + i % 26, text);
+    fclose(text);
+
+    jcanvas c;
+    jcanvas_init(&c);
+    jcanvas_text_node(&c, "a", "plain");
+    CHECK(jcanvas_text_node_from_file(&c, "b", "test_output.txt", 5, 250000) != NULL);
+    CHECK(jcanvas_text_node_from_file(&c, "c", "test_output.txt", 0, 3) != NULL);
+    CHECK(c.nodes[1].text_in_file && jcanvas_get_extra(&c, &c.nodes[1])->as.text_file.len == 250000);
+    jcanvas_connect(&c, &c.nodes[0], &c.nodes[1]);
+    str s = jcanvas_generate(&c);
+    CHECK(s.data && strstr(s.data, "\"text\":\"abc\"") && strstr(s.data, "\"text\":\"fghijk"));
+    CHECK(s.len > 250000);
+
+    // generating to a file copies the same bytes
+    FILE* file = tmpfile();
+    CHECK(jcanvas_generate_to_file(&c, file));
+    long size = ftell(file);
+    CHECK(s.data && size == (long)s.len - 1);
+    if (s.data && size == (long)s.len - 1) {
+        char* written = malloc(size);
+        rewind(file);
+        CHECK(fread(written, 1, size, file) == (size_t)size && memcmp(written, s.data, size) == 0);
+        free(written);
+    }
+    fclose(file);
+    jcanvas_free_str(&c, &s);
+
+    // a missing or too short file fails the generation
+    jcanvas_text_node_from_file(&c, "d", "test_output.txt", 299990, 100);
+    s = jcanvas_generate(&c);
+    CHECK(s.data == NULL && c.last_error != NULL);
+    jcanvas_remove_node(&c, &c.nodes[3]);
+    jcanvas_text_node_from_file(&c, "e", "missing/test_output.txt", 0, 3);
+    file = tmpfile();
+    CHECK(!jcanvas_generate_to_file(&c, file) && c.last_error != NULL);
+    fclose(file);
+    jcanvas_destroy(&c);
+    remove("test_output.txt");
+}
+
+// a view keeps what the canvas was, and a new one sees every edit
+static void test_snapshot(void)
+{
+    jcanvas c;
+    jcanvas_init(&c);
+    make_ids("n", 600);
+    for (uint32_t i = 0; i < 600; i++) {
+        jcanvas_node* n = jcanvas_file_node(&c, ids[i], "a.md");
+        if (i % 3 == 0) jcanvas_set_subpath(&c, n, "#s");
+        if (i > 0) jcanvas_connect(&c, &c.nodes[i - 1], n);
+    }
+    str before = jcanvas_generate(&c);
+    jcanvas_view v1, v2;
+    CHECK(jcanvas_snapshot(&c, &v1));
+    CHECK(jcanvas_snapshot(&c, &v2));
+    CHECK(v1.node_chunks[0] == v2.node_chunks[0] && v1.edge_chunks[4] == v2.edge_chunks[4]);
+    jcanvas_view_destroy(&v2);
+
+    // one move copies one chunk
+    jcanvas_pos_node(&c, &c.nodes[300], 5, 5, 50, 50);
+    CHECK(jcanvas_snapshot(&c, &v2));
+    CHECK(v2.node_chunks[0] == v1.node_chunks[0] && v2.node_chunks[2] != v1.node_chunks[2]);
+    CHECK(jcanvas_view_node(&v2, 300)->x == 5 && jcanvas_view_node(&v1, 300)->x != 5);
+    CHECK(jcanvas_view_extra(&v2, 3) != NULL && jcanvas_view_extra(&v2, 4) == NULL);
+    jcanvas_view_destroy(&v2);
+
+    srand(2);
+    for (int round = 0; round < 50; round++) {
+        for (int k = 0; k < 4; k++) {
+            jcanvas_node* n = &c.nodes[rand() % c.node_count];
+            switch (rand() % 5) {
+                case 0: jcanvas_pos_node(&c, n, rand() % 1000, rand() % 1000, 10, 10); break;
+                case 1: jcanvas_set_color(&c, n, jcanvas_red); break;
+                case 2: if (c.node_count > 100) jcanvas_remove_node(&c, n); break;
+                case 3: jcanvas_connect(&c, n, &c.nodes[rand() % c.node_count]); break;
+                default:
+                    if (c.edge_count == 0) break;
+                    c.edges[round % c.edge_count].label = make_str("written directly");
+                    jcanvas_edge_changed(&c, &c.edges[round % c.edge_count]);
+            }
+        }
+        const char* error = NULL;
+        CHECK(jcanvas_snapshot(&c, &v2));
+        str live = jcanvas_generate(&c), viewed = jcanvas_view_generate(&v2, &error);
+        CHECK(live.data && viewed.data && strcmp(live.data, viewed.data) == 0);
+        jcanvas_free_str(&c, &live);
+        jcanvas_view_free_str(&v2, &viewed);
+        jcanvas_view_destroy(&v2);
+    }
+
+    // sides inferred again in two ranges, as two threads would, are seen too
+    for (uint32_t i = 0; i < c.node_count; i++) jcanvas_pos_node(&c, &c.nodes[i], rand() % 1000, rand() % 1000, 10, 10);
+    CHECK(jcanvas_snapshot(&c, &v2));
+    jcanvas_view_destroy(&v2);
+    for (uint32_t i = 0; i < c.node_count; i++) c.nodes[i].x = -c.nodes[i].x;
+    jcanvas_infer_edge_sides_range(&c, 0, c.edge_count / 2);
+    jcanvas_infer_edge_sides_range(&c, c.edge_count / 2, c.edge_count);
+    CHECK(jcanvas_snapshot(&c, &v2));
+    for (uint32_t i = 0; i < c.edge_count; i++) CHECK(jcanvas_view_edge(&v2, i)->from_side == c.edges[i].from_side && jcanvas_view_edge(&v2, i)->to_side == c.edges[i].to_side);
+    jcanvas_view_destroy(&v2);
+
+    // the first view outlives all of it, and the canvas
+    jcanvas_destroy(&c);
+    const char* error = NULL;
+    str old = jcanvas_view_generate(&v1, &error);
+    CHECK(old.data && strcmp(old.data, before.data) == 0);
+    jcanvas_view_free_str(&v1, &old);
+    jcanvas_view_free_str(&v1, &before);
+    jcanvas_view_destroy(&v1);
+}
+
+// replaying the journal gives back the canvas, also with a torn last record
+static void test_journal(void)
+{
+    FILE* file = tmpfile();
+    jcanvas c, replayed;
+    jcanvas_init(&c);
+    CHECK(jcanvas_journal_open(&c, file));
+    make_ids("n", 200);
+    for (uint32_t i = 0; i < 200; i++) {
+        jcanvas_node* n = i % 2 ? jcanvas_text_node(&c, ids[i], "text") : jcanvas_group_node(&c, ids[i]);
+        jcanvas_pos_node(&c, n, i * 10, -(int64_t)i, 100, 50);
+        if (i % 2 == 0) jcanvas_set_label(&c, n, "group");
+        if (i % 5 == 0) jcanvas_set_color(&c, n, jcanvas_cyan);
+        if (i > 0) jcanvas_connect(&c, &c.nodes[i - 1], n);
+    }
+    jcanvas_remove_node(&c, &c.nodes[10]);
+    jcanvas_remove_edge(&c, &c.edges[0]);
+    CHECK(jcanvas_set_edge_label(&c, &c.edges[3], "edge label"));
+    CHECK(jcanvas_set_edge_color(&c, &c.edges[4], jcanvas_purple));
+    CHECK(jcanvas_set_edge_ends(&c, &c.edges[5], END_ARROW, END_NONE));
+    // edges between nodes that are connected already, with the flag only set by now
+    c.allow_multi_edges = true;
+    CHECK(jcanvas_connect(&c, &c.nodes[0], &c.nodes[1]) && jcanvas_connect(&c, &c.nodes[0], &c.nodes[1]));
+    CHECK(jcanvas_journal_close(&c));
+
+    jcanvas_init(&replayed);
+    CHECK(jcanvas_journal_open(&replayed, file));
+    CHECK(replayed.node_count == c.node_count && replayed.edge_count == c.edge_count);
+    CHECK(same_output(&c, &replayed) && replayed.allow_multi_edges);
+    CHECK(str_is(replayed.edges[3].label, "edge label") && replayed.edges[5].from_end == END_ARROW);
+    // later edits go on at the end of the journal
+    jcanvas_pos_node(&replayed, &replayed.nodes[0], 7, 7, 7, 7);
+    jcanvas_pos_node(&c, &c.nodes[0], 7, 7, 7, 7);
+    CHECK(jcanvas_journal_close(&replayed));
+    jcanvas_destroy(&replayed);
+
+    // cut into the last record, as if the program stopped while writing it
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    rewind(file);
+    char* data = malloc(size);
+    CHECK(fread(data, 1, size, file) == (size_t)size);
+    FILE* torn = tmpfile();
+    fwrite(data, 1, size - 3, torn);
+    free(data);
+    jcanvas_init(&replayed);
+    CHECK(jcanvas_journal_open(&replayed, torn));
+    CHECK(replayed.node_count == c.node_count && replayed.nodes[0].x != 7);
+    jcanvas_journal_close(&replayed);
+    jcanvas_destroy(&replayed);
+
+    // a compacted journal of the multi edges replays as well
+    FILE* compacted = tmpfile();
+    CHECK(jcanvas_journal_compact(&c, compacted) && jcanvas_journal_close(&c));
+    jcanvas_init(&replayed);
+    CHECK(jcanvas_journal_open(&replayed, compacted));
+    CHECK(same_output(&c, &replayed));
+    jcanvas_journal_close(&replayed);
+    jcanvas_destroy(&replayed);
+    fclose(compacted);
+
+    // a non empty canvas can't replay
+    rewind(file);
+    CHECK(!jcanvas_journal_open(&c, file));
+    jcanvas_destroy(&c);
+    fclose(torn);
+    fclose(file);
+}
+
+static char prefix_buf[32];
+
+static str instance_prefix(void* user, uint32_t instance)
+{
+    int len = snprintf(prefix_buf, sizeof(prefix_buf), "%s%u/", (char*)user, instance);
+    return make_str_l(prefix_buf, len);
+}
+
+static str same_prefix(void* user, uint32_t instance)
+{
+    return make_str("same/");
+}
+
+static void make_template(jcanvas* t)
+{
+    jcanvas_init(t);
+    jcanvas_node* group = jcanvas_group_node(t, "group");
+    jcanvas_set_label(t, group, "motif");
+    jcanvas_pos_node(t, group, 0, 0, 500, 500);
+    jcanvas_pos_node(t, jcanvas_text_node(t, "a", "first"), 10, 20, 100, 50);
+    jcanvas_pos_node(t, jcanvas_text_node(t, "a-much-longer-node-id", "second"), 300, 20, 100, 50);
+    jcanvas_node* file = jcanvas_file_node(t, "f", "x.md");
+    jcanvas_set_subpath(t, file, "#sub");
+    jcanvas_set_color(t, file, jcanvas_cyan);
+    jcanvas_set_edge_label(t, jcanvas_connect(t, &t->nodes[1], &t->nodes[2]), "edge label");
+    jcanvas_connect(t, &t->nodes[2], &t->nodes[3]);
+}
+
+// instances are copies of the template moved by their offset, with prefixed ids
+static void test_instantiate(void)
+{
+    jcanvas t, c;
+    make_template(&t);
+    jcanvas_init(&c);
+    jcanvas_text_node(&c, "existing", "x");
+    jcanvas_offset offsets[50];
+    for (uint32_t k = 0; k < 50; k++) offsets[k] = (jcanvas_offset){ k * 1000, -(int64_t)k * 7 };
+    CHECK(jcanvas_instantiate(&c, &t, 50, offsets, instance_prefix, "i"));
+    CHECK(c.node_count == 1 + 50 * 4 && c.edge_count == 50 * 2);
+    for (uint32_t k = 0; k < 50; k++) {
+        for (uint32_t i = 0; i < 4; i++) {
+            const jcanvas_node* copy = &c.nodes[1 + k * 4 + i], *original = &t.nodes[i];
+            char id[64];
+            snprintf(id, sizeof(id), "i%u/%s", k, sstr_view(&original->id).data);
+            CHECK(str_is(sstr_view(&copy->id), id) && copy->type == original->type);
+            CHECK(copy->x == original->x + offsets[k].x && copy->y == original->y + offsets[k].y && copy->width == original->width);
+        }
+        const jcanvas_edge* e = &c.edges[k * 2];
+        CHECK(e->from_index == 1 + k * 4 + 1 && e->to_index == 1 + k * 4 + 2 && str_is(e->label, "edge label"));
+    }
+    jcanvas_query files = { .types = 1u << NODE_TYPE_FILE, .colors = 1u << COLOR_CYAN };
+    CHECK(jcanvas_query_nodes(&c, &files, NULL, 0) == 50);
+    CHECK(jcanvas_connect_by_id(&c, make_str("i5/a"), make_str("i7/a-much-longer-node-id")) != NULL);
+    CHECK(jcanvas_remove_node(&c, &c.nodes[3]));
+    check_indices(&c);
+
+    // a taken id, ids repeated between instances or running out of memory add nothing
+    jcanvas_text_node(&c, "q25/a", "taken");
+    uint32_t nodes = c.node_count, edges = c.edge_count;
+    str before = jcanvas_generate(&c);
+    CHECK(!jcanvas_instantiate(&c, &t, 40, NULL, instance_prefix, "q") && c.last_error != NULL);
+    CHECK(!jcanvas_instantiate(&c, &t, 2, NULL, same_prefix, NULL));
+    CHECK(!jcanvas_instantiate(&c, &c, 1, NULL, instance_prefix, "k")); // not into itself
+    CHECK(c.node_count == nodes && c.edge_count == edges);
+    str after = jcanvas_generate(&c);
+    CHECK(before.len == after.len && memcmp(before.data, after.data, before.len) == 0);
+    jcanvas_free_str(&c, &before);
+    jcanvas_free_str(&c, &after);
+    check_indices(&c);
+    jcanvas_destroy(&c);
+
+    for (int64_t limit = 0; limit < 100000; limit += 2000) {
+        jcanvas_init_with_allocator(&c, &counting);
+        heap_limit = heap + limit;
+        bool ok = jcanvas_instantiate(&c, &t, 20, NULL, instance_prefix, "m");
+        heap_limit = INT64_MAX;
+        CHECK(ok ? c.node_count == 80 : c.node_count == 0 && c.edge_count == 0 && c.id_to_nodes.count == 0);
+        jcanvas_destroy(&c);
+        CHECK(heap == 0);
+    }
+    jcanvas_destroy(&t);
+}
+
+// the sides written out case by case, as jcanvas_connect picked them before batching
+static void sides_by_hand(const jcanvas_node* a, const jcanvas_node* b, jcanvas_side* from, jcanvas_side* to)
+{
+    bool below = a->y > b->y + b->height, above = a->y + a->height <= b->y;
+    if (a->x + a->width / 2 < b->x) { // a left of b
+        *to = SIDE_LEFT;
+        *from = below ? SIDE_TOP : above ? SIDE_BOTTOM : SIDE_RIGHT;
+    } else if (a->x >= b->x + b->width / 2) { // a right of b
+        *to = SIDE_RIGHT;
+        *from = below ? SIDE_TOP : above ? SIDE_BOTTOM : SIDE_LEFT;
+    } else if (below) {
+        *from = SIDE_TOP; *to = SIDE_BOTTOM;
+    } else if (above) {
+        *from = SIDE_BOTTOM; *to = SIDE_TOP;
+    } else { // overlapping
+        *from = SIDE_RIGHT; *to = SIDE_LEFT;
+    }
+}
+
+// single edges, whole canvases and ranges of any length infer the same sides
+static void test_edge_sides(void)
+{
+    jcanvas c;
+    jcanvas_init(&c);
+    jcanvas_node* a = jcanvas_text_node(&c, "a", "t");
+    jcanvas_node* b = jcanvas_text_node(&c, "b", "t");
+    jcanvas_pos_node(&c, a, 0, 0, 100, 50);
+    jcanvas_pos_node(&c, b, 0, 100, 100, 50);
+    jcanvas_edge* e = jcanvas_connect(&c, a, b);
+    CHECK(e->from_side == SIDE_BOTTOM && e->to_side == SIDE_TOP); // a right above b
+    jcanvas_pos_node(&c, a, 0, 50, 100, 50);
+    jcanvas_infer_all_edge_sides(&c);
+    CHECK(e->from_side == SIDE_BOTTOM && e->to_side == SIDE_TOP); // touching
+    jcanvas_pos_node(&c, a, 0, 200, 100, 50);
+    jcanvas_infer_all_edge_sides(&c);
+    CHECK(e->from_side == SIDE_TOP && e->to_side == SIDE_BOTTOM);
+    jcanvas_pos_node(&c, a, -300, 100, 100, 50);
+    jcanvas_infer_all_edge_sides(&c);
+    CHECK(e->from_side == SIDE_RIGHT && e->to_side == SIDE_LEFT);
+    jcanvas_destroy(&c);
+
+    jcanvas_init(&c);
+    make_ids("n", 3000);
+    srand(5);
+    for (uint32_t i = 0; i < 3000; i++) {
+        jcanvas_node* n = jcanvas_text_node(&c, ids[i], "t");
+        jcanvas_pos_node(&c, n, rand() % 2000 - 1000, rand() % 2000 - 1000, 1 + rand() % 300, 1 + rand() % 300);
+    }
+    for (uint32_t i = 0; i < 3000; i++) jcanvas_connect(&c, &c.nodes[i], &c.nodes[rand() % 3000]);
+    for (uint32_t i = 0; i < c.node_count; i++) jcanvas_pos_node(&c, &c.nodes[i], c.nodes[i].y, c.nodes[i].x, c.nodes[i].width, c.nodes[i].height);
+    jcanvas_infer_edge_sides_range(&c, 0, 1);
+    jcanvas_infer_edge_sides_range(&c, 1, 300);
+    jcanvas_infer_edge_sides_range(&c, 300, 2000);
+    jcanvas_infer_edge_sides_range(&c, 2000, UINT32_MAX);
+    for (uint32_t i = 0; i < c.edge_count; i++) {
+        jcanvas_edge single = c.edges[i];
+        jcanvas_side from, to;
+        sides_by_hand(&c.nodes[single.from_index], &c.nodes[single.to_index], &from, &to);
+        jcanvas_infer_edge_sides(&single, &c.nodes[single.from_index], &c.nodes[single.to_index]);
+        CHECK(single.from_side == c.edges[i].from_side && single.to_side == c.edges[i].to_side);
+        CHECK(from == c.edges[i].from_side && to == c.edges[i].to_side);
+    }
+    jcanvas_destroy(&c);
+}
+
+static void make_indexed_canvas(jcanvas* c)
+{
+    jcanvas_init(c);
+    c->fixed_width_fields = true;
+    make_ids("n", 300);
+    for (uint32_t i = 0; i < 300; i++) {
+        jcanvas_node* n = jcanvas_text_node(c, ids[i], "text");
+        jcanvas_pos_node(c, n, i * 3, -(int64_t)i, 100 + i, 50);
+        if (i % 3 == 0) jcanvas_set_color(c, n, jcanvas_red);
+        if (i > 0) jcanvas_connect(c, &c->nodes[i - 1], n);
+    }
+}
+
+// fetching objects by id from an indexed file, and index files that can't be trusted
+static void test_index(void)
+{
+    jcanvas c;
+    make_indexed_canvas(&c);
+    FILE* canvas_file = tmpfile();
+    FILE* index_file = tmpfile();
+    CHECK(jcanvas_generate_to_file_indexed(&c, canvas_file, index_file));
+    rewind(index_file);
+    jcanvas_index index;
+    const char* error = NULL;
+    CHECK(jcanvas_index_load(&index, index_file, NULL, &error));
+    CHECK(index.count == c.node_count + c.edge_count);
+
+    char buf[512];
+    uint32_t len = jcanvas_index_fetch(&index, canvas_file, make_str("n42"), buf, sizeof(buf), &error);
+    CHECK(len > 0 && len < sizeof(buf) && memcmp(buf, "{\"id\":\"n42\"", 11) == 0 && buf[len - 1] == '}');
+    CHECK(jcanvas_index_fetch(&index, canvas_file, make_str("n4"), buf, 4, &error) > 4); // only the length
+    CHECK(jcanvas_index_fetch(&index, canvas_file, make_str("missing"), buf, sizeof(buf), &error) == 0 && error == NULL);
+    len = jcanvas_index_fetch(&index, canvas_file, sstr_view(&c.edges[5].id), buf, sizeof(buf), &error);
+    CHECK(len > 0 && strstr(buf, "\"fromNode\"") != NULL);
+
+    // an index with every slot used doesn't make lookups loop forever
+    for (uint32_t i = 0; i < index.cap; i++) {
+        if (index.entries[i].len == 0) index.entries[i] = (jcanvas_index_entry){ .hash = i, .offset = 0, .len = 1 };
+    }
+    CHECK(jcanvas_index_fetch(&index, canvas_file, make_str("missing"), buf, sizeof(buf), &error) == 0);
+    jcanvas_index_destroy(&index);
+
+    // and isn't loaded from a file either, nor a file whose count is wrong
+    fseek(index_file, 0, SEEK_END);
+    long size = ftell(index_file);
+    uint8_t* data = malloc(size);
+    rewind(index_file);
+    CHECK(fread(data, 1, size, index_file) == (size_t)size);
+    for (int broken = 0; broken < 3; broken++) {
+        uint8_t* copy = malloc(size);
+        memcpy(copy, data, size);
+        if (broken == 0) copy[4]++; // count
+        if (broken == 1) for (long at = 24; at < size; at += 24) copy[at + 16] |= 1; // every len
+        FILE* file = tmpfile();
+        fwrite(copy, 1, broken == 2 ? size - 10 : size, file);
+        rewind(file);
+        CHECK(!jcanvas_index_load(&index, file, NULL, &error) && error != NULL);
+        fclose(file);
+        free(copy);
+    }
+    free(data);
+    fclose(index_file);
+    fclose(canvas_file);
+    jcanvas_destroy(&c);
+}
+
+// the patched file is what generating again writes
+static void test_patch(void)
+{
+    jcanvas c;
+    make_indexed_canvas(&c);
+    FILE* canvas_file = tmpfile();
+    FILE* index_file = tmpfile();
+    CHECK(jcanvas_generate_to_file_indexed(&c, canvas_file, index_file));
+    rewind(index_file);
+    jcanvas_index index;
+    const char* error = NULL;
+    CHECK(jcanvas_index_load(&index, index_file, NULL, &error));
+    fclose(index_file);
+
+    uint32_t changed[3] = { 0, 5, 299 };
+    jcanvas_pos_node(&c, &c.nodes[0], -9223372036854775807LL, 9223372036854775807LL, 1, 2);
+    jcanvas_set_color(&c, &c.nodes[5], make_sstr(make_str("#12ab34")));
+    jcanvas_set_color(&c, &c.nodes[299], (jcanvas_color){0});
+    CHECK(jcanvas_patch_nodes(&c, &index, canvas_file, changed, 3));
+    fseek(canvas_file, 0, SEEK_END);
+    long size = ftell(canvas_file);
+    rewind(canvas_file);
+    char* patched = malloc(size);
+    CHECK(fread(patched, 1, size, canvas_file) == (size_t)size);
+    str again = jcanvas_generate(&c);
+    CHECK(again.len - 1 == (uint32_t)size && memcmp(again.data, patched, size) == 0);
+    jcanvas_free_str(&c, &again);
+    free(patched);
+
+    // a color longer than its field and a node that isn't in the file fail
+    uint32_t one = 7;
+    if (jcanvas_set_color(&c, &c.nodes[7], make_sstr(make_str("lightgoldenrodyellow")))) {
+        CHECK(!jcanvas_patch_nodes(&c, &index, canvas_file, &one, 1) && c.last_error != NULL);
+    }
+    jcanvas_text_node(&c, "new", "text");
+    uint32_t added = c.node_count - 1;
+    CHECK(!jcanvas_patch_nodes(&c, &index, canvas_file, &added, 1) && c.last_error != NULL);
+
+    jcanvas_index_destroy(&index);
+    fclose(canvas_file);
+    jcanvas_destroy(&c);
+}
+
+static char* read_file(const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) return NULL;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    rewind(file);
+    char* text = malloc(size + 1);
+    text[fread(text, 1, size, file)] = 0;
+    fclose(file);
+    return text;
+}
+
+// every node in the tile of its center, every edge in one tile or the cross edges
+static void test_tiling(void)
+{
+    jcanvas c;
+    jcanvas_init(&c);
+    make_ids("n", 1000);
+    srand(4);
+    for (uint32_t i = 0; i < 1000; i++) {
+        jcanvas_node* n = jcanvas_text_node(&c, ids[i], "t");
+        jcanvas_pos_node(&c, n, rand() % 20000 - 10000, rand() % 20000 - 10000, 100, 100);
+        if (i > 0) jcanvas_connect(&c, &c.nodes[rand() % i], n);
+    }
+    jcanvas_tiling tiling;
+    CHECK(jcanvas_tiling_plan(&c, &tiling, 1000));
+    uint32_t nodes = 0, edges = 0;
+    for (uint32_t t = 0; t < tiling.tile_count; t++) {
+        const jcanvas_tile* tile = &tiling.tiles[t];
+        CHECK(tile->node_count > 0);
+        for (uint32_t k = 0; k < tile->node_count; k++) {
+            const jcanvas_node* n = &c.nodes[tiling.nodes[tile->node_begin + k]];
+            CHECK(floor_div(n->x + n->width / 2, 1000) == tile->x && floor_div(n->y + n->height / 2, 1000) == tile->y);
+        }
+        for (uint32_t k = 0; k < tile->edge_count; k++) {
+            const jcanvas_edge* e = &c.edges[tiling.edges[tile->edge_begin + k]];
+            const jcanvas_node* from = &c.nodes[e->from_index];
+            CHECK(floor_div(from->x + from->width / 2, 1000) == tile->x && floor_div(from->y + from->height / 2, 1000) == tile->y);
+        }
+        nodes += tile->node_count;
+        edges += tile->edge_count;
+    }
+    CHECK(nodes == c.node_count && edges + tiling.cross_edge_count == c.edge_count);
+
+    // the tile files hold the objects of their tiles, the manifest the edges between them
+    const char* dir = "jcanvas_test_tiles";
+    mkdir(dir, 0700);
+    const char* error = NULL;
+    CHECK(jcanvas_tiling_write_range(&c, &tiling, dir, 0, tiling.tile_count, &error));
+    CHECK(jcanvas_tiling_write_manifest(&c, &tiling, dir, &error));
+    char path[128];
+    for (uint32_t t = 0; t < tiling.tile_count; t++) {
+        const jcanvas_tile* tile = &tiling.tiles[t];
+        snprintf(path, sizeof(path), "%s/tile_%lld_%lld.canvas", dir, (long long)tile->x, (long long)tile->y);
+        char* text = read_file(path);
+        CHECK(text != NULL);
+        for (uint32_t k = 0; text && k < tile->node_count; k++) {
+            char key[64];
+            snprintf(key, sizeof(key), "\"id\":\"%s\"", ids[tiling.nodes[tile->node_begin + k]]);
+            CHECK(strstr(text, key) != NULL);
+        }
+        free(text);
+        remove(path);
+    }
+    snprintf(path, sizeof(path), "%s/manifest.json", dir);
+    char* manifest = read_file(path);
+    CHECK(manifest != NULL && strstr(manifest, "tile_") != NULL);
+    free(manifest);
+    remove(path);
+    remove(dir);
+    jcanvas_tiling_destroy(&tiling);
+    CHECK(!jcanvas_tiling_plan(&c, &tiling, 0));
+    jcanvas_destroy(&c);
+}
+
+// the weight a node or edge of a level stands for, the count in its label if it's merged
+static uint32_t lod_weight(str label, bool merged)
+{
+    return merged ? (uint32_t)strtoul(label.data, NULL, 10) : 1;
+}
+
+// two clusters far apart: the nodes become groups, edges keep their direction and single ones their fields.
+// then every level of a random canvas: all nodes and the edges between clusters are accounted for
+static void test_lod(void)
+{
+    jcanvas c;
+    jcanvas_init(&c);
+    // the ids the clusters would get are taken by nodes and edges of the source canvas
+    jcanvas_pos_node(&c, jcanvas_text_node(&c, "lod0-0", "a"), 0, 0, 10, 10);
+    jcanvas_pos_node(&c, jcanvas_text_node(&c, "a2", "a"), 5, 5, 10, 10);
+    jcanvas_pos_node(&c, jcanvas_text_node(&c, "lod0-1", "b"), 100000, 100000, 10, 10);
+    jcanvas_pos_node(&c, jcanvas_text_node(&c, "b2", "b"), 100005, 100005, 10, 10);
+    jcanvas_pos_node(&c, jcanvas_text_node(&c, "lod0-", "a"), 3, 3, 10, 10);
+    jcanvas_pos_node(&c, jcanvas_text_node(&c, "e1", "a"), 4, 4, 10, 10);
+    jcanvas_edge* single = jcanvas_connect(&c, &c.nodes[0], &c.nodes[2]);
+    single->label = make_str("only one");
+    jcanvas_connect(&c, &c.nodes[3], &c.nodes[0]);
+    jcanvas_connect(&c, &c.nodes[3], &c.nodes[1]);
+    CHECK(str_is(sstr_view(&jcanvas_connect(&c, &c.nodes[4], &c.nodes[5])->id), "lod0-e1"));
+
+    jcanvas lod[2];
+    CHECK(jcanvas_build_lod(&c, 2, 2, lod));
+    jcanvas* level = &lod[0];
+    CHECK(level->node_count == 2 && level->edge_count == 2);
+    for (uint32_t i = 0; i < level->node_count; i++) {
+        CHECK(level->nodes[i].type == NODE_TYPE_GROUP);
+        CHECK(!str_is(sstr_view(&level->nodes[i].id), "lod0-0") && !str_is(sstr_view(&level->nodes[i].id), "lod0-1"));
+    }
+    const jcanvas_edge* kept = str_is(level->edges[0].label, "only one") ? &level->edges[0] : &level->edges[1];
+    const jcanvas_edge* merged = kept == &level->edges[0] ? &level->edges[1] : &level->edges[0];
+    CHECK(str_is(kept->label, "only one") && str_eq(sstr_view(&kept->id), sstr_view(&single->id)));
+    CHECK(str_is(merged->label, "2 edges") && !str_is(sstr_view(&merged->id), "lod0-e1"));
+    CHECK(kept->from_index == merged->to_index && kept->to_index == merged->from_index);
+    jcanvas_validation_report report = {0};
+    CHECK(jcanvas_validate(level, &report));
+    for (uint32_t l = 0; l < 2; l++) jcanvas_destroy(&lod[l]);
+    CHECK(!jcanvas_build_lod(&c, 0, 2, lod));
+    CHECK(!jcanvas_build_lod(&c, 4, 2, lod));
+    CHECK(!jcanvas_build_lod(&c, 1, 32, lod));
+    jcanvas_destroy(&c);
+
+    jcanvas_init(&c);
+    make_ids("n", 400);
+    srand(7);
+    for (uint32_t i = 0; i < 400; i++) {
+        jcanvas_pos_node(&c, jcanvas_text_node(&c, ids[i], "t"), i * 37 % 4000, rand() % 4000, 20, 20);
+        if (i > 0) jcanvas_connect(&c, &c.nodes[rand() % i], &c.nodes[i]);
+    }
+    // the finest cells are small enough for every node to be alone, so the first level is the canvas itself
+    CHECK(jcanvas_build_lod(&c, 1, 31, lod));
+    CHECK(lod[0].node_count == c.node_count && lod[0].edge_count == c.edge_count);
+    for (uint32_t i = 0; i < lod[0].node_count; i++) {
+        str id = sstr_view(&lod[0].nodes[i].id);
+        CHECK(map_get(&c.id_to_nodes, id, jcanvas_hash(id, c.hash_seed), NULL));
+    }
+    jcanvas_destroy(&lod[0]);
+
+    jcanvas levels[5];
+    CHECK(jcanvas_build_lod(&c, 5, 4, levels));
+    uint32_t last_edges = c.edge_count;
+    for (uint32_t l = 0; l < 5; l++) {
+        jcanvas* d = &levels[l];
+        uint32_t nodes = 0, edges = 0;
+        for (uint32_t i = 0; i < d->node_count; i++) nodes += lod_weight(d->nodes[i].as.group_node.label, d->nodes[i].type == NODE_TYPE_GROUP);
+        for (uint32_t i = 0; i < d->edge_count; i++) edges += lod_weight(d->edges[i].label, d->edges[i].label.len > 0);
+        CHECK(nodes == c.node_count && edges <= last_edges);
+        CHECK(jcanvas_validate(d, &report));
+        check_indices(d);
+        last_edges = edges;
+    }
+    CHECK(levels[4].node_count == 1 && levels[4].edge_count == 0);
+    for (uint32_t l = 0; l < 5; l++) jcanvas_destroy(&levels[l]);
+    jcanvas_destroy(&c);
+}
+
+// pulled piece by piece in any size, the canvas is what jcanvas_generate writes. the ids are sorted as the
+// pieces get to them, so they take all the paths of the lazy order: long runs of equal words, high bytes
+static void test_pull(void)
+{
+    jcanvas c;
+    jcanvas_init_with_allocator(&c, &counting);
+    for (uint32_t i = 0; i < 4000; i++) {
+        if (i < 1500) snprintf(ids[i], sizeof(ids[i]), "node-%u", i * 7919 % 1500);
+        else if (i < 3000) snprintf(ids[i], sizeof(ids[i]), "a-very-long-shared-prefix-%u", i);
+        else snprintf(ids[i], sizeof(ids[i]), "\xc3\xa9t\xc3\xa9-%u", i % 10 * 100 + i / 10);
+        jcanvas_text_node(&c, ids[i], "text");
+        if (i > 0) jcanvas_connect(&c, &c.nodes[i - 1], &c.nodes[i]);
+    }
+    for (int canonical = 1; canonical >= 0; canonical--) {
+        c.canonical_order = canonical;
+        str whole = jcanvas_generate(&c);
+        const uint32_t caps[] = { 1, 13, 65536 };
+        for (uint32_t k = 0; k < 3; k++) {
+            char* pulled = malloc(whole.len + 65536);
+            uint32_t len = 0, n;
+            jcanvas_gen gen;
+            jcanvas_gen_begin(&c, &gen);
+            while ((n = jcanvas_gen_next(&gen, pulled + len, caps[k])) > 0) {
+                CHECK(n <= caps[k]);
+                len += n;
+            }
+            CHECK(gen.error == NULL && len == whole.len - 1 && memcmp(pulled, whole.data, len) == 0);
+            jcanvas_gen_end(&gen);
+            free(pulled);
+        }
+        jcanvas_free_str(&c, &whole);
+    }
+
+    // the order is allocated as the generation gets to it, running out of memory stops it with an error
+    c.canonical_order = true;
+    int64_t before = heap;
+    for (int64_t limit = 0; limit < 200000; limit += 10000) {
+        heap_limit = heap + limit;
+        char piece[4096];
+        jcanvas_gen gen;
+        jcanvas_gen_begin(&c, &gen);
+        uint32_t total = 0, n;
+        while ((n = jcanvas_gen_next(&gen, piece, sizeof(piece))) > 0) total += n;
+        CHECK(gen.error != NULL || total > 0);
+        jcanvas_gen_end(&gen);
+        CHECK(heap == before);
+    }
+    heap_limit = INT64_MAX;
+    jcanvas_destroy(&c);
+    CHECK(heap == 0);
+}
+
+static void test_iov(void)
+{
+    static char long_text[300], long_link[100];
+    memset(long_text, 'x', sizeof(long_text) - 1);
+    memcpy(long_link, "https://example.com/", 20);
+    memset(long_link + 20, 'y', sizeof(long_link) - 21);
+    jcanvas c;
+    jcanvas_init_with_allocator(&c, &counting);
+    make_ids("n", 2000);
+    for (uint32_t i = 0; i < 2000; i++) {
+        if (i % 3 == 0) jcanvas_text_node(&c, ids[i], i % 2 ? long_text : "short \"quoted\"\n");
+        else if (i % 3 == 1) jcanvas_link_node(&c, ids[i], long_link);
+        else jcanvas_file_node(&c, ids[i], "dir/file.png");
+        if (i > 0) jcanvas_connect(&c, &c.nodes[i - 1], &c.nodes[i]);
+    }
+    for (int canonical = 1; canonical >= 0; canonical--) {
+        c.canonical_order = canonical;
+        str whole = jcanvas_generate(&c);
+        jcanvas_iov iov;
+        CHECK(jcanvas_generate_iov(&c, &iov));
+        // the pieces together are the canvas, long strings point at the caller's memory instead of a copy
+        char* joined = malloc(iov.len);
+        uint64_t len = 0;
+        uint32_t texts = 0, links = 0;
+        for (uint32_t i = 0; i < iov.count; i++) {
+            memcpy(joined + len, iov.vecs[i].base, iov.vecs[i].len);
+            len += iov.vecs[i].len;
+            texts += iov.vecs[i].base == long_text;
+            links += iov.vecs[i].base == long_link;
+        }
+        CHECK(len == iov.len && len == whole.len - 1 && memcmp(joined, whole.data, len) == 0);
+        CHECK(texts == 333 && links == 667);
+        free(joined);
+        jcanvas_iov_free(&iov);
+        CHECK(iov.count == 0 && iov.vecs == NULL && iov.blocks == NULL);
+        jcanvas_free_str(&c, &whole);
+    }
+
+    // out of memory frees what was generated so far
+    int64_t before = heap;
+    uint32_t failed = 0;
+    for (int64_t limit = 0; limit < 400000; limit += 20000) {
+        heap_limit = heap + limit;
+        jcanvas_iov iov;
+        if (!jcanvas_generate_iov(&c, &iov)) {
+            failed++;
+            CHECK(c.last_error != NULL && iov.count == 0 && iov.blocks == NULL);
+        } else jcanvas_iov_free(&iov);
+        CHECK(heap == before);
+    }
+    heap_limit = INT64_MAX;
+    CHECK(failed > 0);
+    jcanvas_destroy(&c);
+    CHECK(heap == 0);
+}
+
+static void test_import(void)
+{
+    jcanvas c;
+    jcanvas_init_with_allocator(&c, &counting);
+    jcanvas_import_stats stats;
+    FILE* file = file_with("id,x,text,y,color\n"
+        "a,10,\"quoted, \"\"text\"\"\",20,4\n"
+        "b,99999999999999999999999,t,0,\n" // out of range
+        ",1,no id,2,\n"
+        "a,1,taken,2,\n"
+        "c,-5,\"new\nline\",7,#ff0000\n"
+        "d,0,t,0,rebeccapurple\n"); // compact nodes can't store it
+    CHECK(jcanvas_import_nodes_csv(&c, file, &stats));
+    fclose(file);
+#ifdef JCANVAS_COMPACT_NODES
+    CHECK(stats.rows == 6 && stats.added == 2 && stats.skipped == 4);
+    CHECK(c.node_count == 2);
+    check_indices(&c);
+    CHECK(jcanvas_text_node(&c, "d", "t") != NULL); // the id isn't left taken
+#else
+    CHECK(stats.rows == 6 && stats.added == 3 && stats.skipped == 3);
+    CHECK(c.node_count == 3 && str_is(sstr_view(&c.nodes[2].color), "rebeccapurple"));
+#endif
+    CHECK(c.nodes[0].x == 10 && c.nodes[0].y == 20 && c.nodes[1].x == -5);
+    CHECK(str_is(c.nodes[0].as.text, "quoted, \\\"text\\\"") && str_is(c.nodes[1].as.text, "new\\nline"));
+    jcanvas_color color = jcanvas_get_color(&c.nodes[0]);
+    CHECK(str_is(sstr_view(&color), "4"));
+    check_indices(&c);
+
+    file = file_with("# comment\na c 1.5\nc,a\nc a\na missing\n\n% also a comment\nlonely\n");
+    CHECK(jcanvas_import_edges(&c, file, &stats));
+    fclose(file);
+    CHECK(stats.rows == 5 && stats.added == 2 && stats.skipped == 3);
+    CHECK(c.edge_count == 2 && c.edges[0].from_index == 0 && c.edges[1].from_index == 1);
+
+    file = file_with("");
+    CHECK(!jcanvas_import_nodes_csv(&c, file, &stats)); // no header
+    fclose(file);
+    file = file_with("");
+    CHECK(jcanvas_import_edges(&c, file, &stats) && stats.rows == 0);
+    fclose(file);
+    check_indices(&c);
+    jcanvas_destroy(&c);
+    CHECK(heap == 0);
+
+    // a table of long texts is read into the canvas' memory once, not into a buffer and then copied
+    static char table[4 * 100000 + 100];
+    uint32_t len = (uint32_t)sprintf(table, "id,text\n");
+    for (uint32_t i = 0; i < 4; i++) {
+        len += (uint32_t)sprintf(table + len, "n%u,", i);
+        memset(table + len, 'x', 100000 - 1);
+        len += 100000 - 1;
+        table[len++] = '\n';
+    }
+    table[len] = 0;
+    jcanvas_init_with_allocator(&c, &counting);
+    file = file_with(table);
+    heap_limit = heap + len * 3 / 2;
+    CHECK(jcanvas_import_nodes_csv(&c, file, &stats) && stats.added == 4);
+    heap_limit = INT64_MAX;
+    fclose(file);
+    CHECK(c.node_count == 4 && c.nodes[3].as.text.len == 100000 - 1);
+    jcanvas_destroy(&c);
+    CHECK(heap == 0);
+}
+
+static void test_capacity(void)
+{
+    jcanvas c;
+    jcanvas_init_with_allocator(&c, &counting);
+    CHECK(!jcanvas_reserve(&c, UINT32_MAX, 0) && c.last_error != NULL);
+    heap_limit = heap + 1000;
+    CHECK(!jcanvas_reserve(&c, 100000, 100000) && c.last_error != NULL);
+    heap_limit = INT64_MAX;
+
+    // after reserving, building the canvas never moves the arrays or rehashes the indexes
+    CHECK(jcanvas_reserve(&c, 1000, 2000));
+    CHECK(c.node_cap == 1000 && c.edge_cap == 2000);
+    jcanvas_node* nodes = c.nodes;
+    jcanvas_edge* edges = c.edges;
+    uint32_t node_slots = c.id_to_nodes.cap, edge_slots = c.id_to_edges.cap, pair_slots = c.edge_pairs.cap;
+    make_ids("n", 1000);
+    for (uint32_t i = 0; i < 1000; i++) jcanvas_text_node(&c, ids[i], "t");
+    for (uint32_t i = 0; i < 1000; i++) {
+        jcanvas_connect(&c, &c.nodes[i], &c.nodes[(i + 1) % 1000]);
+        jcanvas_connect(&c, &c.nodes[i], &c.nodes[(i + 2) % 1000]);
+    }
+    CHECK(c.node_count == 1000 && c.edge_count == 2000);
+    CHECK(c.nodes == nodes && c.edges == edges && c.node_cap == 1000 && c.edge_cap == 2000);
+    CHECK(c.id_to_nodes.cap == node_slots && c.id_to_edges.cap == edge_slots && c.edge_pairs.cap == pair_slots);
+
+    // shrinking gives back what removing left over, and the canvas still works
+    const uint32_t* out;
+    CHECK(jcanvas_out_edges(&c, &c.nodes[0], &out) == 2);
+    while (c.node_count > 100) CHECK(jcanvas_remove_node(&c, &c.nodes[c.node_count - 1]));
+    int64_t before = heap;
+    CHECK(jcanvas_shrink_to_fit(&c));
+    CHECK(heap < before && c.node_cap == 100 && c.edge_cap == c.edge_count);
+    check_indices(&c);
+    CHECK(jcanvas_out_edges(&c, &c.nodes[0], &out) == 2);
+    CHECK(jcanvas_text_node(&c, "new", "t") != NULL && c.node_cap > 100);
+    jcanvas_destroy(&c);
+    CHECK(heap == 0);
+
+    // without reserving the arrays grow by growth.percent, at most max_step elements at a time
+    for (uint32_t max_step = 0; max_step <= 300; max_step += 300) {
+        jcanvas_init_with_allocator(&c, &counting);
+        c.growth = (jcanvas_growth){ .percent = 100, .max_step = max_step };
+        uint32_t cap = 0, grows = 0;
+        make_ids("n", 4000);
+        for (uint32_t i = 0; i < 4000; i++) {
+            jcanvas_text_node(&c, ids[i], "t");
+            if (c.node_cap == cap) continue;
+            if (cap >= 64) CHECK(c.node_cap == (max_step && cap > max_step ? cap + max_step : cap * 2));
+            cap = c.node_cap;
+            grows++;
+        }
+        CHECK(c.node_count == 4000 && (max_step ? grows > 10 : grows < 10));
+        check_indices(&c);
+        jcanvas_destroy(&c);
+        CHECK(heap == 0);
+    }
+}
+
+// the innermost group around node i, testing every group like the tree's definition says
+static uint32_t brute_parent(jcanvas* c, uint32_t i)
+{
+    const jcanvas_node* node = &c->nodes[i];
+    uint32_t best = JCANVAS_NO_GROUP;
+    for (uint32_t g = 0; g < c->node_count; g++) {
+        const jcanvas_node* group = &c->nodes[g];
+        if (g == i || group->type != NODE_TYPE_GROUP || node->x < group->x || node->y < group->y) continue;
+        if (node->x + node->width > group->x + group->width || node->y + node->height > group->y + group->height) continue;
+        if (node->x == group->x && node->y == group->y && node->width == group->width && node->height == group->height && g > i) continue;
+        double area = (double)group->width * group->height;
+        if (best == JCANVAS_NO_GROUP || area < (double)c->nodes[best].width * c->nodes[best].height
+            || (area == (double)c->nodes[best].width * c->nodes[best].height && g > best)) best = g;
+    }
+    return best;
+}
+
+// nested groups, top level nodes and moving a group with what's in it
+static void test_group_tree(void)
+{
+    jcanvas c;
+    jcanvas_init(&c);
+    jcanvas_node* outer = jcanvas_group_node(&c, "outer");
+    jcanvas_pos_node(&c, outer, -1000, -1000, 2000, 2000);
+    jcanvas_node* inner = jcanvas_group_node(&c, "inner");
+    jcanvas_pos_node(&c, inner, -100, -100, 300, 300);
+    jcanvas_node* a = jcanvas_text_node(&c, "a", "a");
+    jcanvas_pos_node(&c, a, 0, 0, 50, 50);
+    jcanvas_node* b = jcanvas_text_node(&c, "b", "b");
+    jcanvas_pos_node(&c, b, 500, 500, 50, 50);
+    jcanvas_node* out = jcanvas_text_node(&c, "out", "x");
+    jcanvas_pos_node(&c, out, 990, 990, 50, 50);
+
+    jcanvas_group_tree tree;
+    CHECK(jcanvas_build_group_tree(&c, &tree));
+    CHECK(tree.parent[0] == JCANVAS_NO_GROUP && tree.parent[1] == 0 && tree.parent[2] == 1);
+    CHECK(tree.parent[3] == 0 && tree.parent[4] == JCANVAS_NO_GROUP);
+    const uint32_t* children;
+    CHECK(jcanvas_group_children(&tree, JCANVAS_NO_GROUP, &children) == 2 && children[0] == 0 && children[1] == 4);
+    CHECK(jcanvas_group_children(&tree, 0, &children) == 2 && children[0] == 1 && children[1] == 3);
+    CHECK(jcanvas_group_children(&tree, 2, NULL) == 0);
+    CHECK(jcanvas_move_group(&c, &tree, 1, 10, -20));
+    CHECK(inner->x == -90 && a->x == 10 && a->y == -20 && b->x == 500 && outer->x == -1000);
+    CHECK(!jcanvas_move_group(&c, &tree, 5, 0, 0)); // no such node
+    jcanvas_group_tree_destroy(&tree);
+    jcanvas_destroy(&c);
+
+    // random nested groups agree with testing every group, and every node is listed under its parent
+    jcanvas_init_with_allocator(&c, &counting);
+    make_ids("n", 600);
+    srand(7);
+    for (uint32_t i = 0; i < 600; i++) {
+        jcanvas_node* node = i % 4 == 0 ? jcanvas_group_node(&c, ids[i]) : jcanvas_text_node(&c, ids[i], "t");
+        int64_t size = i % 4 == 0 ? 1 + rand() % 800 : 1 + rand() % 40;
+        jcanvas_pos_node(&c, node, rand() % 2000 - 1000, rand() % 2000 - 1000, size, i % 3 ? size : size / 2 + 1);
+    }
+    jcanvas_pos_node(&c, &c.nodes[300], c.nodes[0].x, c.nodes[0].y, c.nodes[0].width, c.nodes[0].height); // same bounds as group 0
+    int64_t before = heap;
+    uint32_t failed = 0;
+    for (int64_t limit = 0; limit < 100000; limit += 5000) {
+        heap_limit = heap + limit;
+        if (jcanvas_build_group_tree(&c, &tree)) jcanvas_group_tree_destroy(&tree);
+        else failed++;
+        CHECK(heap == before);
+    }
+    heap_limit = INT64_MAX;
+    CHECK(failed > 0);
+    CHECK(jcanvas_build_group_tree(&c, &tree));
+    uint32_t listed = 0;
+    for (uint32_t i = 0; i < 600; i++) {
+        CHECK(tree.parent[i] == brute_parent(&c, i));
+        uint32_t count = jcanvas_group_children(&tree, i, &children);
+        for (uint32_t k = 0; k < count; k++) CHECK(tree.parent[children[k]] == i);
+        listed += count;
+    }
+    listed += jcanvas_group_children(&tree, JCANVAS_NO_GROUP, NULL);
+    CHECK(listed == 600 && tree.parent[300] == 0);
+    jcanvas_group_tree_destroy(&tree);
+    jcanvas_destroy(&c);
+    CHECK(heap == 0);
+}
+
+// the same canvas built in two orders generates the same bytes, sorted by id
+static void test_canonical_order(void)
+{
+    jcanvas a, b;
+    jcanvas_init(&a);
+    jcanvas_init(&b);
+    CHECK(!a.canonical_order); // it's off by default
+    a.canonical_order = b.canonical_order = true;
+    make_ids("a/long/shared/prefix/", 1000);
+    for (uint32_t i = 0; i < 1000; i++) {
+        jcanvas_pos_node(&a, jcanvas_text_node(&a, ids[i], "t"), i, 0, 10, 10);
+        uint32_t j = 999 - i;
+        jcanvas_pos_node(&b, jcanvas_text_node(&b, ids[j], "t"), j, 0, 10, 10);
+    }
+    for (uint32_t i = 0; i < 1000; i += 3) jcanvas_connect_by_id(&a, make_str(ids[i]), make_str(ids[(i * 7 + 1) % 1000]));
+    for (uint32_t i = 999; i < 1000; i -= 1) {
+        if (i % 3 == 0) jcanvas_connect_by_id(&b, make_str(ids[i]), make_str(ids[(i * 7 + 1) % 1000]));
+    }
+    CHECK(same_output(&a, &b));
+
+    // "prefix/10" comes before "prefix/2"
+    str s = jcanvas_generate(&a);
+    char* ten = strstr(s.data, "\"a/long/shared/prefix/10\"");
+    char* two = strstr(s.data, "\"a/long/shared/prefix/2\"");
+    CHECK(ten && two && ten < two);
+    jcanvas_free_str(&a, &s);
+
+    // the pull generator and views follow the same order
+    jcanvas_gen gen;
+    jcanvas_gen_begin(&a, &gen);
+    str pulled = {0};
+    char piece[1000];
+    for (uint32_t n; (n = jcanvas_gen_next(&gen, piece, sizeof(piece))) > 0;) str_append(&a.allocator, &pulled, piece, n);
+    jcanvas_gen_end(&gen);
+    s = jcanvas_generate(&a);
+    CHECK(pulled.len == s.len - 1 && memcmp(pulled.data, s.data, pulled.len) == 0);
+    jcanvas_view v;
+    const char* error = NULL;
+    CHECK(jcanvas_snapshot(&b, &v));
+    str viewed = jcanvas_view_generate(&v, &error);
+    CHECK(viewed.data && strcmp(viewed.data, s.data) == 0);
+    jcanvas_view_free_str(&v, &viewed);
+    jcanvas_view_destroy(&v);
+    jcanvas_free_str(&a, &s);
+    jcanvas_free_str(&a, &pulled);
+
+    // so do the tiles: the same files with the same bytes, and the same manifest
+    const char* dirs[2] = { "jcanvas_test_tiles_a", "jcanvas_test_tiles_b" };
+    mkdir(dirs[0], 0700);
+    mkdir(dirs[1], 0700);
+    CHECK(jcanvas_generate_tiled(&a, 100, dirs[0]) && jcanvas_generate_tiled(&b, 100, dirs[1]));
+    jcanvas_tiling tiling;
+    CHECK(jcanvas_tiling_plan(&a, &tiling, 100) && tiling.tile_count == 11);
+    char path[2][128];
+    for (uint32_t t = 0; t <= tiling.tile_count; t++) {
+        for (uint32_t k = 0; k < 2; k++) {
+            if (t == tiling.tile_count) snprintf(path[k], sizeof(path[k]), "%s/manifest.json", dirs[k]);
+            else snprintf(path[k], sizeof(path[k]), "%s/tile_%lld_%lld.canvas", dirs[k], (long long)tiling.tiles[t].x, (long long)tiling.tiles[t].y);
+        }
+        char* tile_a = read_file(path[0]);
+        char* tile_b = read_file(path[1]);
+        CHECK(tile_a && tile_b && strcmp(tile_a, tile_b) == 0);
+        free(tile_a);
+        free(tile_b);
+        remove(path[0]);
+        remove(path[1]);
+    }
+    jcanvas_tiling_destroy(&tiling);
+    remove(dirs[0]);
+    remove(dirs[1]);
+
+    b.canonical_order = false;
+    CHECK(!same_output(&a, &b));
+    jcanvas_destroy(&a);
+    jcanvas_destroy(&b);
+}
+
+int main()
+{
+    struct { const char* name; void (*run)(void); } tests[] = {
+        { "duplicate edges", test_duplicate_edges },
+        { "adjacency", test_adjacency },
+        { "removal", test_removal },
+        { "allocator", test_allocator },
+        { "validation", test_validation },
+        { "stream read", test_stream_read },
+        { "query", test_query },
+        { "text from file", test_text_from_file },
+        { "snapshot", test_snapshot },
+        { "journal", test_journal },
+        { "instantiate", test_instantiate },
+        { "edge sides", test_edge_sides },
+        { "index", test_index },
+        { "patch", test_patch },
+        { "tiling", test_tiling },
+        { "lod", test_lod },
+        { "pull", test_pull },
+        { "iov", test_iov },
+        { "import", test_import },
+        { "capacity", test_capacity },
+        { "group tree", test_group_tree },
+        { "canonical order", test_canonical_order },
+    };
+    for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+        uint32_t before = failures;
+        tests[i].run();
+        printf("%-16s %s\n", tests[i].name, failures == before ? "ok" : "FAILED");
+    }
+    printf("%u failed checks\n", failures);
+    return failures != 0;
+}